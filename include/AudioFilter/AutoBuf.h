@@ -4,6 +4,9 @@
 
 /*
  * Simple buffer helper class
+ *
+ * setAlignment() makes the following allocations aligned to the given
+ * number of bytes (power of 2, multiple of the element size).
  */
 
 #include <cstring>
@@ -14,18 +17,37 @@ namespace AudioFilter {
 template <class T> class AutoBuf
 {
 private:
-  T *f_buf;
+  T *f_raw; // allocated pointer
+  T *f_buf; // aligned pointer
   size_t f_size;
   size_t f_allocated;
+  size_t f_align;
 
   AutoBuf(const AutoBuf &);
   AutoBuf &operator =(const AutoBuf &);
 
+  inline T *alloc(size_t size, T *&raw) const
+  {
+    if ( f_align <= sizeof(T) )
+    {
+      raw = new T[size];
+      return raw;
+    }
+
+    raw = new T[size + f_align / sizeof(T)];
+
+    if ( ! raw )
+      return 0;
+
+    size_t offset = (f_align - (size_t)raw % f_align) % f_align;
+    return (T *)((uint8_t *)raw + offset);
+  }
+
 public:
-  AutoBuf(): f_buf(0), f_size(0), f_allocated(0)
+  AutoBuf(): f_raw(0), f_buf(0), f_size(0), f_allocated(0), f_align(0)
   {}
 
-  AutoBuf(size_t size): f_buf(0), f_size(0), f_allocated(0)
+  AutoBuf(size_t size): f_raw(0), f_buf(0), f_size(0), f_allocated(0), f_align(0)
   {
     allocate(size);
   }
@@ -40,7 +62,7 @@ public:
     if ( f_allocated < size )
     {
       free();
-      f_buf = new T[size];
+      f_buf = alloc(size, f_raw);
 
       if (f_buf)
       {
@@ -58,17 +80,19 @@ public:
   {
     if ( f_allocated < size )
     {
-      T *new_buf = new T[size];
+      T *new_raw;
+      T *new_buf = alloc(size, new_raw);
 
       if ( new_buf )
       {
         memcpy(new_buf, f_buf, f_size * sizeof(T));
 
-        if ( f_buf )
+        if ( f_raw )
         {
-          delete[] f_buf;
+          delete[] f_raw;
         }
 
+        f_raw = new_raw;
         f_buf = new_buf;
         f_size = size;
         f_allocated = size;
@@ -84,12 +108,30 @@ public:
 
   inline void free(void)
   {
-    delete[] f_buf;
+    delete[] f_raw;
+    f_raw = 0;
 	f_buf = 0;
     f_size = 0;
     f_allocated = 0;
   }
 
+  // takes effect at the next allocation
+  inline void setAlignment(size_t align)
+  {
+    assert(align % sizeof(T) == 0 && (align & (align - 1)) == 0);
+
+    if ( f_align != align )
+    {
+      free();
+      f_align = align;
+    }
+  }
+
+  inline size_t getAlignment(void) const
+  {
+    return f_align > sizeof(T)? f_align: sizeof(T);
+  }
+
   inline void zero(void)
   {
     if ( f_buf )
@@ -22,6 +22,35 @@
  *
  * isLarge() helps to detect a large value that cannot be cast to size_t.
  * castSize() casts the value to size_t. Returns -1 when the value is too large.
+ *
+ * Memory mapping
+ * ==============
+ *
+ * map() maps the whole file opened into memory (POSIX only). After that
+ * read(), seek() and pos() work with the mapping instead of stdio, and
+ * readDirect() returns a pointer into the mapping instead of copying the
+ * data, so the caller may work with the file data in place. The mapping is
+ * private and writable: data may be changed in place, the file is never
+ * changed. map() fails (and the file stays in stdio mode) when the file
+ * cannot be mapped: a pipe, an empty file or a file larger than the address
+ * space.
+ *
+ * The access pattern is advised to the kernel: sequential mapping enables
+ * aggressive readahead, random mapping disables it (useful for probing).
+ *
+ * MemFile maps the file when it can, so large files do not need a large
+ * memory allocation.
+ *
+ * Read-ahead
+ * ==========
+ *
+ * prefetch() starts a background thread that reads the file ahead of the
+ * current position into a ring of 'depth' aligned blocks (see ReadAhead.h),
+ * so read() does not wait for the storage. read(), seek(), pos(), eof() and
+ * readDirect() work with the ring while prefetching is on; the FILE handle
+ * must not be used directly. readDirect() returns at most the rest of the
+ * current block, and the data is valid until the next read or seek.
+ * Prefetching is stopped by stopPrefetch(), map() and close().
  */
 
 #ifdef __GNUC__
@@ -32,6 +61,8 @@
 
 namespace AudioFilter {
 
+class ReadAhead;
+
 class AutoFile
 {
 public:
@@ -41,18 +72,20 @@ public:
   typedef int64_t fsize_t;
 #endif
   static const fsize_t max_size;
+  static const size_t prefetch_depth;
+  static const size_t prefetch_block;
 
-  AutoFile(): f(0)
+  AutoFile(): f(0), map_data(0), map_pos(0), ahead(0)
   {}
 
   AutoFile(const char *filename, const char *mode = "rb")
-    : f(0)
+    : f(0), map_data(0), map_pos(0), ahead(0)
   {
     open(filename, mode);
   }
 
   AutoFile(FILE *_f, bool _take_ownership = false)
-    : f(0)
+    : f(0), map_data(0), map_pos(0), ahead(0)
   {
     open(_f, _take_ownership);
   }
@@ -64,7 +97,7 @@ public:
 
   static bool isLarge(fsize_t value)
   {
-    return value > (fsize_t)(size_t)-1;
+    return value < 0 || (uint64_t)value > (uint64_t)(size_t)-1;
   }
 
   static size_t castSize(fsize_t value)
@@ -78,6 +111,12 @@ public:
 
   inline size_t read(void *buf, size_t size)
   {
+    if ( map_data )
+      return readMapped(buf, size);
+
+    if ( ahead )
+      return readAhead(buf, size);
+
     return ::fread(buf, 1, size, f);
   }
 
@@ -93,6 +132,12 @@ public:
 
   inline bool eof(void) const
   {
+    if ( map_data )
+      return map_pos >= filesize;
+
+    if ( ahead )
+      return eofAhead();
+
     return f ? (feof(f) != 0) : true;
   }
 
@@ -114,11 +159,56 @@ public:
   int seek(fsize_t _pos);
   fsize_t pos(void) const;
 
+  /////////////////////////////////////////////////////////
+  // Memory mapping
+
+  enum map_advice_t { map_sequential, map_random };
+
+  bool map(map_advice_t advice = map_sequential);
+  void unmap(void);
+  uint8_t *readDirect(size_t &size);
+
+  inline bool isMapped(void) const
+  {
+    return map_data != 0;
+  }
+
+  inline uint8_t *getMapData(void) const
+  {
+    return map_data;
+  }
+
+  /////////////////////////////////////////////////////////
+  // Read-ahead
+
+  bool prefetch(size_t depth = prefetch_depth, size_t block_size = prefetch_block);
+  void stopPrefetch(void);
+
+  inline bool isPrefetching(void) const
+  {
+    return ahead != 0;
+  }
+
 protected:
   FILE *f;
   bool own_file;
   fsize_t filesize;
 
+  uint8_t *map_data; // file mapping (0 when not mapped)
+  fsize_t map_pos;   // current position in the mapping
+
+  size_t readMapped(void *buf, size_t size);
+
+  ReadAhead *ahead; // read-ahead thread (0 when not prefetching)
+
+  size_t readAhead(void *buf, size_t size);
+  bool eofAhead(void) const;
+
+private:
+  // Disallow file object copy
+  AutoFile(const AutoFile &);
+  AutoFile &operator=(const AutoFile &);
+
 };
 
 class MemFile
@@ -137,7 +227,13 @@ public:
     return (uint8_t *)data;
   }
 
+  inline bool isMapped(void) const
+  {
+    return f.isMapped();
+  }
+
 protected:
+  AutoFile f;
   void *data;
   size_t file_size;
 
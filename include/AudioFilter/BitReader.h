@@ -1,6 +1,25 @@
 #pragma once
 #ifndef AUDIOFILTER_BITREADER_H
 #define AUDIOFILTER_BITREADER_H
+/*
+  BitReader - reads bit fields from a buffer (msb first).
+
+  The reader is a view: it does not own or copy the buffer, so the buffer
+  must live while the reader is used. The reader is small and cheap to
+  copy (a copy reads on independently from the same position).
+
+  Bits are read through a 64-bit cache refilled a word (4 bytes) at a time.
+  The bitstream type sets how the bytes of a word map to the stream, so
+  byte-swapped and 14-bit streams are read in place without conversion:
+
+    BITSTREAM_8, BITSTREAM_16BE - bytes in order
+    BITSTREAM_16LE              - 16-bit words with swapped bytes
+    BITSTREAM_14BE              - 16-bit big endian words, 14 low bits used
+    BITSTREAM_14LE              - 16-bit little endian words, 14 low bits used
+
+  Positions (seek(), getPos()) are in stream bits, i.e. 14 bits per 16-bit
+  word for 14-bit streams. Reading past the end of the buffer gives zeros.
+*/
 
 #include "Defs.h"
 
@@ -12,75 +31,79 @@ public:
   BitReader()
     : _buf(0)
     , _bufSize(0)
+    , _bsType(BITSTREAM_8)
+    , _wordBits(32)
+    , _bytePos(0)
+    , _cache(0)
+    , _cacheBits(0)
     , _bitN(0)
   {
   }
 
-  BitReader(const BitReader &obj)
-    : _buf(0)
-    , _bufSize(0)
-    , _bitN(0)
+  BitReader(const uint8_t *buf, size_t bufsize, bool isBigEndian)
   {
-    init(obj._buf, obj._bufSize, true);
+    init(buf, bufsize, isBigEndian ? BITSTREAM_16BE : BITSTREAM_16LE);
   }
 
-  BitReader(const uint8_t *buf, size_t bufsize, bool isBigEndian)
-    : _buf(0)
-    , _bufSize(0)
-    , _bitN(0)
+  BitReader(const uint8_t *buf, size_t bufsize, int bsType)
   {
-    init(buf, bufsize, isBigEndian);
+    init(buf, bufsize, bsType);
   }
 
   void initBigEndian (const uint8_t *buf, size_t bufsize)
   {
-    init(buf, bufsize, true);
+    init(buf, bufsize, BITSTREAM_16BE);
   }
 
   void initLittleEndian (const uint8_t *buf, size_t bufsize)
   {
-    init(buf, bufsize, false);
+    init(buf, bufsize, BITSTREAM_16LE);
   }
 
-  void init(const uint8_t *buf, size_t bufsize, bool isBigEndian);
+  void init(const uint8_t *buf, size_t bufsize, bool isBigEndian)
+  {
+    init(buf, bufsize, isBigEndian ? BITSTREAM_16BE : BITSTREAM_16LE);
+  }
+
+  void init(const uint8_t *buf, size_t bufsize, int bsType);
 
-  ~BitReader()
+  int getBsType(void) const
   {
-    if ( _buf )
-      delete _buf;
+    return _bsType;
   }
 
-  void reset(void)
+  size_t getPos(void) const
   {
-      _bitN = 0;
+    return _bitN;
   }
 
-  void seek(size_t offset)
+  void reset(void)
   {
-      _bitN = offset;
+    seek(0);
   }
 
+  void seek(size_t offset);
+
   void skip(size_t bitcount)
   {
+    if ( bitcount < _cacheBits )
+    {
+      _cache <<= bitcount;
+      _cacheBits -= unsigned(bitcount);
       _bitN += bitcount;
+    }
+    else
+      seek(_bitN + bitcount);
   }
 
   bool getBool(void)
   {
-    return getBit();
+    return get(1) != 0;
   }
 
   uint8_t getByte(size_t bitcount = 8)
   {
-    uint8_t ret(0);
-
-    for ( size_t i = 0; i < bitcount; ++i )
-    {
-      ret <<= 1;
-      ret += getBit();
-    }
-
-    return ret;
+    return uint8_t(get(unsigned(bitcount)));
   }
 
   int getInt(size_t bitcount)
@@ -90,30 +113,101 @@ public:
 
   size_t getSizeT(size_t bitcount)
   {
-    size_t ret(0);
-
-    for ( size_t i = 0; i < bitcount; ++i )
-    {
-      ret <<= 1;
-      ret |= getBit();
-    }
+    if ( bitcount <= 32 )
+      return get(unsigned(bitcount));
 
-    return ret;
+    // wide fields on 64-bit hosts
+    const size_t hi(get(unsigned(bitcount - 32)));
+    return (hi << 16 << 16) | get(32);
   }
 
-private:
-  uint32_t getBit(void)
+  // Read up to 32 bits
+  uint32_t get(unsigned bitcount)
   {
-    size_t bytn(_bitN / 8);
-    size_t bitn(7 - (_bitN % 8));
-    uint32_t value((_buf[bytn] >> bitn)&1);
-    ++_bitN;
+    if ( ! bitcount )
+      return 0;
+
+    if ( _cacheBits < bitcount )
+      refill();
+
+    const uint32_t value(uint32_t(_cache >> (64 - bitcount)));
+    _cache <<= bitcount;
+    _cacheBits -= bitcount;
+    _bitN += bitcount;
     return value;
   }
 
-  uint8_t *_buf;
-  size_t _bufSize;
-  size_t _bitN;
+  // Read up to 32 bits as a signed (two's complement) field
+  int32_t getSigned(unsigned bitcount)
+  {
+    if ( ! bitcount )
+      return 0;
+
+    return int32_t(get(bitcount) << (32 - bitcount)) >> (32 - bitcount);
+  }
+
+  // Look at up to 32 bits without reading them
+  uint32_t peek(unsigned bitcount)
+  {
+    if ( ! bitcount )
+      return 0;
+
+    if ( _cacheBits < bitcount )
+      refill();
+
+    return uint32_t(_cache >> (64 - bitcount));
+  }
+
+private:
+  const uint8_t *_buf;
+  size_t   _bufSize;
+  int      _bsType;
+  unsigned _wordBits;  // stream bits per 4-byte word (32 or 28)
+  size_t   _bytePos;   // next word to load
+  uint64_t _cache;     // msb aligned
+  unsigned _cacheBits;
+  size_t   _bitN;      // stream position
+
+  // Fill the cache so it holds at least 33 bits (past the end of the
+  // buffer the cache is filled with zeros).
+  void refill(void)
+  {
+    while ( _cacheBits <= 64 - _wordBits )
+    {
+      const uint8_t *p(_buf + _bytePos);
+      uint8_t tail[4];
+
+      if ( _bytePos + 4 > _bufSize )
+      {
+        // partial or missing word
+        for ( size_t i = 0; i < 4; ++i )
+          tail[i] = _bytePos + i < _bufSize ? _buf[_bytePos + i] : 0;
+        p = tail;
+      }
+
+      uint32_t word;
+
+      switch ( _bsType )
+      {
+        case BITSTREAM_16LE:
+          word = (uint32_t(p[1]) << 24) | (uint32_t(p[0]) << 16) | (uint32_t(p[3]) << 8) | p[2];
+          break;
+        case BITSTREAM_14BE:
+          word = ((((uint32_t(p[0]) << 8) | p[1]) & 0x3fff) << 14) | (((uint32_t(p[2]) << 8) | p[3]) & 0x3fff);
+          break;
+        case BITSTREAM_14LE:
+          word = ((((uint32_t(p[1]) << 8) | p[0]) & 0x3fff) << 14) | (((uint32_t(p[3]) << 8) | p[2]) & 0x3fff);
+          break;
+        default:
+          word = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+          break;
+      }
+
+      _cache |= uint64_t(word) << (64 - _wordBits - _cacheBits);
+      _cacheBits += _wordBits;
+      _bytePos += 4;
+    }
+  }
 };
 
 }; // namespace AudioFilter
@@ -121,4 +215,3 @@ private:
 #endif
 
 // vim: ts=2 sts=2 et
-
@@ -17,37 +17,73 @@ namespace AudioFilter {
 typedef AutoBuf<uint8_t> UInt8Buf;
 typedef AutoBuf<sample_t> Samples;
 
+///////////////////////////////////////////////////////////////////////////////
+// SampleBuf
+//
+// Multichannel sample buffer. Two layouts are possible:
+//
+// allocate()
+//   Packed: channels follow each other (stride == number of samples).
+//
+// allocateAligned()
+//   Aligned: each channel starts at SAMPLE_ALIGN boundary, stride is padded
+//   to a multiple of SAMPLE_ALIGN bytes (whole number of SIMD vectors for any
+//   vector size). Optional guard tail is reserved after the samples of each
+//   channel. Padding and guard are zeroed at allocation, so vector kernels may
+//   read (not write) up to the stride end.
+//
+// reallocate() keeps the layout chosen.
+//
+// getStride() returns the distance between channel starts in samples,
+// getAlignment() returns the alignment of channel starts in bytes.
+
+inline size_t alignedStride(size_t nsamples)
+{
+  const size_t n = SAMPLE_ALIGN / sizeof(sample_t);
+  return (nsamples + n - 1) / n * n;
+}
+
 class SampleBuf
 {
 public:
   SampleBuf()
     : f_nch(0)
     , f_nsamples(0)
+    , f_stride(0)
+    , f_guard(0)
+    , f_aligned(false)
   {}
 
   SampleBuf(unsigned nch, size_t nsamples)
     : f_nch(0)
     , f_nsamples(0)
+    , f_stride(0)
+    , f_guard(0)
+    , f_aligned(false)
   {
     allocate(nch, nsamples);
   }
 
   inline bool allocate(unsigned nch, size_t nsamples)
   {
-    if ( f_buf.allocate(nch * nsamples) == 0 )
-    {
-      free();
-      return false;
-    }
+    f_aligned = false;
+    f_guard = 0;
+    f_buf.setAlignment(0);
+    return init(nch, nsamples, nsamples);
+  }
 
-    f_nch = nch;
-    f_nsamples = nsamples;
-    f_samples.zero();
+  inline bool allocateAligned(unsigned nch, size_t nsamples, size_t guard = 0)
+  {
+    f_aligned = true;
+    f_guard = guard;
+    f_buf.setAlignment(SAMPLE_ALIGN);
 
+    if ( ! init(nch, nsamples, alignedStride(nsamples + guard)) )
+      return false;
+
+    // zero padding and guard
     for ( unsigned ch = 0; ch < nch; ++ch )
-    {
-      f_samples[ch] = f_buf.data() + ch * nsamples;
-    }
+      memset(f_samples[ch] + nsamples, 0, (f_stride - nsamples) * sizeof(sample_t));
 
     return true;
   }
@@ -55,43 +91,47 @@ public:
   inline bool reallocate(unsigned nch, size_t nsamples)
   {
     unsigned min_nch = MIN(f_nch, nch);
+    size_t stride = f_aligned? alignedStride(nsamples + f_guard): nsamples;
+    size_t copy = MIN(f_nsamples, nsamples);
 
     // Compact data before reallocation
-    if ( min_nch > 1 && nsamples < f_nsamples )
+    if ( min_nch > 1 && stride < f_stride )
     {
       for ( unsigned ch = 1; ch < min_nch; ++ch )
-        memmove(f_buf + ch * nsamples, f_buf + ch * f_nsamples, nsamples * sizeof(sample_t));
+        memmove(f_buf + ch * stride, f_buf + ch * f_stride, copy * sizeof(sample_t));
     }
 
     // Reallocate
-    if ( f_buf.reallocate(nch * nsamples) == 0 )
+    if ( f_buf.reallocate(nch * stride) == 0 )
     {
       free();
       return false;
     }
 
     // Expand data after reallocation
-    // Zero the tail
-    if ( min_nch > 1 && nsamples > f_nsamples )
+    if ( min_nch > 1 && stride > f_stride )
     {
       for ( unsigned ch = min_nch - 1; ch > 0; --ch )
-      {
-        memmove(f_buf + ch * nsamples, f_buf + ch * f_nsamples, f_nsamples * sizeof(sample_t));
-        memset(f_buf + ch * nsamples + f_nsamples, 0, (nsamples - f_nsamples) * sizeof(sample_t));
-      }
+        memmove(f_buf + ch * stride, f_buf + ch * f_stride, copy * sizeof(sample_t));
     }
 
+    // Zero the tail (and padding)
+    for ( unsigned ch = 0; ch < min_nch; ++ch )
+      memset(f_buf + ch * stride + copy, 0, (stride - copy) * sizeof(sample_t));
+
     // Zero new channels
     if ( nch > f_nch )
-      memset(f_buf.data() + f_nch * nsamples, 0, (nch - f_nch) * nsamples * sizeof(sample_t));
+      memset(f_buf.data() + f_nch * stride, 0, (nch - f_nch) * stride * sizeof(sample_t));
 
     // Update state
     f_nch = nch;
     f_nsamples = nsamples;
+    f_stride = stride;
+    f_samples.zero();
 
     for ( unsigned ch = 0; ch < nch; ++ch )
     {
-      f_samples[ch] = f_buf.data() + ch * nsamples;
+      f_samples[ch] = f_buf.data() + ch * stride;
     }
 
     return true;
@@ -101,6 +141,7 @@ public:
   {
     f_nch = 0;
     f_nsamples = 0;
+    f_stride = 0;
     f_samples.zero();
     f_buf.free();
   }
@@ -120,6 +161,26 @@ public:
     return f_nsamples;
   }
 
+  inline size_t getStride(void) const
+  {
+    return f_stride;
+  }
+
+  inline size_t getGuard(void) const
+  {
+    return f_stride - f_nsamples;
+  }
+
+  inline size_t getAlignment(void) const
+  {
+    return f_aligned? (size_t)SAMPLE_ALIGN: sizeof(sample_t);
+  }
+
+  inline bool isAligned(void) const
+  {
+    return f_aligned;
+  }
+
   inline samples_t getSamples(void) const
   {
     return f_samples;
@@ -143,10 +204,34 @@ public:
 protected:
   unsigned  f_nch;
   size_t    f_nsamples;
+  size_t    f_stride;
+  size_t    f_guard;
+  bool      f_aligned;
   samples_t f_samples;
 
   Samples f_buf;
 
+  inline bool init(unsigned nch, size_t nsamples, size_t stride)
+  {
+    if ( f_buf.allocate(nch * stride) == 0 )
+    {
+      free();
+      return false;
+    }
+
+    f_nch = nch;
+    f_nsamples = nsamples;
+    f_stride = stride;
+    f_samples.zero();
+
+    for ( unsigned ch = 0; ch < nch; ++ch )
+    {
+      f_samples[ch] = f_buf.data() + ch * stride;
+    }
+
+    return true;
+  }
+
 };
 
 } // namespace AudioFilter
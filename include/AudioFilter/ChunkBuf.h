@@ -0,0 +1,209 @@
+#pragma once
+#ifndef AUDIOFILTER_CHUNKBUF_H
+#define AUDIOFILTER_CHUNKBUF_H
+
+/*
+  Reference-counted chunk payloads
+
+  * ChunkBuf     - reference-counted memory block from a pool
+  * ChunkBufRef  - counted handle to a ChunkBuf (holds one reference)
+  * ChunkBufPool - pool of memory blocks of power-of-2 size classes
+
+  A filter that produces data into a ChunkBuf may attach the handle to the
+  output chunk (Chunk::buf). Any downstream filter that has to keep the data
+  past the next process() call may just copy the handle instead of copying
+  the data. Producer must not overwrite a block that is shared (somebody
+  else holds a reference). It takes a new block from the pool instead:
+
+    if ( ! out_buf.isUnique() )
+      out_buf = ChunkBufPool::getDefault()->allocate(size);
+
+  Data kept by reference is read-only for the keeper if the chunk was also
+  passed downstream, because downstream filters may process data in-place.
+
+  Chunk without a handle is processed as before: its data is valid until the
+  next call to the upstream filter only, and must be copied to be kept.
+*/
+
+#include "Defs.h"
+
+namespace AudioFilter {
+
+class CritSec;
+class ChunkBufPool;
+
+///////////////////////////////////////////////////////////////////////////////
+// ChunkBuf
+// Use ChunkBufPool::allocate() to create a block, and ChunkBufRef to hold it.
+
+class ChunkBuf
+{
+public:
+  inline uint8_t *data(void) const
+  {
+    return f_buf;
+  }
+
+  inline size_t size(void) const
+  {
+    return f_size;
+  }
+
+  int refCount(void) const;
+
+protected:
+  friend class ChunkBufRef;
+  friend class ChunkBufPool;
+
+  ChunkBuf(ChunkBufPool *_pool, int _size_class, size_t _size);
+  ~ChunkBuf();
+
+  void addRef(void);
+  void release(void);
+
+  volatile int  f_refs;
+  ChunkBufPool *f_pool;
+  int           f_size_class;
+  size_t        f_size;
+  uint8_t      *f_raw; // allocated pointer
+  uint8_t      *f_buf; // SAMPLE_ALIGN aligned data
+  ChunkBuf     *f_next; // free list link
+
+private:
+  ChunkBuf(const ChunkBuf &);
+  ChunkBuf &operator =(const ChunkBuf &);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ChunkBufRef
+// Smart handle. Copy adds a reference, destruction releases it.
+
+class ChunkBufRef
+{
+public:
+  ChunkBufRef(): f_ptr(0)
+  {}
+
+  ChunkBufRef(const ChunkBufRef &ref): f_ptr(ref.f_ptr)
+  {
+    if ( f_ptr )
+      f_ptr->addRef();
+  }
+
+  ~ChunkBufRef()
+  {
+    release();
+  }
+
+  ChunkBufRef &operator =(const ChunkBufRef &ref)
+  {
+    if ( f_ptr != ref.f_ptr )
+    {
+      if ( ref.f_ptr )
+        ref.f_ptr->addRef();
+
+      release();
+      f_ptr = ref.f_ptr;
+    }
+
+    return *this;
+  }
+
+  inline void release(void)
+  {
+    if ( f_ptr )
+    {
+      ChunkBuf *ptr = f_ptr;
+      f_ptr = 0;
+      ptr->release();
+    }
+  }
+
+  inline bool isNull(void) const
+  {
+    return f_ptr == 0;
+  }
+
+  // Only this handle refers to the block, so the block may be overwritten
+  inline bool isUnique(void) const
+  {
+    return f_ptr && f_ptr->refCount() == 1;
+  }
+
+  inline uint8_t *data(void) const
+  {
+    return f_ptr? f_ptr->data(): 0;
+  }
+
+  inline size_t size(void) const
+  {
+    return f_ptr? f_ptr->size(): 0;
+  }
+
+  // Check that the memory range belongs to the block
+  inline bool contains(const void *ptr, size_t bytes) const
+  {
+    return f_ptr && (const uint8_t *)ptr >= f_ptr->data()
+      && (const uint8_t *)ptr + bytes <= f_ptr->data() + f_ptr->size();
+  }
+
+protected:
+  friend class ChunkBufPool;
+
+  explicit ChunkBufRef(ChunkBuf *ptr): f_ptr(ptr)
+  {}
+
+  ChunkBuf *f_ptr;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ChunkBufPool
+//
+// Blocks are aligned at SAMPLE_ALIGN boundary and rounded up to power-of-2
+// sizes. Released blocks go to the free list of their size class and are
+// reused by the next allocation. Pool is thread-safe, so blocks may be
+// released at any thread (see PipelineChain).
+//
+// getDefault()
+//   Process-wide pool. It is never destroyed because blocks may outlive
+//   static objects.
+//
+// allocate()
+//   Returns a block of at least 'size' bytes or null handle on failure.
+//
+// trim()
+//   Free all cached blocks.
+
+class ChunkBufPool
+{
+public:
+  ChunkBufPool(size_t _max_cached = 16);
+  ~ChunkBufPool();
+
+  static ChunkBufPool *getDefault(void);
+
+  ChunkBufRef allocate(size_t size);
+  void trim(void);
+
+protected:
+  friend class ChunkBuf;
+
+  enum { min_class = 8, max_class = 30, nclasses = max_class + 1 };
+
+  CritSec  *lock;
+  size_t    max_cached;
+  ChunkBuf *free_list[nclasses];
+  size_t    ncached[nclasses];
+
+  void recycle(ChunkBuf *chunk_buf);
+
+private:
+  ChunkBufPool(const ChunkBufPool &);
+  ChunkBufPool &operator =(const ChunkBufPool &);
+};
+
+}; // namespace AudioFilter
+
+#endif
+
+// vim: ts=2 sts=2 et
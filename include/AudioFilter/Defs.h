@@ -284,6 +284,11 @@ const char *valib_credits();
 
 #define NCHANNELS 8
 
+// alignment of aligned sample buffers (see SampleBuf::allocateAligned)
+// cache line size, multiple of any SIMD vector size
+
+#define SAMPLE_ALIGN 64
+
 // pi constant
 
 #ifndef M_PI
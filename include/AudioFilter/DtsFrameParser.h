@@ -6,9 +6,10 @@
  * DTS parser class
  */
 
-#include "BitStream.h"
+#include "BitReader.h"
 #include "Buffer.h"
 #include "DtsDefs.h"
+#include "DtsSynth.h"
 #include "Parsers.h"
 
 namespace AudioFilter {
@@ -79,8 +80,6 @@ public:
 
   // Subband samples history (for ADPCM)
   double subband_samples_hist[DTS_PRIM_CHANNELS_MAX][DTS_SUBBANDS][4];
-  double subband_fir_hist[DTS_PRIM_CHANNELS_MAX][512];
-  double subband_fir_noidea[DTS_PRIM_CHANNELS_MAX][64];
 };
 
 class DtsFrameParser : public FrameParser, public DtsInfo
@@ -125,18 +124,11 @@ public:
   virtual std::string getFrameInfo(void) const;
 
 protected:
-  void initCosMod(void);
-
   bool parseFrameHeader(void);
   bool parseSubFrameHeader(void);
   bool parseSubSubFrame(void);
   bool parseSubFrameFooter(void);
 
-  int  InverseQ(const huff_entry_t *huff);
-  void qmf_32_subbands(int ch,
-         double samples_in[32][8],
-         sample_t *samples_out,
-         double scale);
   void lfe_interpolation_fir(int nDecimationSelect,
          int nNumDeciSample,
          double *samples_in,
@@ -149,15 +141,14 @@ private:
   size_t    _nSamples;
   int       _bs_type;
 
-  ReadBS    _bs;
-  UInt8Buf  _frameBuf;
+  BitReader _bs;
   SampleBuf _samples;
 
   int current_subframe;
   int current_subsubframe;
 
-  // pre-calculated cosine modulation coefs for the QMF
-  double cos_mod[544];
+  // 32 subbands QMF of each primary channel
+  DtsSynth _synth[DTS_PRIM_CHANNELS_MAX];
 };
 
 }; // namespace AudioFilter
@@ -0,0 +1,87 @@
+#pragma once
+#ifndef AUDIOFILTER_DTSSYNTH_H
+#define AUDIOFILTER_DTSSYNTH_H
+/*
+  DtsSynth - DTS 32-band QMF synthesis filter of a channel
+
+  synth() takes 8 samples of each of 32 subbands (a subsubframe) and makes
+  256 output samples. Subbands from nbands on are taken as silent.
+
+  Cosine modulation of the filter bank is 1/4 of a 32-point DCT-IV, which
+  is done with a 16-point complex FFT. The modulated block only enters the
+  window as differences of its mirrored halves, so the history keeps these
+  (32 values a block) in a ring of 16 blocks and no history is moved.
+
+  Window coefficients (both filters, the 1/4 of the modulation included)
+  and twiddle factors are constant tables computed once and shared by all
+  instances, an instance keeps only its history.
+
+  Implementation
+  ==============
+  Vector implementations process 2 doubles or 4 floats (SSE2), or 4 doubles
+  or 8 floats (AVX) at once: the modulation works on successive samples of
+  a subband, the window on successive outputs. The best one is selected at
+  runtime by CPU features like for IMDCT.
+
+  The filter is computed in doubles or in floats (setPrecision()), floats
+  are the default when sample_t is float. Results of all implementations
+  agree with the direct filter within the rounding error of the precision:
+  1e-12 of the output peak in doubles, 1e-6 in floats. Changing the
+  precision resets the history.
+*/
+
+#include "Defs.h"
+
+namespace AudioFilter {
+
+class DtsSynth
+{
+public:
+  DtsSynth();
+
+  void reset(void);
+
+  // in      - 8 samples of each subband
+  // nbands  - number of active subbands
+  // perfect - use the perfect reconstruction filter
+  // out     - 256 output samples (divided by scale)
+  void synth(const double in[32][8], int nbands, bool perfect, sample_t *out, double scale);
+
+  /////////////////////////////////////////////////////////
+  // Implementation
+  //
+  // setImpl() returns false if the CPU does not support the
+  // implementation. getImpl() returns the implementation
+  // actually used.
+
+  enum { impl_auto, impl_scalar, impl_sse2, impl_avx };
+  enum { prec_double, prec_float };
+
+  bool setImpl(int _impl);
+  int  getImpl(void) const;
+
+  void setPrecision(int _precision);
+  int  getPrecision(void) const { return precision; }
+
+  static bool isImplSupported(int _impl);
+
+protected:
+  int impl;
+  int precision;
+
+  // History of modulated blocks (ring of 16 blocks, newest
+  // at pos) and the second half of the last window output.
+  // Only the arrays of the current precision are used.
+
+  int pos;
+  double hist[16][32];
+  double carry[32];
+  float  hist_f[16][32];
+  float  carry_f[32];
+};
+
+}; // namespace AudioFilter
+
+#endif
+
+// vim: ts=2 sts=2 et
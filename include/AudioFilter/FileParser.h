@@ -4,17 +4,73 @@
 
 /*
   File parser class
+
+  Stats
+  =====
+  stats() measures the average frame interval and bitrate at random file
+  positions. Positions are given by rand() or by the generator given
+  (deterministic for a seeded generator and safe to use from several
+  threads). With a frame index the stats are exact and no measurements are
+  done.
+
+  Frame index
+  ===========
+  Without an index, positions in frames and time units are estimated from
+  the average bitrate measured by stats(). With a frame index (see
+  FrameIndex.h) the file is positioned exactly at frame starts, and the
+  size and position in frames and time are exact (VBR and multi-stream
+  files included).
+
+  buildIndex()
+    Scan the whole file and build the index (blocks until done).
+
+  startIndex()
+    Build the index in a background thread. The thread scans the file with
+    its own file handle and the parser given, which must not be used by
+    anybody else until the thread is done (use a separate parser object,
+    not the file's parser). The index is taken by the file parser when the
+    thread is done, at the next isIndexReady(), seek() or stats() call.
+
+  stopIndex()
+    Cancel the background build (if any).
+
+  loadIndex() / saveIndex()
+    Load or save the index from/to the sidecar file of the file opened (see
+    FrameIndex::sidecarName()). Loading fails when the sidecar is missing
+    or was made for a file of a different size.
+
+  Memory mapping
+  ==============
+  map() switches the file opened to a memory mapping (see AutoFile). Frames
+  are then loaded directly from the mapping without reading the file into
+  the buffer. Only BITSTREAM_8 frames are loaded so: parsers convert frames
+  of other bitstream types in place, so such frames are copied into the
+  buffer first (see StreamBuffer) and the mapping is never changed. When the
+  file cannot be mapped it is read as usual.
+
+  Read-ahead
+  ==========
+  The file is read ahead in a background thread (see AutoFile::prefetch())
+  unless it is mapped. Frames are loaded directly from the read-ahead
+  blocks. prefetch() sets the number of blocks read ahead (0 turns
+  read-ahead off). The depth may also be given to the constructor, so a
+  file that does not need read-ahead (random probing) is opened without
+  starting the thread.
 */
 
 #include <cstdio>
 #include <string>
 #include "AutoFile.h"
 #include "Filter.h"
+#include "FrameIndex.h"
 #include "MpegDemux.h"
 #include "Parsers.h"
+#include "Rng.h"
 
 namespace AudioFilter {
 
+class FrameIndexBuilder;
+
 class FileParser // : public Source
 {
 public:
@@ -26,11 +82,12 @@ public:
   FileParser();
   FileParser(const char *filename
             , HeaderParser *parser = 0
-            , size_t max_scan = 0);
+            , size_t max_scan = 0
+            , size_t prefetch_depth = AutoFile::prefetch_depth);
   ~FileParser();
 
   bool probe(void);
-  bool stats(unsigned max_measurements = 100, vtime_t precision = 0.5);
+  bool stats(unsigned max_measurements = 100, vtime_t precision = 0.5, RNG *rng = 0);
 
   bool isOpen(void) const
   {
@@ -47,6 +104,14 @@ public:
     return filename.c_str();
   }
 
+  bool map(void);
+  bool prefetch(size_t depth);
+
+  bool isMapped(void) const
+  {
+    return f.isMapped();
+  }
+
   HeaderParser *getParser(void)
   {
     return stream.getParser();
@@ -66,6 +131,22 @@ public:
   int seek(fsize_t pos);
   int seek(double pos, units_t units);
 
+  /////////////////////////////////////////////////////////////////////////////
+  // Frame index
+
+  bool buildIndex(void);
+  bool startIndex(HeaderParser *parser);
+  void stopIndex(void);
+  bool isIndexReady(void);
+
+  bool loadIndex(void);
+  bool saveIndex(void) const;
+
+  const FrameIndex &getIndex(void) const
+  {
+    return index;
+  }
+
   /////////////////////////////////////////////////////////////////////////////
   // Frame-level interface (StreamBuffer interface wrapper)
 
@@ -102,6 +183,8 @@ public:
     return stream.getFrameSize();
   }
 
+  fsize_t getFramePos(void) const;
+
   size_t getFrameInterval(void) const
   {
     return stream.getFrameInterval();
@@ -126,8 +209,11 @@ private:
   void init(void);
   bool open(const char *filename
             , HeaderParser *parser
-            , size_t max_scan);
+            , size_t max_scan
+            , size_t prefetch_depth);
   void close(void);
+  bool pollIndex(void);
+  bool indexStats(void);
 
   StreamBuffer stream;
 
@@ -135,6 +221,7 @@ private:
   std::string filename;
 
   uint8_t *buf;
+  uint8_t *in; // input data (buf, the file mapping or a read-ahead block)
   size_t buf_size;
   size_t buf_data;
   size_t buf_pos;
@@ -143,6 +230,9 @@ private:
   float avg_frame_interval; // average frame interval
   float avg_bitrate; // average bitrate
 
+  FrameIndex index; // frame index (empty when not built)
+  FrameIndexBuilder *builder; // background index builder
+
   HeaderParser *_intHeaderParser;
 };
 
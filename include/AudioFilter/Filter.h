@@ -21,6 +21,7 @@
 */
 
 #include "Speakers.h"
+#include "ChunkBuf.h"
 
 namespace AudioFilter {
 
@@ -138,6 +139,14 @@ class SinkFilter;
 // End of stream
 // =============
 // See end of stream flag and format change...
+//
+// Buffer handle
+// =============
+// Chunk may optionally carry a reference to the block that holds its data
+// ('buf' field, see ChunkBuf.h). If it does, a receiver may keep the data by
+// copying the handle instead of copying the data. All set*() functions drop
+// the handle, so a filter that outputs data from a ChunkBuf must attach it
+// with setBuffer() after the chunk is filled.
 
 class Chunk
 {
@@ -156,6 +165,8 @@ public:
 
   bool      eos;
 
+  ChunkBufRef buf;
+
   /////////////////////////////////////////////////////////
   // Utilities
 
@@ -201,6 +212,7 @@ public:
     sync = false;
     time = 0;
     eos = false;
+    buf.release();
   }
 
   inline void setEmpty(Speakers _spk, bool _sync = false
@@ -213,6 +225,7 @@ public:
     sync = _sync;
     time = _time;
     eos = _eos;
+    buf.release();
   }
 
   inline void setLinear(Speakers _spk, samples_t _samples, size_t _size
@@ -228,6 +241,7 @@ public:
     sync = _sync;
     time = _time;
     eos = _eos;
+    buf.release();
   }
 
   inline void setRawData(Speakers _spk, uint8_t *_rawdata, size_t _size,
@@ -243,6 +257,7 @@ public:
     sync = _sync;
     time = _time;
     eos = _eos;
+    buf.release();
   }
 
   inline void set(Speakers _spk, uint8_t *_rawdata, samples_t _samples, size_t _size,
@@ -258,6 +273,12 @@ public:
     sync = _sync;
     time = _time;
     eos = _eos;
+    buf.release();
+  }
+
+  inline void setBuffer(const ChunkBufRef &_buf)
+  {
+    buf = _buf;
   }
 
   inline void setSync(bool _sync, vtime_t _time)
@@ -472,12 +493,68 @@ public:
 //   May be used for data processing. Do main processing here if filter
 //   may produce many output chunks for one input chunk.
 //
+// get_latency() [thread-safe]
+//   Max delay of a sample passing the filter in seconds: algorithmic delay
+//   plus internal buffering (excluding processing time). Valid after
+//   set_input().
+//
+// set_low_latency() [working thread]
+//   Switch between low-latency and high-throughput modes. Returns false if
+//   the mode is not supported. Mode change may require flushing, so it takes
+//   effect after the data buffered is processed.
+//
+// get_block_size() [working thread]
+//   Block size negotiation. Filter that works better (or only) with input
+//   chunks of a fixed size fills BlockSize and returns true (valid after
+//   set_input()). FilterGraph inserts a Rechunker in front of such filter.
+//
+// is_identity() [working thread]
+//   Filter passes data through unchanged in current configuration: output
+//   format equals input format, no buffering, no delay and no processing
+//   (not even statistics). Graph may send data around such filter (see
+//   FilterGraph::set_bypass()). Filter must take the next configuration
+//   change into account, so it returns false when it has to be called to
+//   update its state.
+//
+// fuse_gain() [working thread]
+//   Stage fusion (see FilterGraph::set_fusion()). A filter that only
+//   multiplies linear samples by a gain factor returns pointer to its gain
+//   and stops (_fused = true) or resumes (_fused = false) applying the gain
+//   itself. Other filters return 0.
+//
+// set_input_gains() [working thread]
+//   Stage fusion. Filter that can apply gains of fused upstream filters to
+//   its input during its own pass over the data accepts the gains (applied
+//   one after another, values are read for each chunk) and returns true.
+//   _ngains = 0 drops the gains.
+//
 //
 // Other threads may call:
 //   query_input()
 //   get_output()
 //   is_empty()
 
+///////////////////////////////////////////////////////////////////////////////
+// BlockSize
+// Input block size the filter asks for (linear format only).
+//
+// multiple    - size of input chunks in samples is a multiple of this value
+//               (the last chunk before eos may be shorter)
+// required    - filter cannot process chunks of other sizes (otherwise the
+//               block size is only preferred)
+// max_latency - max latency in samples that may be added in front of the
+//               filter to gather the blocks (0 - no limit)
+
+struct BlockSize
+{
+  size_t multiple;
+  bool   required;
+  size_t max_latency;
+
+  BlockSize(): multiple(0), required(false), max_latency(0)
+  {}
+};
+
 class Filter: public Sink, public Source
 {
 public:
@@ -495,6 +572,42 @@ public:
   virtual bool isEmpty(void) const = 0;
   virtual bool getChunk(Chunk *chunk) = 0;
 
+  virtual vtime_t getLatency(void) const
+  {
+    return 0;
+  }
+
+  // filters without buffering have nothing to switch
+  virtual bool setLowLatency(bool _low_latency)
+  {
+    return true;
+  }
+
+  virtual bool getLowLatency(void) const
+  {
+    return false;
+  }
+
+  virtual bool getBlockSize(BlockSize &_block_size) const
+  {
+    return false;
+  }
+
+  virtual bool isIdentity(void) const
+  {
+    return false;
+  }
+
+  virtual const double *fuseGain(bool _fused)
+  {
+    return 0;
+  }
+
+  virtual bool setInputGains(const double *const *_gains, int _ngains)
+  {
+    return false;
+  }
+
   inline bool processTo(const Chunk *_chunk, Sink *_sink)
   {
     Chunk chunk;
@@ -586,6 +699,7 @@ public:
     time = 0;
     sync = false;
     flushing = false;
+    chunk_buf.release();
     onReset();
   }
 
@@ -659,6 +773,8 @@ protected:
   samples_t samples;
   size_t    size;
 
+  ChunkBufRef chunk_buf; // input data block (if any)
+
   int       format_mask;
 
   virtual void onReset(void) {}
@@ -692,6 +808,7 @@ protected:
       rawdata  = _chunk->rawdata;
       samples  = _chunk->samples;
       size     = _chunk->size;
+      chunk_buf = _chunk->buf;
     }
 
     return true;
@@ -707,6 +824,9 @@ protected:
     _chunk->set ( getOutput(), rawdata, samples, _size
                   , sync, time, flushing && (size == _size));
 
+    // output refers to the input block
+    _chunk->setBuffer(chunk_buf);
+
     if ( spk.isLinear() )
       samples += _size;
     else
@@ -715,6 +835,9 @@ protected:
     size -= _size;
     sync = false;
     flushing = flushing && size;
+
+    if ( ! size )
+      chunk_buf.release();
   }
 
   inline void dropRawData(size_t _size)
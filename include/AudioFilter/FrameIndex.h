@@ -0,0 +1,177 @@
+#pragma once
+#ifndef AUDIOFILTER_FRAMEINDEX_H
+#define AUDIOFILTER_FRAMEINDEX_H
+
+/*
+ * FrameIndex - table of frame positions of a compressed audio file.
+ *
+ * The index is built in one pass over the file and gives exact positions of
+ * frames by frame number and by time, so the file may be positioned without
+ * probing and bitrate estimation (VBR and multi-stream files included).
+ *
+ * The index keeps the file offset of each frame (8 bytes per frame) and a
+ * segment for each run of frames of the same format. Within a segment each
+ * frame has the same number of samples at the same sample rate, so the
+ * timestamp of a frame and the frame at a given time are calculated from
+ * the segment. A new segment starts at each new stream found by the stream
+ * buffer and at each change of the sample rate or sample count. The segment
+ * remembers whether it starts a new stream, so a decoder positioned by the
+ * index resets exactly where the serial decode does.
+ *
+ * Frame lookup by number is O(1), lookup by time and by file position is a
+ * binary search over segments and frames.
+ *
+ * Sidecar file
+ * ============
+ *
+ * save() and load() store the index in a binary file next to the indexed
+ * file (see sidecarName()). The size of the indexed file is stored with the
+ * index and load() fails when the size does not match. The sidecar is
+ * host-specific: it is written in the native byte order, so it cannot be
+ * shared between little- and big-endian hosts (load() rejects a foreign
+ * file by the magic number).
+ */
+
+#include <string>
+#include <vector>
+#include "AutoFile.h"
+#include "Parsers.h"
+
+namespace AudioFilter {
+
+///////////////////////////////////////////////////////////////////////////////
+// Index entry of a frame
+//
+// pos           - file offset of the frame
+// frame         - frame number
+// time          - timestamp of the frame start (seconds)
+// format_change - the frame starts a new segment (new stream or format
+//                 change)
+// new_stream    - the frame starts a new stream (the stream buffer
+//                 reported a new stream, or the first frame)
+
+struct FrameIndexEntry
+{
+  AutoFile::fsize_t pos;
+  size_t  frame;
+  vtime_t time;
+  bool    format_change;
+  bool    new_stream;
+};
+
+class FrameIndex
+{
+public:
+  typedef AutoFile::fsize_t fsize_t;
+
+  FrameIndex(): file_size(0)
+  {}
+
+  /////////////////////////////////////////////////////////
+  // Build
+  //
+  // build()
+  //   Index the file with the parser given. 'cancel' is polled while
+  //   building and stops the scan (the index is cleared and the result is
+  //   false).
+  //
+  // clear()
+  //   Drop the index.
+  //
+  // addFrame()
+  //   Append a frame (frames must be added in file order). Frame and time
+  //   are assigned by the index.
+
+  bool build(const char *filename, HeaderParser *parser, const volatile bool *cancel = 0);
+  void clear(void);
+  void addFrame(fsize_t frame_pos, const HeaderInfo &hinfo, bool new_stream);
+
+  void setFileSize(fsize_t _file_size)
+  {
+    file_size = _file_size;
+  }
+
+  /////////////////////////////////////////////////////////
+  // Sidecar file
+
+  static std::string sidecarName(const char *filename);
+
+  bool save(const char *filename) const;
+  bool load(const char *filename, fsize_t _file_size);
+
+  /////////////////////////////////////////////////////////
+  // Lookup
+  //
+  // getEntry()
+  //   Frame entry by frame number.
+  //
+  // findTime()
+  //   Number of the frame playing at the time given (the first frame when
+  //   the time is negative, the last one after the end).
+  //
+  // findPos()
+  //   Number of the last frame starting at or before the file position (0
+  //   for positions before the first frame).
+
+  bool isEmpty(void) const
+  {
+    return pos.empty();
+  }
+
+  size_t getFrameCount(void) const
+  {
+    return pos.size();
+  }
+
+  size_t getSegmentCount(void) const
+  {
+    return segment.size();
+  }
+
+  fsize_t getFileSize(void) const
+  {
+    return file_size;
+  }
+
+  vtime_t getDuration(void) const;
+
+  bool getEntry(size_t frame, FrameIndexEntry &entry) const;
+  size_t findTime(vtime_t time) const;
+  size_t findPos(fsize_t file_pos) const;
+
+protected:
+  /////////////////////////////////////////////////////////
+  // Run of frames of the same format
+  //
+  // first_frame  - number of the first frame
+  // time         - timestamp of the first frame
+  // sample_rate  - sample rate of the frames
+  // sample_count - samples per frame
+  // new_stream   - the first frame starts a new stream
+
+  struct Segment
+  {
+    size_t   first_frame;
+    vtime_t  time;
+    unsigned sample_rate;
+    size_t   sample_count;
+    bool     new_stream;
+
+    vtime_t getFrameDuration(void) const
+    {
+      return sample_rate? vtime_t(sample_count) / sample_rate: 0;
+    }
+  };
+
+  fsize_t file_size;
+  std::vector<fsize_t> pos;
+  std::vector<Segment> segment;
+
+  size_t findSegment(size_t frame) const;
+};
+
+}; // namespace AudioFilter
+
+#endif
+
+// vim: ts=2 sts=2 et
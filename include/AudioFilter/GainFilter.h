@@ -15,13 +15,22 @@ class GainFilter : public NullFilter
 public:
   double gain;
 
-  GainFilter(): NullFilter(FORMAT_MASK_LINEAR) {}
-  GainFilter(double gain_): NullFilter(FORMAT_MASK_LINEAR), gain(gain_) {}
+  GainFilter(): NullFilter(FORMAT_MASK_LINEAR), fused(false) {}
+  GainFilter(double gain_): NullFilter(FORMAT_MASK_LINEAR), gain(gain_), fused(false) {}
+
+  // gain is applied by the downstream filter
+  virtual const double *fuseGain(bool _fused)
+  {
+    fused = _fused;
+    return &gain;
+  }
 
 protected:
+  bool fused;
+
   virtual bool onProcess(void)
   {
-    if ( gain != 1.0 )
+    if ( ! fused && gain != 1.0 )
     {
       for ( int ch = 0; ch < spk.getChannelCount(); ++ch )
         for ( size_t s = 0; s < size; ++s )
@@ -65,6 +65,7 @@ private:
   Speakers   out_spk;
   samples_t  samples;
   size_t     size;
+  ChunkBufRef in_buf; // input data block (if any)
   samples_t  out_samples;
   size_t     out_size;
   size_t     buffered_samples;
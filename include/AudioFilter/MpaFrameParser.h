@@ -76,7 +76,7 @@ public:
   /////////////////////////////////////////////////////////
   // FrameParser overrides
 
-  virtual const HeaderParser *getHeaderParser(void) const;
+  virtual HeaderParser *getHeaderParser(void);
 
   virtual void reset(void);
   virtual bool parseFrame(uint8_t *frame, size_t size);
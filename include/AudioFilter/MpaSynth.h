@@ -27,6 +27,8 @@ class SynthBufferFPU;
 class SynthBuffer
 {
 public:
+  virtual ~SynthBuffer() {}
+
   virtual void synth(sample_t samples[32]) = 0;
   virtual void reset(void) = 0;
 };
@@ -6,6 +6,7 @@
  * Abstract parser interface
  */
 
+#include <algorithm>
 #include <string>
 #include <vector>
 #include "BitStream.h"
@@ -13,6 +14,7 @@
 #include "Speakers.h"
 #include "Ac3Defs.h"
 #include "IMDCT.h"
+#include "SyncScan.h"
 
 namespace AudioFilter {
 
@@ -158,6 +160,15 @@ class StreamBuffer;
 //
 //   Size of header buffer given must be >= header_size() (it is not verified
 //   and may lead to memory fault).
+//
+// add_syncs()
+//   Export syncpoints of the format: add syncpoints to the scanner given and
+//   return the syncpoint mask. Any header accepted by parse_header() must
+//   start with one of the syncpoints, so the stream may be scanned with
+//   SyncScan and parse_header() called only at syncpoints found. Parsers that
+//   cannot tell their syncpoints return 0 (default) and the header must be
+//   checked at each position in this case. Use standard syncpoint indexes
+//   (see SyncScan.h), so syncpoints of different parsers do not clash.
 
 class HeaderInfo
 {
@@ -286,6 +297,11 @@ public:
   virtual bool parseHeader(const uint8_t *hdr, HeaderInfo *hi = 0) = 0;
   virtual bool compareHeaders(const uint8_t *hdr1, const uint8_t *hdr2) = 0;
   virtual std::string getHeaderInfo(const uint8_t *hdr);
+
+  virtual uint32_t addSyncs(SyncScan &scan) const
+  {
+    return 0;
+  }
 };
 
 class Ac3HeaderParser : public HeaderParser
@@ -315,6 +331,12 @@ public:
 
   virtual bool parseHeader(const uint8_t *hdr, HeaderInfo *hi = 0);
   virtual bool compareHeaders(const uint8_t *hdr1, const uint8_t *hdr2);
+
+  virtual uint32_t addSyncs(SyncScan &scan) const
+  {
+    scan.setStandard(SYNCMASK_AC3);
+    return SYNCMASK_AC3;
+  }
 };
 
 class TrueHdHeaderParser : public HeaderParser
@@ -379,6 +401,12 @@ public:
 
   virtual bool parseHeader(const uint8_t *hdr, HeaderInfo *hi = 0);
   virtual bool compareHeaders(const uint8_t *hdr1, const uint8_t *hdr2);
+
+  virtual uint32_t addSyncs(SyncScan &scan) const
+  {
+    scan.setStandard(SYNCMASK_DTS);
+    return SYNCMASK_DTS;
+  }
 };
 
 class DtsHdHeaderParser : public HeaderParser
@@ -408,6 +436,12 @@ public:
 
   virtual bool parseHeader(const uint8_t *hdr, HeaderInfo *hi = 0);
   virtual bool compareHeaders(const uint8_t *hdr1, const uint8_t *hdr2);
+
+  virtual uint32_t addSyncs(SyncScan &scan) const
+  {
+    scan.setStandard(SYNCMASK_DTSHD);
+    return SYNCMASK_DTSHD;
+  }
 };
 
 class MpaHeaderParser : public HeaderParser
@@ -437,6 +471,54 @@ public:
 
   virtual bool parseHeader(const uint8_t *hdr, HeaderInfo *hi = 0);
   virtual bool compareHeaders(const uint8_t *hdr1, const uint8_t *hdr2);
+
+  virtual uint32_t addSyncs(SyncScan &scan) const
+  {
+    scan.setStandard(SYNCMASK_MPA);
+    return SYNCMASK_MPA;
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// MultiHeaderParser
+//
+// Header parser that combines several parsers. The parser that matched the
+// last header is tried first, and the others are tried in order of
+// addParser() calls.
+//
+// Only the parsers that can match the header are called: syncpoints of the
+// parsers (see addSyncs()) are collected into a synctable, and the first 4
+// bytes of the header give the set of syncpoints (and therefore parsers)
+// possible at this position with 4 table lookups. Parsers that do not
+// export syncpoints are called for each header. So the cost of a header
+// that does not start with a syncpoint does not grow with the number of
+// parsers.
+//
+// MultiHeaderStats - dispatch statistics
+//
+// headers - parseHeader() calls
+// calls   - parseHeader() calls of the parsers
+// matches - headers matched by each parser (in order of addParser() calls)
+//
+// Only parseHeader() is counted, getHeaderInfo() does not change the stats.
+
+struct MultiHeaderStats
+{
+  uint64_t headers;
+  uint64_t calls;
+  std::vector<uint64_t> matches;
+
+  MultiHeaderStats()
+  {
+    reset();
+  }
+
+  void reset(void)
+  {
+    headers = 0;
+    calls = 0;
+    std::fill(matches.begin(), matches.end(), 0);
+  }
 };
 
 class MultiHeaderParser : public HeaderParser
@@ -473,18 +555,42 @@ public:
   virtual bool parseHeader(const uint8_t *hdr, HeaderInfo *hi = 0);
   virtual bool compareHeaders(const uint8_t *hdr1, const uint8_t *hdr2);
   virtual std::string getHeaderInfo(const uint8_t *hdr);
+  virtual uint32_t addSyncs(SyncScan &scan) const;
+
+  /////////////////////////////////////////////////////////
+  // Dispatch statistics
+
+  const MultiHeaderStats &getStats(void) const
+  {
+    return f_stats;
+  }
+
+  void resetStats(void)
+  {
+    f_stats.reset();
+  }
 
 private:
   void zeroSizes(void);
   void initSizes(void);
+  void initDispatch(void);
+  int findParser(const uint8_t *hdr, HeaderInfo *hi, bool stats);
 
   typedef std::vector<HeaderParser*> HeaderParserVec;
   HeaderParserVec parserVec;
   HeaderParser *currentParser;
+  int currentIndex;
   bool iOwnParsers;
   size_t f_header_size;
   size_t f_min_frame_size;
   size_t f_max_frame_size;
+
+  // Dispatch table: syncpoints of all parsers and syncpoints
+  // of each parser (0 - the parser is called for each header)
+
+  SyncScan f_scan;
+  std::vector<uint32_t> f_syncs;
+  MultiHeaderStats f_stats;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -778,6 +884,7 @@ protected:
   ReadBS    bs;         // Bitstream reader
 
   int block;
+  uint16_t dither_state; // dither generator state (seeded by each frame)
 
   bool startParse(uint8_t *frame, size_t size);
   bool checkCrc(void);
@@ -869,6 +976,14 @@ public:
   virtual bool parseHeader(const uint8_t *hdr, HeaderInfo *hi = 0);
   virtual bool compareHeaders(const uint8_t *hdr1, const uint8_t *hdr2);
 
+  // SPDIF header starts with zero words before the
+  // burst preamble
+  virtual uint32_t addSyncs(SyncScan &scan) const
+  {
+    scan.setStandard(SYNCMASK_SPDIF0);
+    return SYNCMASK_SPDIF0;
+  }
+
   virtual std::string getHeaderInfo(const uint8_t *hdr);
 };
 
@@ -956,19 +1071,32 @@ public:
 // =========================
 //
 // StreamBuffer uses 3-point syncronization. This means that we need buffer
-// space for 2 full frames and 1 header more. Also, we need some space for a
-// copy of a header to load each frame.
+// space for 2 full frames and 1 header more.
 //
-// +-- header pointer
-// V
-// +--------------+-----------------------+-----------------------+---------+
-// | Header1 copy | Frame1                | Frame2                | Header3 |
-// +--------------+-----------------------+-----------------------+---------+
-//                ^
-//                +-- frame pointer
+// +-----------------------+-----------------------+---------+
+// | Frame1                | Frame2                | Header3 |
+// +-----------------------+-----------------------+---------+
+// ^
+// +-- frame pointer
 //
 // And total buffer size equals to:
-// buffer_size = max_frame_size * 2 + header_size * 2;
+// buffer_size = max_frame_size * 2 + header_size;
+//
+// Zero-copy loading
+// =================
+//
+// Data is copied into the internal buffer only when it is required: during
+// the syncronization and for frames that cross the boundary of the input
+// buffer. When the stream is in sync, nothing is buffered and the next
+// BITSTREAM_8 frame lies entirely in the input buffer, debris and frame
+// pointers point directly into the input buffer. So input data must stay
+// unchanged until the next load() call. getBufferSize() counts only the data
+// buffered.
+//
+// Aliasing contract: a frame loaded directly is a part of the input and must
+// be treated as read-only. Frame parsers convert frames of other bitstream
+// types (16bit LE, 14bit, SPDIF) to BITSTREAM_8 in place, so such frames are
+// always copied into the internal buffer and never alias the input.
 //
 // Important note!!!
 // =================
@@ -1012,6 +1140,63 @@ public:
 // recommended to demux SPDIF stream before working with the contained stream.
 // We can demux SPDIF stream correctly because SPDIF header contains real
 // frame size of the contained stream.
+//
+// Sync statistics
+// ===============
+//
+// StreamBuffer counts its syncronization work in SyncStats, the caller may
+// poll it with getSyncStats() or set a SyncCallback to be notified when the
+// sync is found or lost. Statistics are not cleared by reset(), use
+// resetSyncStats().
+
+///////////////////////////////////////////////////////////////////////////////
+// SyncStats - syncronization statistics collected by StreamBuffer
+//
+// candidates   - positions checked with the header parser during sync
+// false_syncs  - valid headers that did not start a valid sync sequence
+// syncs        - number of times the sync was found (new streams)
+// resyncs      - number of times the sync was lost
+// debris_bytes - data returned as debris (out of sync, before and between
+//                frames)
+// sync_time    - wall clock time spent on syncronization (seconds)
+
+struct SyncStats
+{
+  uint64_t candidates;
+  uint64_t false_syncs;
+  uint64_t syncs;
+  uint64_t resyncs;
+  uint64_t debris_bytes;
+  vtime_t  sync_time;
+
+  SyncStats()
+  {
+    reset();
+  }
+
+  void reset(void)
+  {
+    candidates = 0;
+    false_syncs = 0;
+    syncs = 0;
+    resyncs = 0;
+    debris_bytes = 0;
+    sync_time = 0;
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// SyncCallback - sync state notifications
+// Called from load() with the statistics updated.
+
+class SyncCallback
+{
+public:
+  enum { sync_found, sync_lost };
+
+  virtual ~SyncCallback() {}
+  virtual void onSync(int event, const SyncStats &stats) = 0;
+};
 
 class StreamBuffer
 {
@@ -1117,11 +1302,44 @@ public:
     return _hinfo;
   }
 
+  /////////////////////////////////////////////////////////
+  // Sync statistics
+
+  const SyncStats &getSyncStats(void) const
+  {
+    return _stats;
+  }
+
+  void resetSyncStats(void)
+  {
+    _stats.reset();
+  }
+
+  void setSyncCallback(SyncCallback *callback)
+  {
+    _callback = callback;
+  }
+
+  SyncCallback *getSyncCallback(void) const
+  {
+    return _callback;
+  }
+
 private:
   bool loadBuffer(uint8_t **data, uint8_t *end, size_t required_size);
   void dropBuffer(size_t size);
+  bool sync(uint8_t **data, uint8_t *data_end);
   bool reSync(uint8_t **data, uint8_t *data_end);
   bool load(uint8_t **data, uint8_t *end);
+  bool loadDirect(uint8_t **data, uint8_t *end);
+  void unloadBuffer(uint8_t **data, uint8_t *start);
+  void setFrame(uint8_t *debris_ptr, uint8_t *frame_ptr, const HeaderInfo &hi);
+  uint8_t *findSync(uint8_t *pos, uint8_t *pos_max, uint8_t *data_end) const;
+
+  uint8_t *findSync(uint8_t *pos, uint8_t *pos_max) const
+  {
+    return findSync(pos, pos_max, _sync.ptr + _sync.dataSize);
+  }
 
   // Parser info (constant)
 
@@ -1130,16 +1348,20 @@ private:
   size_t _minFrameSize; // cached min frame size
   size_t _maxFrameSize; // cached max frame size
 
+  // Syncpoints of the parser. Positions that do not start
+  // with a syncpoint are skipped without header parsing.
+
+  SyncScan _scan; // syncpoint scanner
+  uint32_t _syncMask; // syncpoints set (0 - check each position)
+
   // Buffers
   // We need a header of a previous frame to load next one, but frame data of
   // the frame loaded may be changed by in-place frame processing. Therefore
-  // we have to keep a copy of the header. So we need 2 buffers: header buffer
-  // and sync buffer. Header buffer size is always header_size.
+  // we keep the parsed header info of the frame, not the frame data.
 
   UInt8Buf _buf;
 
-  uint8_t *_headerBuf; // header buffer pointer
-  HeaderInfo _hinfo; // header info (parsed header buffer)
+  HeaderInfo _hinfo; // header info of the frame loaded
 
   struct Sync
   {
@@ -1173,6 +1395,11 @@ private:
 
   bool _isInSync; // we're in sync with the stream
   bool _isNewStream; // frame loaded belongs to a new stream
+
+  // Statistics
+
+  SyncStats _stats;
+  SyncCallback *_callback;
 };
 
 }; // namespace AudioFilter
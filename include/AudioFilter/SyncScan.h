@@ -398,11 +398,34 @@
   13    DTS16 low endian
   14    DTS14 big endian
   15    DTS14 low endian
-  16-31 reserved (planned: SPDIF syncpoints, MPEG Program Stream)
+  16    SPDIF burst preamble (Pa Pb)
+  17    MPEG Program Stream
+  18    DTS-HD substream header
+  19    SPDIF header start (zero words before the burst preamble)
+  20-31 reserved
 
   Standard syncpoints are defined with most complex error checking possible,
   so it is preferrable to use functionality provided by this module rather than
   define own syncpoints.
+
+  -----------------------------------------------------------------------------
+  VECTOR SCANNER
+  -----------------------------------------------------------------------------
+
+  Table lookups cannot be vectorized, but the set of allowed values of a
+  syncpoint byte usually can be described by a few value/mask pairs (AC3
+  first byte: 0x0b or 0x77, MPA first byte: 0xff or 0xfn, etc). So the
+  vector scanner checks 16 (SSE2) or 32 (AVX2) positions at once against the
+  value/mask pairs of the two most selective bytes of the syncword (the
+  prefilter) and does the table lookup only at the positions passed. AVX2
+  classifies bytes by nibble lookup tables instead, which costs the same for
+  any set of values. The prefilter is built from the synctable after each
+  table change. When all bytes allow all values, or SSE2 needs too many
+  pairs (MPA syncwords), the scalar scanner is used.
+
+  Implementation is selected at runtime by CPU features. All implementations
+  give exactly the same result (bytes gone, syncword and internal buffer
+  state), set_impl() may force an implementation for testing.
 */
 
 #include "Defs.h"
@@ -425,6 +448,8 @@ namespace AudioFilter {
 
 #define SYNC_SPDIF    16
 #define SYNC_PS       17
+#define SYNC_DTSHD    18
+#define SYNC_SPDIF0   19
 
 ///////////////////////////////////////////////////////////
 // Syncpoint masks
@@ -447,6 +472,30 @@ namespace AudioFilter {
 
 #define SYNCMASK_SPDIF    0x10000
 #define SYNCMASK_PS       0x20000
+#define SYNCMASK_DTSHD    0x40000
+#define SYNCMASK_SPDIF0   0x80000
+
+///////////////////////////////////////////////////////////
+// Prefilter of the vector scanner for byte 'pos' of the
+// syncword. The byte may be allowed when:
+// SSE2: (byte & mask[i]) == value[i] for some pair i
+// AVX2: (hi[byte >> 4] & lo[byte & 15]) != 0
+//
+// max_pairs  - max number of pairs of a byte
+// auto_pairs - max number of pairs of all bytes when SSE2
+//              is faster than the scalar scanner
+
+struct SyncPrefilter
+{
+  enum { max_pairs = 8, auto_pairs = 6 };
+
+  int     pos;
+  int     npairs;
+  uint8_t value[max_pairs];
+  uint8_t mask[max_pairs];
+  uint8_t lo[16];
+  uint8_t hi[16];
+};
 
 ///////////////////////////////////////////////////////////
 // SyncScan class
@@ -487,13 +536,37 @@ public:
   /////////////////////////////////////////////////////////
   // External buffer mode interface
 
-  uint32_t getSync(uint8_t *buf) const;
+  uint32_t getSync(const uint8_t *buf) const;
   size_t scan(uint8_t *syncword, uint8_t *buf, size_t size) const;
 
+  /////////////////////////////////////////////////////////
+  // Scanner implementation
+  //
+  // setImpl() returns false if the CPU does not support the
+  // implementation. getImpl() returns the implementation
+  // actually used by scan() (scalar when the synctable has
+  // no usable prefilter).
+
+  enum { impl_auto, impl_scalar, impl_sse2, impl_avx2 };
+
+  bool setImpl(int _impl);
+  int  getImpl(void) const;
+
+  static bool isImplSupported(int _impl);
+
 private:
   typedef uint32_t synctbl_t;
   synctbl_t *synctable;
 
+  int impl;
+  int nfilters;
+  int npairs; // pairs of all filters, 0 when SSE2 prefilter is not usable
+  SyncPrefilter filter[2];
+
+  void updateFilter(void);
+  size_t scanScalar(uint8_t *syncword, uint8_t *buf, size_t size) const;
+  size_t scanVector(uint8_t *syncword, uint8_t *buf, size_t size, int vector_impl) const;
+
 };
 
 }; // namespace AudioFilter
@@ -6,7 +6,12 @@
 
 namespace AudioFilter {
 
-// inline vtime_t cpu_time();          // total CPU time used by this thread
+///////////////////////////////////////////////////////////////////////////////
+// Precise clocks for time measurements (seconds from an arbitrary point).
+// Use the difference between two calls only.
+
+vtime_t getWallClock(void); // monotonic wall clock
+vtime_t getCpuTime(void);   // total CPU time used by this thread
 
 ///////////////////////////////////////////////////////////////////////////////
 // This functions return the number of seconds elapsed since midnight
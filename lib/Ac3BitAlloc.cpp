@@ -1,7 +1,9 @@
 // Reference bit allocation
 // as it described in standard
 
-#include "ac3_bitalloc.h"
+#include "Ac3BitAlloc.h"
+
+namespace AudioFilter {
 
 #define DELTA_BIT_REUSE    0
 #define DELTA_BIT_NEW      1
@@ -318,3 +320,7 @@ const uint8_t baptab[64] =
   14, 14, 14, 14, 14, 14, 14, 15, 
   15, 15, 15, 15, 15, 15, 15, 15
 };
+
+}; // namespace AudioFilter
+
+// vim: ts=2 sts=2 et
@@ -6,7 +6,11 @@
 
 namespace AudioFilter {
 
-inline int16_t genDither(void)
+// Dither generator (16-bit LFSR, 8 steps per call by the table).
+// The state belongs to the caller, so each decoder has its own sequence.
+// State 0 is a fixed point of the generator and must not be used.
+
+inline int16_t genDither(uint16_t &lfsr_state)
 {
   static const uint16_t dither_lut[256] = {
       0x0000, 0xa011, 0xe033, 0x4022, 0x6077, 0xc066, 0x8044, 0x2055,
@@ -43,7 +47,6 @@ inline int16_t genDither(void)
       0x8bf4, 0x2be5, 0x6bc7, 0xcbd6, 0xeb83, 0x4b92, 0x0bb0, 0xaba1
   };
 
-  static uint16_t lfsr_state = 1;
   int16_t state;
 
   state = dither_lut[lfsr_state >> 8] ^ (lfsr_state << 8);
@@ -52,6 +55,69 @@ inline int16_t genDither(void)
   return state;
 }
 
+// Generator advanced by 4 steps at once. The generator is linear, so the
+// state 4 steps on is the xor of the results for its high and low bytes.
+
+struct DitherJump
+{
+  uint16_t hi[256];
+  uint16_t lo[256];
+
+  DitherJump()
+  {
+    for ( int i = 0; i < 256; i++ )
+    {
+      uint16_t s_hi = uint16_t(i << 8);
+      uint16_t s_lo = uint16_t(i);
+
+      for ( int step = 0; step < 4; step++ )
+      {
+        genDither(s_hi);
+        genDither(s_lo);
+      }
+
+      hi[i] = s_hi;
+      lo[i] = s_lo;
+    }
+  }
+};
+
+// Fills n dither values (the same sequence as n genDither() calls).
+// 4 interleaved states are advanced by the jump table, so a value does
+// not wait for the one before.
+
+inline void genDither(uint16_t &lfsr_state, int16_t *out, size_t n)
+{
+  static const DitherJump jump;
+  size_t i = 0;
+
+  if ( n >= 8 )
+  {
+    uint16_t s0, s1, s2, s3;
+    out[0] = genDither(lfsr_state); s0 = lfsr_state;
+    out[1] = genDither(lfsr_state); s1 = lfsr_state;
+    out[2] = genDither(lfsr_state); s2 = lfsr_state;
+    out[3] = genDither(lfsr_state); s3 = lfsr_state;
+
+    for ( i = 4; i + 4 <= n; i += 4 )
+    {
+      s0 = jump.hi[s0 >> 8] ^ jump.lo[s0 & 0xff];
+      s1 = jump.hi[s1 >> 8] ^ jump.lo[s1 & 0xff];
+      s2 = jump.hi[s2 >> 8] ^ jump.lo[s2 & 0xff];
+      s3 = jump.hi[s3 >> 8] ^ jump.lo[s3 & 0xff];
+      out[i + 0] = int16_t(s0);
+      out[i + 1] = int16_t(s1);
+      out[i + 2] = int16_t(s2);
+      out[i + 3] = int16_t(s3);
+    }
+
+    lfsr_state = s3;
+  }
+
+  for ( ; i < n; i++ )
+    out[i] = genDither(lfsr_state);
+}
+
 }; // namespace AudioFilter
 
 #endif
@@ -32,13 +32,15 @@ namespace AudioFilter {
 class Quantizer
 {
 protected:
+  // Groups being read: next mantissa of the group and mantissas left
+  const sample_t *q3;
+  const sample_t *q5;
+  const sample_t *q11;
   int q3_cnt, q5_cnt, q11_cnt;
-  sample_t q3[2];
-  sample_t q5[2];
-  sample_t q11;
+  uint16_t &dither_state;
 
 public:
-  Quantizer(): q3_cnt(0), q5_cnt(0), q11_cnt(0) {};
+  Quantizer(uint16_t &_dither_state): q3(0), q5(0), q11(0), q3_cnt(0), q5_cnt(0), q11_cnt(0), dither_state(_dither_state) {};
 
   void getCoeff(ReadBS &bs, sample_t *s, int8_t *bap, int8_t *exp, int n, bool dither);
 };
@@ -86,6 +88,7 @@ void Ac3Parser::reset(void)
   bs_type = 0;
 
   block = 0;
+  dither_state = 1;
   samples.zero();
   delay.zero();
 }
@@ -171,8 +174,15 @@ bool Ac3Parser::startParse(uint8_t *_frame, size_t _size)
   if ( hinfo.getFrameSize() > _size )
     return false;
 
-  spk = hinfo.getSpeakers();
-  spk.setLinear();
+  Speakers new_spk = hinfo.getSpeakers();
+  new_spk.setLinear();
+
+  // Overlap of another channel layout is not continued: channels missing
+  // from the frames between would add stale samples decoded long ago.
+  if ( new_spk != spk )
+    delay.zero();
+
+  spk = new_spk;
   frame = _frame;
   frame_size = hinfo.getFrameSize();
   bs_type = hinfo.getBsType();
@@ -184,6 +194,13 @@ bool Ac3Parser::startParse(uint8_t *_frame, size_t _size)
   if ( do_crc && ! checkCrc() )
       return false;
 
+  // Dither sequence is restarted at each frame from the frame's crc1, so
+  // the output of a frame does not depend on the frames decoded before.
+  dither_state = uint16_t((frame[2] << 8) | frame[3]);
+
+  if ( ! dither_state )
+    dither_state = 1;
+
   bs.set(frame, 0, frame_size * 8);
   return true;
 }
@@ -970,7 +987,7 @@ bool Ac3Parser::parseDeltba(int8_t *deltba)
 void Ac3Parser::parseCoeff(samples_t samples)
 {
   int s;
-  Quantizer q;
+  Quantizer q(dither_state);
 
   int nfchans = nfchans_tbl[acmod];
   bool got_cplchan = false;
@@ -1005,15 +1022,23 @@ void Ac3Parser::parseCoeff(samples_t samples)
   }
 
   // Dither
+  int dither_pos[256];
+  int16_t dither[256];
+  int ndither = 0;
+
+  if ( got_cplchan )
+    for ( s = cplstrtmant; s < cplendmant; ++s )
+      if ( ! cplbap[s] )
+        dither_pos[ndither++] = s;
+
   for ( int ch = 0; ch < nfchans; ++ch )
   {
-    if ( chincpl[ch] && dithflag[ch] )
+    if ( chincpl[ch] && dithflag[ch] && ndither )
     {
-      for ( s = cplstrtmant; s < cplendmant; ++s )
-      {
-        if ( ! cplbap[s] )
-          samples[ch][s] = genDither() * scale_factor[cplexps[s]];
-      }
+      genDither(dither_state, dither, ndither);
+
+      for ( int i = 0; i < ndither; ++i )
+        samples[ch][dither_pos[i]] = dither[i] * scale_factor[cplexps[dither_pos[i]]];
     }
   }
 
@@ -1076,86 +1101,132 @@ void Ac3Parser::parseCoeff(samples_t samples)
   }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Mantissa decoding
+//
+// A run of mantissas is decoded in 3 passes:
+// * unpack: bitstream codes to mantissas, a grouped code gives all mantissas
+//   of its group from one table row;
+// * dither: zero-bit mantissas to dither, drawn for the whole run at once;
+// * scale: mantissas to coefficients by the exponents.
+
+// Mantissa bits by bap (group bits for bap 1, 2 and 4)
+static const int mant_bits_tbl[16] = { 0, 5, 7, 3, 7, 4, 5, 6, 7, 8, 9, 10, 11, 12, 14, 16 };
+
+#if defined(__GNUC__)
+// 16-byte vector, may be unaligned
+typedef sample_t coeff_vec_t __attribute__((vector_size(16), aligned(sizeof(sample_t))));
+#endif
+
+static void scaleCoeff(sample_t *s, const int8_t *exp, int n)
+{
+  int i = 0;
+
+#if defined(__GNUC__) && ! defined(FLOAT_SAMPLE)
+  for ( ; i + 2 <= n; i += 2 )
+  {
+    const coeff_vec_t scale = { scale_factor[exp[i]], scale_factor[exp[i + 1]] };
+    *(coeff_vec_t *)(s + i) *= scale;
+  }
+#elif defined(__GNUC__)
+  for ( ; i + 4 <= n; i += 4 )
+  {
+    const coeff_vec_t scale = { scale_factor[exp[i]], scale_factor[exp[i + 1]], scale_factor[exp[i + 2]], scale_factor[exp[i + 3]] };
+    *(coeff_vec_t *)(s + i) *= scale;
+  }
+#endif
+
+  for ( ; i < n; ++i )
+    s[i] *= scale_factor[exp[i]];
+}
+
 void Quantizer::getCoeff(ReadBS &bs, sample_t *s, int8_t *bap, int8_t *exp, int n, bool dither)
 {
-  while ( n-- )
+  int dither_pos[256];
+  int ndither = 0;
+
+  /////////////////////////////////////////////////////////
+  // Unpack
+
+  for ( int i = 0; i < n; ++i )
   {
-    int ibap = *bap++;
+    const int ibap = bap[i];
 
     switch ( ibap )
     {
       case 0:
+        s[i] = 0;
         if ( dither )
-          *s++ = genDither() * scale_factor[*exp++];
-        else
-        {
-          *s++ = 0;
-          exp++;
-        }
+          dither_pos[ndither++] = i;
         break;
 
       case 1:
         // 3-levels 3 values in 5 bits
-        if ( q3_cnt-- )
-          *s++ = q3[q3_cnt] * scale_factor[*exp++];
-        else
+        if ( ! q3_cnt )
         {
-          int code = bs.get(5);
-          q3[0] = q3_3_tbl[code];
-          q3[1] = q3_2_tbl[code];
-          q3_cnt = 2;
-          *s++ = q3_1_tbl[code] * scale_factor[*exp++];
+          q3 = q3_group_tbl[bs.get(5)];
+          q3_cnt = 3;
         }
+        s[i] = *q3++;
+        q3_cnt--;
         break;
 
       case 2:
         // 5-levels 3 values in 7 bits
-        if ( q5_cnt-- )
-          *s++ = q5[q5_cnt] * scale_factor[*exp++];
-        else
+        if ( ! q5_cnt )
         {
-          int code = bs.get(7);
-          q5[0] = q5_3_tbl[code];
-          q5[1] = q5_2_tbl[code];
-          q5_cnt = 2;
-          *s++ = q5_1_tbl[code] * scale_factor[*exp++];
+          q5 = q5_group_tbl[bs.get(7)];
+          q5_cnt = 3;
         }
+        s[i] = *q5++;
+        q5_cnt--;
         break;
 
       case 3:
-        *s++ = q7_tbl[bs.get(3)] * scale_factor[*exp++];
+        s[i] = q7_tbl[bs.get(3)];
         break;
 
       case 4:
         // 11-levels 2 values in 7 bits
-        if ( q11_cnt-- )
-          *s++ = q11 * scale_factor[*exp++];
-        else
+        if ( ! q11_cnt )
         {
-          int code = bs.get(7);
-          q11 = q11_2_tbl[code];
-          q11_cnt = 1;
-          *s++ = q11_1_tbl[code] * scale_factor[*exp++];
+          q11 = q11_group_tbl[bs.get(7)];
+          q11_cnt = 2;
         }
+        s[i] = *q11++;
+        q11_cnt--;
         break;
 
       case 5:
-        *s++ = q15_tbl[bs.get(4)] * scale_factor[*exp++];
-        break;
-
-      case 14:
-        *s++ = (bs.getSigned(14) << 2) * scale_factor[*exp++];
-        break;
-
-      case 15:
-        *s++ = bs.getSigned(16) * scale_factor[*exp++];
+        s[i] = q15_tbl[bs.get(4)];
         break;
 
       default:
-        *s++ = (bs.getSigned(ibap - 1) << (16 - (ibap - 1))) * scale_factor[*exp++];
+      {
+        // asymmetric quantization, 16-bit fixed point
+        const int bits = mant_bits_tbl[ibap & 15];
+        s[i] = sample_t(bs.getSigned(bits) << (16 - bits));
         break;
+      }
     }
   }
+
+  /////////////////////////////////////////////////////////
+  // Dither
+
+  if ( ndither )
+  {
+    int16_t d[256];
+    genDither(dither_state, d, ndither);
+
+    for ( int i = 0; i < ndither; ++i )
+      s[dither_pos[i]] = d[i];
+  }
+
+  /////////////////////////////////////////////////////////
+  // Scale
+
+  scaleCoeff(s, exp, n);
 }
 
 }; // namespace AudioFilter
@@ -204,29 +204,37 @@ const sample_t q15_tbl[15] =
   sample_t(+14 << 15) / 15
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// Grouped mantissa tables
+//
+// Used in: Quantizer::getCoeff() (decoding of grouped mantissas)
+// Mnemonics: mant[i] = qx_group_tbl[code][i]
+// Definition:
+//   q3_group_tbl[code]  = { q3_tbl[code / 9],   q3_tbl[code / 3 % 3],  q3_tbl[code % 3] }
+//   q5_group_tbl[code]  = { q5_tbl[code / 25],  q5_tbl[code / 5 % 5],  q5_tbl[code % 5] }
+//   q11_group_tbl[code] = { q11_tbl[code / 11], q11_tbl[code % 11] }
+// Usage:
+//   A group code gives all mantissas of the group at once (3 mantissas for
+//   bap 1 and 2, 2 mantissas for bap 4), in bitstream order. Codes out of
+//   range give zeros.
+
 #define Q0 ((-2 << 15) / 3.0)
 #define Q1 (0)
 #define Q2 ((2 << 15) / 3.0)
 
-const sample_t q3_1_tbl[32] = {
-    Q0,Q0,Q0,Q0,Q0,Q0,Q0,Q0,Q0,
-    Q1,Q1,Q1,Q1,Q1,Q1,Q1,Q1,Q1,
-    Q2,Q2,Q2,Q2,Q2,Q2,Q2,Q2,Q2,
-    0,0,0,0,0
-};
-
-const sample_t q3_2_tbl[32] = {
-    Q0,Q0,Q0,Q1,Q1,Q1,Q2,Q2,Q2,
-    Q0,Q0,Q0,Q1,Q1,Q1,Q2,Q2,Q2,
-    Q0,Q0,Q0,Q1,Q1,Q1,Q2,Q2,Q2,
-    0,0,0,0,0
-};
-
-const sample_t q3_3_tbl[32] = {
-    Q0,Q1,Q2,Q0,Q1,Q2,Q0,Q1,Q2,
-    Q0,Q1,Q2,Q0,Q1,Q2,Q0,Q1,Q2,
-    Q0,Q1,Q2,Q0,Q1,Q2,Q0,Q1,Q2,
-    0,0,0,0,0
+const sample_t q3_group_tbl[32][3] =
+{
+  { Q0, Q0, Q0 }, { Q0, Q0, Q1 }, { Q0, Q0, Q2 },
+  { Q0, Q1, Q0 }, { Q0, Q1, Q1 }, { Q0, Q1, Q2 },
+  { Q0, Q2, Q0 }, { Q0, Q2, Q1 }, { Q0, Q2, Q2 },
+  { Q1, Q0, Q0 }, { Q1, Q0, Q1 }, { Q1, Q0, Q2 },
+  { Q1, Q1, Q0 }, { Q1, Q1, Q1 }, { Q1, Q1, Q2 },
+  { Q1, Q2, Q0 }, { Q1, Q2, Q1 }, { Q1, Q2, Q2 },
+  { Q2, Q0, Q0 }, { Q2, Q0, Q1 }, { Q2, Q0, Q2 },
+  { Q2, Q1, Q0 }, { Q2, Q1, Q1 }, { Q2, Q1, Q2 },
+  { Q2, Q2, Q0 }, { Q2, Q2, Q1 }, { Q2, Q2, Q2 },
+  { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 },
+  { 0, 0, 0 }, { 0, 0, 0 }
 };
 
 #undef Q0
@@ -239,31 +247,51 @@ const sample_t q3_3_tbl[32] = {
 #define Q3 ((2 << 15) / 5.0)
 #define Q4 ((4 << 15) / 5.0)
 
-static const sample_t q5_1_tbl[128] = {
-    Q0,Q0,Q0,Q0,Q0,Q0,Q0,Q0,Q0,Q0,Q0,Q0,Q0,Q0,Q0,Q0,Q0,Q0,Q0,Q0,Q0,Q0,Q0,Q0,Q0,
-    Q1,Q1,Q1,Q1,Q1,Q1,Q1,Q1,Q1,Q1,Q1,Q1,Q1,Q1,Q1,Q1,Q1,Q1,Q1,Q1,Q1,Q1,Q1,Q1,Q1,
-    Q2,Q2,Q2,Q2,Q2,Q2,Q2,Q2,Q2,Q2,Q2,Q2,Q2,Q2,Q2,Q2,Q2,Q2,Q2,Q2,Q2,Q2,Q2,Q2,Q2,
-    Q3,Q3,Q3,Q3,Q3,Q3,Q3,Q3,Q3,Q3,Q3,Q3,Q3,Q3,Q3,Q3,Q3,Q3,Q3,Q3,Q3,Q3,Q3,Q3,Q3,
-    Q4,Q4,Q4,Q4,Q4,Q4,Q4,Q4,Q4,Q4,Q4,Q4,Q4,Q4,Q4,Q4,Q4,Q4,Q4,Q4,Q4,Q4,Q4,Q4,Q4,
-    0,0,0
-};
-
-static const sample_t q5_2_tbl[128] = {
-    Q0,Q0,Q0,Q0,Q0,Q1,Q1,Q1,Q1,Q1,Q2,Q2,Q2,Q2,Q2,Q3,Q3,Q3,Q3,Q3,Q4,Q4,Q4,Q4,Q4,
-    Q0,Q0,Q0,Q0,Q0,Q1,Q1,Q1,Q1,Q1,Q2,Q2,Q2,Q2,Q2,Q3,Q3,Q3,Q3,Q3,Q4,Q4,Q4,Q4,Q4,
-    Q0,Q0,Q0,Q0,Q0,Q1,Q1,Q1,Q1,Q1,Q2,Q2,Q2,Q2,Q2,Q3,Q3,Q3,Q3,Q3,Q4,Q4,Q4,Q4,Q4,
-    Q0,Q0,Q0,Q0,Q0,Q1,Q1,Q1,Q1,Q1,Q2,Q2,Q2,Q2,Q2,Q3,Q3,Q3,Q3,Q3,Q4,Q4,Q4,Q4,Q4,
-    Q0,Q0,Q0,Q0,Q0,Q1,Q1,Q1,Q1,Q1,Q2,Q2,Q2,Q2,Q2,Q3,Q3,Q3,Q3,Q3,Q4,Q4,Q4,Q4,Q4,
-    0,0,0
-};
-
-static const sample_t q5_3_tbl[128] = {
-    Q0,Q1,Q2,Q3,Q4,Q0,Q1,Q2,Q3,Q4,Q0,Q1,Q2,Q3,Q4,Q0,Q1,Q2,Q3,Q4,Q0,Q1,Q2,Q3,Q4,
-    Q0,Q1,Q2,Q3,Q4,Q0,Q1,Q2,Q3,Q4,Q0,Q1,Q2,Q3,Q4,Q0,Q1,Q2,Q3,Q4,Q0,Q1,Q2,Q3,Q4,
-    Q0,Q1,Q2,Q3,Q4,Q0,Q1,Q2,Q3,Q4,Q0,Q1,Q2,Q3,Q4,Q0,Q1,Q2,Q3,Q4,Q0,Q1,Q2,Q3,Q4,
-    Q0,Q1,Q2,Q3,Q4,Q0,Q1,Q2,Q3,Q4,Q0,Q1,Q2,Q3,Q4,Q0,Q1,Q2,Q3,Q4,Q0,Q1,Q2,Q3,Q4,
-    Q0,Q1,Q2,Q3,Q4,Q0,Q1,Q2,Q3,Q4,Q0,Q1,Q2,Q3,Q4,Q0,Q1,Q2,Q3,Q4,Q0,Q1,Q2,Q3,Q4,
-    0,0,0
+const sample_t q5_group_tbl[128][3] =
+{
+  { Q0, Q0, Q0 }, { Q0, Q0, Q1 }, { Q0, Q0, Q2 },
+  { Q0, Q0, Q3 }, { Q0, Q0, Q4 }, { Q0, Q1, Q0 },
+  { Q0, Q1, Q1 }, { Q0, Q1, Q2 }, { Q0, Q1, Q3 },
+  { Q0, Q1, Q4 }, { Q0, Q2, Q0 }, { Q0, Q2, Q1 },
+  { Q0, Q2, Q2 }, { Q0, Q2, Q3 }, { Q0, Q2, Q4 },
+  { Q0, Q3, Q0 }, { Q0, Q3, Q1 }, { Q0, Q3, Q2 },
+  { Q0, Q3, Q3 }, { Q0, Q3, Q4 }, { Q0, Q4, Q0 },
+  { Q0, Q4, Q1 }, { Q0, Q4, Q2 }, { Q0, Q4, Q3 },
+  { Q0, Q4, Q4 }, { Q1, Q0, Q0 }, { Q1, Q0, Q1 },
+  { Q1, Q0, Q2 }, { Q1, Q0, Q3 }, { Q1, Q0, Q4 },
+  { Q1, Q1, Q0 }, { Q1, Q1, Q1 }, { Q1, Q1, Q2 },
+  { Q1, Q1, Q3 }, { Q1, Q1, Q4 }, { Q1, Q2, Q0 },
+  { Q1, Q2, Q1 }, { Q1, Q2, Q2 }, { Q1, Q2, Q3 },
+  { Q1, Q2, Q4 }, { Q1, Q3, Q0 }, { Q1, Q3, Q1 },
+  { Q1, Q3, Q2 }, { Q1, Q3, Q3 }, { Q1, Q3, Q4 },
+  { Q1, Q4, Q0 }, { Q1, Q4, Q1 }, { Q1, Q4, Q2 },
+  { Q1, Q4, Q3 }, { Q1, Q4, Q4 }, { Q2, Q0, Q0 },
+  { Q2, Q0, Q1 }, { Q2, Q0, Q2 }, { Q2, Q0, Q3 },
+  { Q2, Q0, Q4 }, { Q2, Q1, Q0 }, { Q2, Q1, Q1 },
+  { Q2, Q1, Q2 }, { Q2, Q1, Q3 }, { Q2, Q1, Q4 },
+  { Q2, Q2, Q0 }, { Q2, Q2, Q1 }, { Q2, Q2, Q2 },
+  { Q2, Q2, Q3 }, { Q2, Q2, Q4 }, { Q2, Q3, Q0 },
+  { Q2, Q3, Q1 }, { Q2, Q3, Q2 }, { Q2, Q3, Q3 },
+  { Q2, Q3, Q4 }, { Q2, Q4, Q0 }, { Q2, Q4, Q1 },
+  { Q2, Q4, Q2 }, { Q2, Q4, Q3 }, { Q2, Q4, Q4 },
+  { Q3, Q0, Q0 }, { Q3, Q0, Q1 }, { Q3, Q0, Q2 },
+  { Q3, Q0, Q3 }, { Q3, Q0, Q4 }, { Q3, Q1, Q0 },
+  { Q3, Q1, Q1 }, { Q3, Q1, Q2 }, { Q3, Q1, Q3 },
+  { Q3, Q1, Q4 }, { Q3, Q2, Q0 }, { Q3, Q2, Q1 },
+  { Q3, Q2, Q2 }, { Q3, Q2, Q3 }, { Q3, Q2, Q4 },
+  { Q3, Q3, Q0 }, { Q3, Q3, Q1 }, { Q3, Q3, Q2 },
+  { Q3, Q3, Q3 }, { Q3, Q3, Q4 }, { Q3, Q4, Q0 },
+  { Q3, Q4, Q1 }, { Q3, Q4, Q2 }, { Q3, Q4, Q3 },
+  { Q3, Q4, Q4 }, { Q4, Q0, Q0 }, { Q4, Q0, Q1 },
+  { Q4, Q0, Q2 }, { Q4, Q0, Q3 }, { Q4, Q0, Q4 },
+  { Q4, Q1, Q0 }, { Q4, Q1, Q1 }, { Q4, Q1, Q2 },
+  { Q4, Q1, Q3 }, { Q4, Q1, Q4 }, { Q4, Q2, Q0 },
+  { Q4, Q2, Q1 }, { Q4, Q2, Q2 }, { Q4, Q2, Q3 },
+  { Q4, Q2, Q4 }, { Q4, Q3, Q0 }, { Q4, Q3, Q1 },
+  { Q4, Q3, Q2 }, { Q4, Q3, Q3 }, { Q4, Q3, Q4 },
+  { Q4, Q4, Q0 }, { Q4, Q4, Q1 }, { Q4, Q4, Q2 },
+  { Q4, Q4, Q3 }, { Q4, Q4, Q4 }, { 0, 0, 0 },
+  { 0, 0, 0 }, { 0, 0, 0 }
 };
 
 #undef Q0
@@ -284,34 +312,40 @@ static const sample_t q5_3_tbl[128] = {
 #define Q9 ((8 << 15) / 11.0)
 #define QA ((10 << 15) / 11.0)
 
-static const sample_t q11_1_tbl[128] = {
-    Q0, Q0, Q0, Q0, Q0, Q0, Q0, Q0, Q0, Q0, Q0,
-    Q1, Q1, Q1, Q1, Q1, Q1, Q1, Q1, Q1, Q1, Q1,
-    Q2, Q2, Q2, Q2, Q2, Q2, Q2, Q2, Q2, Q2, Q2,
-    Q3, Q3, Q3, Q3, Q3, Q3, Q3, Q3, Q3, Q3, Q3,
-    Q4, Q4, Q4, Q4, Q4, Q4, Q4, Q4, Q4, Q4, Q4,
-    Q5, Q5, Q5, Q5, Q5, Q5, Q5, Q5, Q5, Q5, Q5,
-    Q6, Q6, Q6, Q6, Q6, Q6, Q6, Q6, Q6, Q6, Q6,
-    Q7, Q7, Q7, Q7, Q7, Q7, Q7, Q7, Q7, Q7, Q7,
-    Q8, Q8, Q8, Q8, Q8, Q8, Q8, Q8, Q8, Q8, Q8,
-    Q9, Q9, Q9, Q9, Q9, Q9, Q9, Q9, Q9, Q9, Q9,
-    QA, QA, QA, QA, QA, QA, QA, QA, QA, QA, QA,
-    0,  0,  0,  0,  0,  0,  0
-};
-
-static const sample_t q11_2_tbl[128] = {
-    Q0, Q1, Q2, Q3, Q4, Q5, Q6, Q7, Q8, Q9, QA,
-    Q0, Q1, Q2, Q3, Q4, Q5, Q6, Q7, Q8, Q9, QA,
-    Q0, Q1, Q2, Q3, Q4, Q5, Q6, Q7, Q8, Q9, QA,
-    Q0, Q1, Q2, Q3, Q4, Q5, Q6, Q7, Q8, Q9, QA,
-    Q0, Q1, Q2, Q3, Q4, Q5, Q6, Q7, Q8, Q9, QA,
-    Q0, Q1, Q2, Q3, Q4, Q5, Q6, Q7, Q8, Q9, QA,
-    Q0, Q1, Q2, Q3, Q4, Q5, Q6, Q7, Q8, Q9, QA,
-    Q0, Q1, Q2, Q3, Q4, Q5, Q6, Q7, Q8, Q9, QA,
-    Q0, Q1, Q2, Q3, Q4, Q5, Q6, Q7, Q8, Q9, QA,
-    Q0, Q1, Q2, Q3, Q4, Q5, Q6, Q7, Q8, Q9, QA,
-    Q0, Q1, Q2, Q3, Q4, Q5, Q6, Q7, Q8, Q9, QA,
-    0,  0,  0,  0,  0,  0,  0
+const sample_t q11_group_tbl[128][2] =
+{
+  { Q0, Q0 }, { Q0, Q1 }, { Q0, Q2 }, { Q0, Q3 },
+  { Q0, Q4 }, { Q0, Q5 }, { Q0, Q6 }, { Q0, Q7 },
+  { Q0, Q8 }, { Q0, Q9 }, { Q0, QA }, { Q1, Q0 },
+  { Q1, Q1 }, { Q1, Q2 }, { Q1, Q3 }, { Q1, Q4 },
+  { Q1, Q5 }, { Q1, Q6 }, { Q1, Q7 }, { Q1, Q8 },
+  { Q1, Q9 }, { Q1, QA }, { Q2, Q0 }, { Q2, Q1 },
+  { Q2, Q2 }, { Q2, Q3 }, { Q2, Q4 }, { Q2, Q5 },
+  { Q2, Q6 }, { Q2, Q7 }, { Q2, Q8 }, { Q2, Q9 },
+  { Q2, QA }, { Q3, Q0 }, { Q3, Q1 }, { Q3, Q2 },
+  { Q3, Q3 }, { Q3, Q4 }, { Q3, Q5 }, { Q3, Q6 },
+  { Q3, Q7 }, { Q3, Q8 }, { Q3, Q9 }, { Q3, QA },
+  { Q4, Q0 }, { Q4, Q1 }, { Q4, Q2 }, { Q4, Q3 },
+  { Q4, Q4 }, { Q4, Q5 }, { Q4, Q6 }, { Q4, Q7 },
+  { Q4, Q8 }, { Q4, Q9 }, { Q4, QA }, { Q5, Q0 },
+  { Q5, Q1 }, { Q5, Q2 }, { Q5, Q3 }, { Q5, Q4 },
+  { Q5, Q5 }, { Q5, Q6 }, { Q5, Q7 }, { Q5, Q8 },
+  { Q5, Q9 }, { Q5, QA }, { Q6, Q0 }, { Q6, Q1 },
+  { Q6, Q2 }, { Q6, Q3 }, { Q6, Q4 }, { Q6, Q5 },
+  { Q6, Q6 }, { Q6, Q7 }, { Q6, Q8 }, { Q6, Q9 },
+  { Q6, QA }, { Q7, Q0 }, { Q7, Q1 }, { Q7, Q2 },
+  { Q7, Q3 }, { Q7, Q4 }, { Q7, Q5 }, { Q7, Q6 },
+  { Q7, Q7 }, { Q7, Q8 }, { Q7, Q9 }, { Q7, QA },
+  { Q8, Q0 }, { Q8, Q1 }, { Q8, Q2 }, { Q8, Q3 },
+  { Q8, Q4 }, { Q8, Q5 }, { Q8, Q6 }, { Q8, Q7 },
+  { Q8, Q8 }, { Q8, Q9 }, { Q8, QA }, { Q9, Q0 },
+  { Q9, Q1 }, { Q9, Q2 }, { Q9, Q3 }, { Q9, Q4 },
+  { Q9, Q5 }, { Q9, Q6 }, { Q9, Q7 }, { Q9, Q8 },
+  { Q9, Q9 }, { Q9, QA }, { QA, Q0 }, { QA, Q1 },
+  { QA, Q2 }, { QA, Q3 }, { QA, Q4 }, { QA, Q5 },
+  { QA, Q6 }, { QA, Q7 }, { QA, Q8 }, { QA, Q9 },
+  { QA, QA }, { 0, 0 }, { 0, 0 }, { 0, 0 },
+  { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 }
 };
 
 #undef Q0
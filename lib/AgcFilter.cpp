@@ -28,6 +28,7 @@ AgcFilter::AgcFilter(size_t _nsamples)
   // Options
   auto_gain = true;
   normalize = false;
+  clipping  = true;
 
   // Gain control
   master    = 1.0;   // factor
@@ -48,9 +49,11 @@ void AgcFilter::setBuffer(size_t _nsamples)
 {
   // allocate buffers
   nsamples = _nsamples;
-  buf[0].allocate(NCHANNELS, nsamples);
-  buf[1].allocate(NCHANNELS, nsamples);
-  w.allocate(2, nsamples);
+  // aligned buffers have zeroed padding up to the stride
+  // (multiple of 8 samples), used by the level scan below
+  buf[0].allocateAligned(NCHANNELS, nsamples);
+  buf[1].allocateAligned(NCHANNELS, nsamples);
+  w.allocateAligned(2, nsamples);
 
   // hann window
   double f = 2.0 * M_PI / (nsamples * 2);
@@ -133,8 +136,9 @@ void AgcFilter::process(void)
   {
     max = 0;
     sptr = buf[block][ch];
-    send = sptr + nsamples - 7;
+    send = sptr + buf[block].getStride();
 
+    // padding is zero, so no tail loop is required
     while ( sptr < send )
     {
       if ( fabs(sptr[0]) > max )
@@ -157,16 +161,6 @@ void AgcFilter::process(void)
       sptr += 8;
     }
 
-    send += 7;
-
-    while ( sptr < send )
-    {
-      if ( fabs(sptr[0]) > max )
-        max = fabs(sptr[0]);
-
-      ++sptr;
-    }
-
     levels_loc[ch] = max / spk_level;
   }
 
@@ -307,7 +301,7 @@ void AgcFilter::process(void)
   // Note that we must clip even in case
   // of previous block overflow...
 
-  if ( level * factor > 1.0 || old_level * old_factor > 1.0 )
+  if ( clipping && (level * factor > 1.0 || old_level * old_factor > 1.0) )
   {
     for ( int ch = 0; ch < maxCh; ++ch )
     {
@@ -344,6 +338,25 @@ void AgcFilter::reset(void)
   factor= 1.0;
 }
 
+vtime_t AgcFilter::getLatency(void) const
+{
+  // a block is sent after the next one is filled
+  if ( ! spk.getSampleRate() )
+    return 0;
+
+  return vtime_t(2 * nsamples) / spk.getSampleRate();
+}
+
+bool AgcFilter::isIdentity(void) const
+{
+  // Exact unity gain with no gain control, no clipping
+  // (it changes samples over full scale) and nothing
+  // buffered.
+  return ! auto_gain && ! drc && ! clipping
+    && master == 1.0 && factor == 1.0
+    && ! sample[0] && ! sample[1];
+}
+
 bool AgcFilter::getChunk(Chunk *_chunk)
 {
   while ( fillBuffer() )
@@ -17,6 +17,7 @@
     buffer       // processing buffer length in samples [offline]
     auto_gain    // automatic gain control [online]
     normalize    // one-pass normalize [online]
+    clipping     // clip samples over full scale [online]
     master       // desired gain [online]
     gain         // current gain [online]
     release      // release speed (dB/s) [online]
@@ -43,9 +44,13 @@ public:
   virtual void reset(void);
   virtual bool getChunk(Chunk *out);
 
+  virtual bool isIdentity(void) const;
+  virtual vtime_t getLatency(void) const;
+
   // Options
   bool auto_gain; // [rw] automatic gain control
   bool normalize; // [rw] one-pass normalize
+  bool clipping; // [rw] clip samples over full scale
 
   // Gain control
   sample_t master; // [rw] desired gain
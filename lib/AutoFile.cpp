@@ -1,7 +1,12 @@
 #include <iostream>
 #include <limits>
 #include <limits.h>
+#include <string.h>
+#ifdef __GNUC__
+#include <sys/mman.h>
+#endif
 #include <AudioFilter/AutoFile.h>
+#include "ReadAhead.h"
 
 namespace AudioFilter {
 
@@ -48,6 +53,9 @@ static AutoFile::fsize_t portable_tell(FILE *f)
 
 #endif // ! MSC
 
+const size_t AutoFile::prefetch_depth(8);
+const size_t AutoFile::prefetch_block(256 * 1024);
+
 bool AutoFile::open(const char *filename, const char *mode)
 {
   if ( f )
@@ -96,6 +104,9 @@ bool AutoFile::open(FILE *_f, bool takeOwnership)
 
 void AutoFile::close(void)
 {
+  stopPrefetch();
+  unmap();
+
   if ( f && own_file )
     fclose(f);
 
@@ -104,24 +115,169 @@ void AutoFile::close(void)
 
 int AutoFile::seek(fsize_t _pos)
 {
+  if ( map_data )
+  {
+    if ( _pos < 0 )
+      return -1;
+
+    map_pos = _pos;
+    return 0;
+  }
+
+  if ( ahead )
+  {
+    if ( _pos < 0 )
+      return -1;
+
+    ahead->seek(_pos);
+    return 0;
+  }
+
   return portable_seek(f, _pos, SEEK_SET);
 }
 
 AutoFile::fsize_t AutoFile::pos(void) const
 {
+  if ( map_data )
+    return map_pos;
+
+  if ( ahead )
+    return ahead->pos();
+
   return portable_tell(f);
 }
 
-MemFile::MemFile(const char *filename)
-  : data(0), file_size(0)
+///////////////////////////////////////////////////////////////////////////////
+// Memory mapping
+
+bool AutoFile::map(map_advice_t advice)
+{
+#ifdef __GNUC__
+  if ( ! f || map_data )
+    return map_data != 0;
+
+  stopPrefetch();
+
+  if ( filesize <= 0 || filesize == max_size || isLarge(filesize) )
+    return false;
+
+  void *data(::mmap(0, castSize(filesize), PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(f), 0));
+
+  if ( data == MAP_FAILED )
+    return false;
+
+  ::madvise(data, castSize(filesize), advice == map_sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+
+  map_pos = portable_tell(f);
+  map_data = (uint8_t *)data;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void AutoFile::unmap(void)
+{
+#ifdef __GNUC__
+  if ( ! map_data )
+    return;
+
+  ::munmap(map_data, castSize(filesize));
+  map_data = 0;
+
+  // continue with stdio where the mapping stopped
+  portable_seek(f, map_pos, SEEK_SET);
+#endif
+}
+
+size_t AutoFile::readMapped(void *buf, size_t size)
+{
+  uint8_t *data(readDirect(size));
+
+  if ( size )
+    ::memcpy(buf, data, size);
+
+  return size;
+}
+
+uint8_t *AutoFile::readDirect(size_t &size)
+{
+  if ( ahead )
+    return ahead->readDirect(size);
+
+  if ( ! map_data || map_pos >= filesize )
+  {
+    size = 0;
+    return 0;
+  }
+
+  if ( fsize_t(size) > filesize - map_pos )
+    size = castSize(filesize - map_pos);
+
+  uint8_t *data(map_data + map_pos);
+  map_pos += size;
+  return data;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Read-ahead
+
+bool AutoFile::prefetch(size_t depth, size_t block_size)
+{
+  if ( ! f || map_data )
+    return false;
+
+  stopPrefetch();
+
+  ahead = new ReadAhead(f, portable_tell(f), depth, block_size);
+
+  if ( ! ahead->create() )
+  {
+    delete ahead;
+    ahead = 0;
+    return false;
+  }
+
+  return true;
+}
+
+void AutoFile::stopPrefetch(void)
+{
+  if ( ! ahead )
+    return;
+
+  const fsize_t ahead_pos(ahead->pos());
+  delete ahead;
+  ahead = 0;
+
+  // continue with stdio where the consumer stopped
+  portable_seek(f, ahead_pos, SEEK_SET);
+}
+
+size_t AutoFile::readAhead(void *buf, size_t size)
 {
-  AutoFile f(filename, "rb");
+  return ahead->read(buf, size);
+}
 
+bool AutoFile::eofAhead(void) const
+{
+  return ahead->eof();
+}
+
+MemFile::MemFile(const char *filename)
+  : f(filename, "rb"), data(0), file_size(0)
+{
   if ( ! f.isOpen() || f.size() == f.max_size || f.isLarge(f.size()) )
     return;
 
   file_size = f.castSize( f.size() );
 
+  if ( f.map() )
+  {
+    data = f.getMapData();
+    return;
+  }
+
   data = new uint8_t[file_size];
 
   size_t read_size = f.read(data, file_size);
@@ -132,11 +288,13 @@ MemFile::MemFile(const char *filename)
     data = 0;
     file_size = 0;
   }
+
+  f.close();
 }
 
 MemFile::~MemFile()
 {
-  if ( data )
+  if ( data && ! f.isMapped() )
     delete[] (uint8_t*)data;
 }
 
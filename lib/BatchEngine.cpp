@@ -0,0 +1,427 @@
+#include "BatchEngine.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace AudioFilter {
+
+BatchEngine::BatchEngine(int _nthreads)
+  : stopping(false)
+  , quantum(4)
+  , nthreads(0)
+  , next_worker(0)
+  , nactive(0)
+{
+  if ( _nthreads <= 0 )
+    _nthreads = getCpuCount();
+
+  // workers wait for the lock until the pool is complete
+  AutoLock l(&lock);
+
+  for ( int i = 0; i < _nthreads; ++i )
+  {
+    Worker *w = new Worker(this, nthreads);
+
+    if ( ! w->create() )
+    {
+      delete w;
+      break;
+    }
+
+    worker.push_back(w);
+    ++nthreads;
+  }
+}
+
+BatchEngine::~BatchEngine()
+{
+  cancelAll();
+  waitAll();
+
+  {
+    AutoLock l(&lock);
+    stopping = true;
+    cond.broadcast();
+  }
+
+  for ( size_t i = 0; i < worker.size(); ++i )
+  {
+    worker[i]->join();
+    delete worker[i];
+  }
+
+  for ( size_t i = 0; i < job.size(); ++i )
+    delete job[i];
+}
+
+int
+BatchEngine::getCpuCount(void)
+{
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  int ncpus = (int)info.dwNumberOfProcessors;
+#else
+  int ncpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+  return ncpus > 0? ncpus: 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Jobs
+///////////////////////////////////////////////////////////////////////////////
+
+int
+BatchEngine::addJob(Source *_source, Filter *_filter, Sink *_sink, BatchCallback *_callback, int _priority)
+{
+  if ( ! _source || ! _filter || ! _sink || ! nthreads )
+    return -1;
+
+  Job *j = new Job;
+  j->source = _source;
+  j->filter = _filter;
+  j->sink = _sink;
+  j->callback = _callback;
+  j->priority = _priority > 0? _priority: 1;
+
+  j->state = job_queued;
+  j->waiters = 0;
+  j->cancel = false;
+
+  j->started = false;
+  j->eos = false;
+  j->flushed = false;
+
+  AutoLock l(&lock);
+
+  int id = (int)job.size();
+  j->current.job = id;
+  j->current.state = job_queued;
+  j->progress = j->current;
+  job.push_back(j);
+
+  worker[next_worker]->ready.push_back(j);
+  next_worker = (next_worker + 1) % nthreads;
+  ++nactive;
+
+  cond.broadcast();
+  return id;
+}
+
+void
+BatchEngine::cancel(int _job)
+{
+  AutoLock l(&lock);
+  Job *j = findJob(_job);
+
+  if ( j )
+    j->cancel = true;
+}
+
+void
+BatchEngine::cancelAll(void)
+{
+  AutoLock l(&lock);
+
+  for ( size_t i = 0; i < job.size(); ++i )
+    if ( job[i] )
+      job[i]->cancel = true;
+}
+
+bool
+BatchEngine::wait(int _job)
+{
+  AutoLock l(&lock);
+  Job *j = findJob(_job);
+
+  if ( ! j )
+    return false;
+
+  // clear() may be called while we wait for the lock
+  // after the job is finished, so keep the job alive
+
+  ++j->waiters;
+
+  while ( j->state == job_queued || j->state == job_running )
+    cond.wait(&lock);
+
+  --j->waiters;
+  return j->state == job_done;
+}
+
+void
+BatchEngine::waitAll(void)
+{
+  AutoLock l(&lock);
+
+  while ( nactive )
+    cond.wait(&lock);
+}
+
+void
+BatchEngine::clear(void)
+{
+  AutoLock l(&lock);
+
+  for ( size_t i = 0; i < job.size(); ++i )
+  {
+    if ( job[i] && job[i]->state != job_queued && job[i]->state != job_running && ! job[i]->waiters )
+    {
+      delete job[i];
+      job[i] = 0;
+    }
+  }
+}
+
+int
+BatchEngine::getState(int _job) const
+{
+  AutoLock l(&lock);
+  Job *j = findJob(_job);
+  return j? j->state: job_failed;
+}
+
+bool
+BatchEngine::getProgress(int _job, BatchProgress &_progress) const
+{
+  AutoLock l(&lock);
+  Job *j = findJob(_job);
+
+  if ( ! j )
+    return false;
+
+  _progress = j->progress;
+  _progress.state = j->state;
+  return true;
+}
+
+int
+BatchEngine::getJobCount(void) const
+{
+  AutoLock l(&lock);
+  int count = 0;
+
+  for ( size_t i = 0; i < job.size(); ++i )
+    if ( job[i] )
+      ++count;
+
+  return count;
+}
+
+int
+BatchEngine::getActiveCount(void) const
+{
+  AutoLock l(&lock);
+  return nactive;
+}
+
+void
+BatchEngine::setQuantum(int _quantum)
+{
+  AutoLock l(&lock);
+  quantum = _quantum > 0? _quantum: 1;
+}
+
+int
+BatchEngine::getQuantum(void) const
+{
+  AutoLock l(&lock);
+  return quantum;
+}
+
+BatchEngine::Job *
+BatchEngine::findJob(int _job) const
+{
+  if ( _job < 0 || _job >= (int)job.size() )
+    return 0;
+
+  return job[_job];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Workers
+///////////////////////////////////////////////////////////////////////////////
+
+/////////////////////////////////////////////////////////
+// Take the next job for the worker: from the front of its
+// own queue or steal from the back of the other queues.
+// Lock must be held.
+
+BatchEngine::Job *
+BatchEngine::nextJob(int index)
+{
+  Job *j = 0;
+  std::deque<Job *> &own = worker[index]->ready;
+
+  if ( ! own.empty() )
+  {
+    j = own.front();
+    own.pop_front();
+    return j;
+  }
+
+  for ( int i = 1; i < nthreads; ++i )
+  {
+    std::deque<Job *> &other = worker[(index + i) % nthreads]->ready;
+
+    if ( ! other.empty() )
+    {
+      j = other.back();
+      other.pop_back();
+      return j;
+    }
+  }
+
+  return 0;
+}
+
+void
+BatchEngine::runWorker(int index)
+{
+  while ( true )
+  {
+    Job *j = 0;
+    int steps;
+
+    {
+      AutoLock l(&lock);
+
+      while ( ! stopping && (j = nextJob(index)) == 0 )
+        cond.wait(&lock);
+
+      if ( ! j )
+        return; // stopping
+
+      j->state = job_running;
+      steps = quantum * j->priority;
+    }
+
+    bool ok = true;
+    bool finished = false;
+    j->current.state = job_running;
+
+    for ( int i = 0; i < steps && ok && ! finished && ! j->cancel; ++i )
+      ok = runStep(j, finished);
+
+    if ( ! ok )
+      finishJob(j, job_failed);
+    else if ( finished )
+      finishJob(j, job_done);
+    else if ( j->cancel )
+      finishJob(j, job_cancelled);
+    else
+    {
+      // the job is not queued yet, so nobody
+      // else runs it during the callback
+      if ( j->callback )
+        j->callback->onProgress(j->current);
+
+      AutoLock l(&lock);
+      j->progress = j->current;
+      j->state = job_queued;
+      worker[index]->ready.push_back(j);
+      cond.broadcast();
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////
+// Process one source chunk (or flush the filter at the
+// end of the source) and send all output to the sink.
+// Returns false on error.
+
+bool
+BatchEngine::runStep(Job *j, bool &finished)
+{
+  BatchProgress &p = j->current;
+  Chunk chunk;
+
+  finished = false;
+  ++p.steps;
+
+  if ( ! j->started )
+  {
+    j->started = true;
+    Speakers spk = j->source->getOutput();
+
+    if ( spk != Speakers::UNKNOWN && spk != j->filter->getInput() )
+      if ( ! j->filter->setInput(spk) )
+        return false;
+  }
+
+  if ( ! j->source->isEmpty() )
+  {
+    if ( ! j->source->getChunk(&chunk) )
+      return false;
+
+    if ( ! chunk.isDummy() )
+    {
+      ++p.chunks_in;
+      if ( chunk.spk.isLinear() )
+        p.samples_in += chunk.size;
+      else
+        p.bytes_in += chunk.size;
+
+      j->eos = chunk.eos;
+
+      if ( ! j->filter->process(&chunk) )
+        return false;
+    }
+  }
+  else if ( ! j->flushed )
+  {
+    j->flushed = true;
+
+    if ( ! j->eos && j->filter->getInput() != Speakers::UNKNOWN )
+    {
+      chunk.setEmpty(j->filter->getInput(), false, 0, true);
+
+      if ( ! j->filter->process(&chunk) )
+        return false;
+    }
+  }
+
+  while ( ! j->filter->isEmpty() )
+  {
+    if ( ! j->filter->getChunk(&chunk) )
+      return false;
+
+    if ( chunk.isDummy() )
+      continue;
+
+    ++p.chunks_out;
+    if ( chunk.spk.isLinear() )
+      p.samples_out += chunk.size;
+    else
+      p.bytes_out += chunk.size;
+
+    if ( ! j->sink->process(&chunk) )
+      return false;
+  }
+
+  finished = j->flushed;
+  return true;
+}
+
+void
+BatchEngine::finishJob(Job *j, int state)
+{
+  j->current.state = state;
+
+  if ( j->callback )
+    j->callback->onProgress(j->current);
+
+  AutoLock l(&lock);
+  j->progress = j->current;
+  j->state = state;
+  --nactive;
+  cond.broadcast();
+}
+
+}; // namespace AudioFilter
+
+// vim: ts=2 sts=2 et
@@ -0,0 +1,231 @@
+#pragma once
+#ifndef VALIB_BATCH_ENGINE_H
+#define VALIB_BATCH_ENGINE_H
+/*
+  BatchEngine - runs many independent (source, filter, sink) jobs on a
+  shared pool of worker threads.
+
+  A thread per stream oversubscribes the cores when there are hundreds of
+  streams to process. The engine keeps a fixed number of workers (a worker
+  per core by default) and schedules jobs in chunk-sized steps instead:
+
+    BatchEngine engine;
+
+    for ( int i = 0; i < nfiles; ++i )
+      engine.addJob(&src[i], &chain[i], &sink[i], &progress);
+
+    engine.waitAll();
+
+  A step takes one chunk from the source, passes it through the filter and
+  gives all output to the sink (as Filter::transform() does). When the
+  source becomes empty the filter is flushed with an eos-chunk (unless the
+  last chunk was an eos-chunk) and the job is done when the filter is
+  drained. Source, filter and sink belong to the caller and must be valid
+  until the job is finished. Each job is processed by one worker at a time,
+  so its objects are never accessed concurrently (but different workers may
+  process different steps of the job).
+
+  Scheduling
+  ==========
+  Each worker has its own queue of jobs. It takes a job from the front of
+  its queue, runs a turn of quantum * priority steps and puts the job at
+  the back of the queue, so jobs share the worker round-robin and job's
+  share is proportional to its priority. A worker with an empty queue
+  steals a job from the back of other workers' queues, so all cores are
+  busy while there are more jobs than workers. New jobs are spread over the
+  workers.
+
+  Cancellation and progress
+  =========================
+  cancel() stops a job after the current step (a queued job is never
+  started). Filter is not flushed for a cancelled job. The callback is
+  called from a worker thread (without the engine's lock held) after each
+  turn and once after the job is finished. The final call has a final job
+  state (job_done, job_cancelled or job_failed).
+
+  Job ids are indexes in order of addJob() calls. Finished jobs are kept
+  (with their progress) until clear().
+*/
+
+#include <deque>
+#include <vector>
+#include <AudioFilter/Filter.h>
+#include "Thread.h"
+
+namespace AudioFilter {
+
+///////////////////////////////////////////////////////////////////////////////
+// BatchProgress - job state and data counters
+//
+// Data is counted in bytes for raw data and in samples (per channel) for
+// linear format.
+
+struct BatchProgress
+{
+  int job;
+  int state;
+
+  uint64_t steps;
+  uint64_t chunks_in;
+  uint64_t chunks_out;
+  uint64_t bytes_in;
+  uint64_t bytes_out;
+  uint64_t samples_in;
+  uint64_t samples_out;
+
+  BatchProgress(): job(-1), state(0)
+  {
+    reset();
+  }
+
+  void reset(void)
+  {
+    steps = 0;
+    chunks_in = chunks_out = 0;
+    bytes_in = bytes_out = 0;
+    samples_in = samples_out = 0;
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// BatchCallback - job progress notifications
+// May be called from any worker thread, several jobs may call it at once.
+
+class BatchCallback
+{
+public:
+  virtual ~BatchCallback() {}
+  virtual void onProgress(const BatchProgress &progress) = 0;
+};
+
+class BatchEngine
+{
+public:
+  enum { job_queued, job_running, job_done, job_cancelled, job_failed };
+
+  // _nthreads == 0 - worker per CPU
+  BatchEngine(int _nthreads = 0);
+  ~BatchEngine();
+
+  /////////////////////////////////////////////////////////
+  // Jobs
+  //
+  // addJob()
+  //   Queue a job and return its id (-1 on error). Priority is the job's
+  //   share of the worker time relative to other jobs (1 or more).
+  //
+  // cancel(), cancelAll()
+  //   Stop the job(s) at the next step. Does not wait.
+  //
+  // wait(), waitAll()
+  //   Wait until the job(s) are finished. wait() returns true when the job
+  //   is done successfully.
+  //
+  // clear()
+  //   Forget finished jobs (their ids become invalid). A job that another
+  //   thread waits for is kept until the next clear().
+
+  int  addJob(Source *_source, Filter *_filter, Sink *_sink, BatchCallback *_callback = 0, int _priority = 1);
+  void cancel(int _job);
+  void cancelAll(void);
+  bool wait(int _job);
+  void waitAll(void);
+  void clear(void);
+
+  int  getState(int _job) const;
+  bool getProgress(int _job, BatchProgress &_progress) const;
+
+  int getJobCount(void) const;
+  int getActiveCount(void) const;
+
+  int getThreadCount(void) const
+  {
+    return nthreads;
+  }
+
+  /////////////////////////////////////////////////////////
+  // Number of steps a job runs per turn (for priority 1).
+  // Longer turns mean less scheduling overhead and coarser
+  // sharing.
+
+  void setQuantum(int _quantum);
+  int  getQuantum(void) const;
+
+  static int getCpuCount(void);
+
+protected:
+  /////////////////////////////////////////////////////////
+  // Job
+  //
+  // Scheduling fields are guarded by the lock. Processing
+  // state and 'current' counters belong to the worker that
+  // runs the job, 'progress' is a copy of the counters made
+  // under the lock at the end of each turn.
+
+  struct Job
+  {
+    Source *source;
+    Filter *filter;
+    Sink   *sink;
+    BatchCallback *callback;
+    int priority;
+
+    int state;
+    int waiters;   // threads in wait(), job is not deleted
+    volatile bool cancel;
+
+    bool started;
+    bool eos;      // last chunk from the source was eos-chunk
+    bool flushed;  // flushing eos-chunk was sent
+
+    BatchProgress current;
+    BatchProgress progress;
+  };
+
+  /////////////////////////////////////////////////////////
+  // Pool worker
+
+  class Worker : public Thread
+  {
+  public:
+    Worker(BatchEngine *_engine, int _index)
+      : engine(_engine), index(_index)
+    {}
+
+    std::deque<Job *> ready;
+    BatchEngine *engine;
+    int index;
+
+  protected:
+    virtual int process(void)
+    {
+      engine->runWorker(index);
+      return 0;
+    }
+  };
+
+  mutable CritSec lock;
+  Condition cond;
+
+  bool stopping;
+  int  quantum;
+  int  nthreads;
+  int  next_worker; // worker to queue the next new job
+  int  nactive;     // jobs not finished
+
+  std::vector<Worker *> worker;
+  std::vector<Job *> job;
+
+  Job *findJob(int _job) const;
+  Job *nextJob(int index);
+
+  void runWorker(int index);
+  bool runStep(Job *j, bool &finished);
+  void finishJob(Job *j, int state);
+};
+
+}; // namespace AudioFilter
+
+#endif
+
+// vim: ts=2 sts=2 et
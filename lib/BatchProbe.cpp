@@ -0,0 +1,158 @@
+#include "BatchEngine.h"
+#include "BatchProbe.h"
+
+namespace AudioFilter {
+
+BatchProbe::BatchProbe(int _nthreads, int _max_io)
+  : nthreads(_nthreads > 0? _nthreads: BatchEngine::getCpuCount())
+  , max_io(_max_io > 0? _max_io: nthreads)
+  , max_measurements(100)
+  , precision(0.5)
+  , seed(0)
+  , files(0)
+  , factory(0)
+  , results(0)
+  , next_file(0)
+  , io_active(0)
+{
+}
+
+bool
+BatchProbe::run(const std::vector<std::string> &_files, HeaderParserFactory *_factory, std::vector<BatchProbeResult> &_results)
+{
+  _results.clear();
+  _results.resize(_files.size());
+
+  if ( ! _factory )
+    return false;
+
+  files = &_files;
+  factory = _factory;
+  results = &_results;
+  next_file = 0;
+  io_active = 0;
+
+  std::vector<Worker *> worker;
+
+  for ( int i = 0; i < nthreads && i < (int)_files.size(); ++i )
+  {
+    Worker *w = new Worker(this);
+
+    if ( ! w->create() )
+    {
+      delete w;
+      break;
+    }
+
+    worker.push_back(w);
+  }
+
+  for ( size_t i = 0; i < worker.size(); ++i )
+  {
+    worker[i]->join();
+    delete worker[i];
+  }
+
+  files = 0;
+  factory = 0;
+  results = 0;
+
+  return ! worker.empty() || _files.empty();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Workers
+///////////////////////////////////////////////////////////////////////////////
+
+void
+BatchProbe::runWorker(void)
+{
+  HeaderParser *parser;
+
+  {
+    AutoLock l(&lock);
+    parser = factory->createParser();
+  }
+
+  for ( ; ; )
+  {
+    size_t i;
+
+    /////////////////////////////////////////////////////
+    // Take the next file and an I/O slot
+
+    {
+      AutoLock l(&lock);
+
+      while ( io_active >= max_io && next_file < files->size() )
+        io_cond.wait(&lock);
+
+      if ( next_file >= files->size() )
+        break;
+
+      i = next_file++;
+      ++io_active;
+    }
+
+    // Results are preallocated, so each worker
+    // writes its own entry without the lock.
+
+    probeFile((*files)[i].c_str(), parser, max_measurements, precision, seed, (*results)[i]);
+
+    {
+      AutoLock l(&lock);
+      --io_active;
+      io_cond.broadcast();
+    }
+  }
+
+  delete parser;
+}
+
+void
+BatchProbe::probeFile(const char *_filename, HeaderParser *_parser, unsigned _max_measurements, vtime_t _precision, int _seed, BatchProbeResult &_result)
+{
+  _result = BatchProbeResult();
+  _result.filename = _filename;
+
+  if ( ! _parser )
+    return;
+
+  // Random probing gains nothing from read-ahead
+  FileParser file(_filename, _parser, 0, 0);
+
+  if ( ! file.isOpen() )
+    return;
+
+  _result.opened = true;
+  _result.size = file.getSize();
+
+  if ( ! file.loadFrame() )
+    return;
+
+  _result.detected = true;
+  _result.hinfo = file.getHeaderInfo();
+  file.seek(0);
+
+  if ( ! _max_measurements )
+    return;
+
+  RNG rng;
+
+  if ( _seed )
+    rng.seed(_seed);
+  else
+    rng.randomize();
+
+  if ( ! file.stats(_max_measurements, _precision, &rng) )
+    return;
+
+  _result.measured = true;
+  _result.duration = file.getSize(FileParser::time);
+  _result.frames = file.getSize(FileParser::frames);
+  _result.bitrate = _result.duration > 0? double(_result.size) * 8 / _result.duration: 0;
+}
+
+}; // namespace AudioFilter
+
+// vim: ts=2 sts=2 et
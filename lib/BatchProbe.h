@@ -0,0 +1,176 @@
+#pragma once
+#ifndef VALIB_BATCH_PROBE_H
+#define VALIB_BATCH_PROBE_H
+/*
+  BatchProbe - detects the format and measures stats of many files at once.
+
+  Files are probed by a pool of worker threads. Each worker opens the file
+  with FileParser, loads the first frame and measures the stats (stats()).
+  Results are returned in order of the file list:
+
+    BatchProbe probe;
+    std::vector<BatchProbeResult> results;
+
+    probe.setSeed(1);
+    probe.run(files, &factory, results);
+
+  A header parser keeps state (MultiHeaderParser remembers the last parser
+  matched), so each worker gets its own parser from the factory given.
+
+  I/O concurrency
+  ===============
+  max_io limits the number of files being read at once (a spinning disk
+  prefers a few sequential readers to many competing ones). By default it
+  equals the number of workers.
+
+  Sampling
+  ========
+  Seed 0 (default) samples random file positions for stats. Other seeds
+  make the sampling deterministic: each file is measured with a generator
+  seeded with the same seed, so results do not depend on the order and
+  timing of the workers.
+*/
+
+#include <string>
+#include <vector>
+#include <AudioFilter/FileParser.h>
+#include "Thread.h"
+
+namespace AudioFilter {
+
+///////////////////////////////////////////////////////////////////////////////
+// BatchProbeResult - results of a file probe
+//
+// opened    - file was opened
+// detected  - a frame was found (hinfo is valid)
+// measured  - stats were measured (the fields below are valid)
+// size      - file size
+// hinfo     - header of the first frame
+// duration  - estimated duration (exact when the file has an index)
+// frames    - estimated number of frames
+// bitrate   - average bitrate (bits per second)
+
+struct BatchProbeResult
+{
+  std::string filename;
+
+  bool opened;
+  bool detected;
+  bool measured;
+
+  AutoFile::fsize_t size;
+  HeaderInfo hinfo;
+
+  vtime_t duration;
+  double  frames;
+  double  bitrate;
+
+  BatchProbeResult()
+    : opened(false), detected(false), measured(false)
+    , size(0), duration(0), frames(0), bitrate(0)
+  {}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// HeaderParserFactory - makes a parser for a worker
+// Called from worker threads, parsers are deleted by the workers.
+
+class HeaderParserFactory
+{
+public:
+  virtual ~HeaderParserFactory() {}
+  virtual HeaderParser *createParser(void) = 0;
+};
+
+class BatchProbe
+{
+public:
+  // _nthreads == 0 - worker per CPU
+  // _max_io == 0   - no I/O limit (worker count)
+  BatchProbe(int _nthreads = 0, int _max_io = 0);
+
+  /////////////////////////////////////////////////////////
+  // Settings
+  //
+  // setStats()
+  //   Stats parameters (see FileParser::stats()). Zero measurements turn
+  //   the stats off (files are only probed).
+  //
+  // setSeed()
+  //   Sampling seed (0 - random sampling).
+
+  void setStats(unsigned _max_measurements, vtime_t _precision)
+  {
+    max_measurements = _max_measurements;
+    precision = _precision;
+  }
+
+  void setSeed(int _seed)
+  {
+    seed = _seed;
+  }
+
+  int getThreadCount(void) const
+  {
+    return nthreads;
+  }
+
+  int getMaxIO(void) const
+  {
+    return max_io;
+  }
+
+  /////////////////////////////////////////////////////////
+  // Probe the files (blocks until all files are done).
+  // Returns false when the workers cannot be started.
+
+  bool run(const std::vector<std::string> &_files, HeaderParserFactory *_factory, std::vector<BatchProbeResult> &_results);
+
+  static void probeFile(const char *_filename, HeaderParser *_parser, unsigned _max_measurements, vtime_t _precision, int _seed, BatchProbeResult &_result);
+
+protected:
+  /////////////////////////////////////////////////////////
+  // Worker
+
+  class Worker : public Thread
+  {
+  public:
+    Worker(BatchProbe *_probe): probe(_probe)
+    {}
+
+    BatchProbe *probe;
+
+  protected:
+    virtual int process(void)
+    {
+      probe->runWorker();
+      return 0;
+    }
+  };
+
+  int nthreads;
+  int max_io;
+
+  unsigned max_measurements;
+  vtime_t  precision;
+  int      seed;
+
+  // Run state (guarded by the lock)
+
+  CritSec lock;
+  Condition io_cond;
+
+  const std::vector<std::string> *files;
+  HeaderParserFactory *factory;
+  std::vector<BatchProbeResult> *results;
+  size_t next_file;
+  int    io_active;
+
+  void runWorker(void);
+};
+
+}; // namespace AudioFilter
+
+#endif
+
+// vim: ts=2 sts=2 et
@@ -1,39 +1,34 @@
 #include <AudioFilter/BitReader.h>
-#include <cstring>
-#ifdef __unix__
-#ifndef _XOPEN_SOURCE
-#define _XOPEN_SOURCE
-#endif
-#include <unistd.h>
-#else
-#endif
 
 namespace AudioFilter {
 
-void BitReader::init (const uint8_t *buf, size_t bufsize, bool isBigEndian)
+void BitReader::init (const uint8_t *buf, size_t bufsize, int bsType)
 {
-  if ( _buf )
-    delete _buf;
+  _buf = buf;
+  _bufSize = buf ? bufsize : 0;
+  _bsType = bsType;
+  _wordBits = (bsType == BITSTREAM_14BE || bsType == BITSTREAM_14LE) ? 28 : 32;
+  seek(0);
+}
 
-  _buf = new uint8_t[bufsize];
-  _bufSize = bufsize;
-  _bitN = 0;
+void BitReader::seek(size_t offset)
+{
+  // Start at the word holding the offset and drop the bits before it
 
-  if ( isBigEndian )
-  {
-    ::memcpy(_buf, buf, bufsize);
-  }
-  else
+  _bytePos = offset / _wordBits * 4;
+  _cache = 0;
+  _cacheBits = 0;
+  _bitN = offset - offset % _wordBits;
+
+  if ( offset % _wordBits )
   {
-#ifdef __unix__
-    ::swab(buf, _buf, bufsize);
-#else
-#error put a byte swapper here
-#endif
+    refill();
+    _cache <<= offset % _wordBits;
+    _cacheBits -= unsigned(offset % _wordBits);
+    _bitN = offset;
   }
 }
 
 }; // namespace AudioFilter
 
 // vim: ts=2 sts=2 et
-
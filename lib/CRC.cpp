@@ -18,7 +18,9 @@
 */
 
 
-#include "crc.h"
+#include <AudioFilter/Crc.h>
+
+namespace AudioFilter {
 
 const CRC crc16(POLY_CRC16, 16);
 const CRC crc32(POLY_CRC32, 32);
@@ -27,7 +29,7 @@ const CRC crc32(POLY_CRC32, 32);
 // CRC primitives
 
 uint32_t 
-CRC::add_bits(uint32_t crc, uint32_t data, size_t bits) const
+CRC::addBits(uint32_t crc, uint32_t data, size_t bits) const
 {
   if (bits)
   {
@@ -71,7 +73,7 @@ CRC::init(uint32_t _poly, unsigned _power)
   power = _power;
 
   for (byte = 0; byte < 256; byte++)
-    tbl[byte] = add_bits(0, byte, 8);
+    tbl[byte] = addBits(0, byte, 8);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -114,7 +116,7 @@ CRC::calc(uint32_t crc, const uint8_t *data, size_t size) const
 }
 
 uint32_t 
-CRC::calc_bits(uint32_t crc, const uint8_t *data, size_t start_bit, size_t bits) const
+CRC::calcBits(uint32_t crc, const uint8_t *data, size_t start_bit, size_t bits) const
 {
   data += start_bit >> 3;
   start_bit &= 7;
@@ -126,7 +128,7 @@ CRC::calc_bits(uint32_t crc, const uint8_t *data, size_t start_bit, size_t bits)
   if (size)
   {
     // prolog
-    crc = add_bits(crc, *data, 8 - start_bit);
+    crc = addBits(crc, *data, 8 - start_bit);
     data++;
 
     // body
@@ -134,13 +136,17 @@ CRC::calc_bits(uint32_t crc, const uint8_t *data, size_t start_bit, size_t bits)
     data += size-1;
 
     // epilog
-    crc = add_bits(crc, (*data) >> (8 - end_bit), end_bit);
+    crc = addBits(crc, (*data) >> (8 - end_bit), end_bit);
   }
   else
   {
     // all stream is in one word
-    crc = add_bits(crc, (*data) >> (8 - end_bit), bits);
+    crc = addBits(crc, (*data) >> (8 - end_bit), bits);
   }
 
   return crc;
 }
+
+}; // namespace AudioFilter
+
+// vim: ts=2 sts=2 et
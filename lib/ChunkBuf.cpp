@@ -0,0 +1,189 @@
+#include <AudioFilter/ChunkBuf.h>
+#include "Thread.h"
+
+#ifdef _MSC_VER
+#include <windows.h>
+#define atomic_inc(x) InterlockedIncrement((volatile LONG *)&(x))
+#define atomic_dec(x) InterlockedDecrement((volatile LONG *)&(x))
+#define atomic_get(x) InterlockedCompareExchange((volatile LONG *)&(x), 0, 0)
+#else
+#define atomic_inc(x) __sync_add_and_fetch(&(x), 1)
+#define atomic_dec(x) __sync_sub_and_fetch(&(x), 1)
+#define atomic_get(x) __sync_add_and_fetch(&(x), 0)
+#endif
+
+namespace {
+
+inline int sizeClass(size_t size)
+{
+  int size_class = 0;
+
+  while ( size_class < 64 && ((size_t)1 << size_class) < size )
+    ++size_class;
+
+  return size_class;
+}
+
+}; // anonymous namespace
+
+namespace AudioFilter {
+
+///////////////////////////////////////////////////////////////////////////////
+// ChunkBuf
+///////////////////////////////////////////////////////////////////////////////
+
+ChunkBuf::ChunkBuf(ChunkBufPool *_pool, int _size_class, size_t _size)
+  : f_refs(0)
+  , f_pool(_pool)
+  , f_size_class(_size_class)
+  , f_size(_size)
+  , f_next(0)
+{
+  f_raw = new uint8_t[_size + SAMPLE_ALIGN];
+  f_buf = f_raw + (SAMPLE_ALIGN - (size_t)f_raw % SAMPLE_ALIGN) % SAMPLE_ALIGN;
+}
+
+ChunkBuf::~ChunkBuf()
+{
+  delete[] f_raw;
+}
+
+int
+ChunkBuf::refCount(void) const
+{
+  // full barrier: data released by other thread is
+  // not in use after we see the count drop
+  return atomic_get(const_cast<volatile int &>(f_refs));
+}
+
+void
+ChunkBuf::addRef(void)
+{
+  atomic_inc(f_refs);
+}
+
+void
+ChunkBuf::release(void)
+{
+  if ( atomic_dec(f_refs) == 0 )
+  {
+    if ( f_pool )
+      f_pool->recycle(this);
+    else
+      delete this;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ChunkBufPool
+///////////////////////////////////////////////////////////////////////////////
+
+ChunkBufPool::ChunkBufPool(size_t _max_cached)
+  : lock(new CritSec)
+  , max_cached(_max_cached)
+{
+  for ( int i = 0; i < nclasses; ++i )
+  {
+    free_list[i] = 0;
+    ncached[i] = 0;
+  }
+}
+
+ChunkBufPool::~ChunkBufPool()
+{
+  // all blocks must be released at this point
+  trim();
+  delete lock;
+}
+
+ChunkBufPool *
+ChunkBufPool::getDefault(void)
+{
+  static ChunkBufPool *pool = new ChunkBufPool();
+  return pool;
+}
+
+ChunkBufRef
+ChunkBufPool::allocate(size_t size)
+{
+  ChunkBuf *chunk_buf = 0;
+  int size_class = sizeClass(size);
+
+  if ( size_class < min_class )
+    size_class = min_class;
+
+  if ( size_class > max_class )
+  {
+    // too large to be cached
+    chunk_buf = new ChunkBuf(0, size_class, size);
+  }
+  else
+  {
+    {
+      AutoLock l(lock);
+
+      if ( free_list[size_class] )
+      {
+        chunk_buf = free_list[size_class];
+        free_list[size_class] = chunk_buf->f_next;
+        --ncached[size_class];
+      }
+    }
+
+    if ( ! chunk_buf )
+      chunk_buf = new ChunkBuf(this, size_class, (size_t)1 << size_class);
+  }
+
+  chunk_buf->f_next = 0;
+  chunk_buf->f_refs = 1;
+  return ChunkBufRef(chunk_buf);
+}
+
+void
+ChunkBufPool::trim(void)
+{
+  ChunkBuf *list[nclasses];
+
+  {
+    AutoLock l(lock);
+
+    for ( int i = 0; i < nclasses; ++i )
+    {
+      list[i] = free_list[i];
+      free_list[i] = 0;
+      ncached[i] = 0;
+    }
+  }
+
+  for ( int i = 0; i < nclasses; ++i )
+  {
+    while ( list[i] )
+    {
+      ChunkBuf *chunk_buf = list[i];
+      list[i] = chunk_buf->f_next;
+      delete chunk_buf;
+    }
+  }
+}
+
+void
+ChunkBufPool::recycle(ChunkBuf *chunk_buf)
+{
+  {
+    AutoLock l(lock);
+
+    if ( ncached[chunk_buf->f_size_class] < max_cached )
+    {
+      chunk_buf->f_next = free_list[chunk_buf->f_size_class];
+      free_list[chunk_buf->f_size_class] = chunk_buf;
+      ++ncached[chunk_buf->f_size_class];
+      return;
+    }
+  }
+
+  delete chunk_buf;
+}
+
+}; // namespace AudioFilter
+
+// vim: ts=2 sts=2 et
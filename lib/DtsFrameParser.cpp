@@ -4,7 +4,7 @@
 #include <AudioFilter/DtsFrameParser.h>
 
 #include "DtsTables.h"
-#include "DtsTablesHuffman.h"
+#include "DtsHuffman.h"
 #include "DtsTablesQuantization.h"
 #include "DtsTablesAdpcm.h"
 #include "DtsTablesFir.h"
@@ -86,38 +86,10 @@ namespace AudioFilter {
 DtsFrameParser::DtsFrameParser()
   : _dtsHeaderParser()
 {
-  initCosMod();
   _samples.allocate(DTS_NCHANNELS, DTS_MAX_SAMPLES);
   reset();
 }
 
-void DtsFrameParser::initCosMod(void)
-{
-  int j(0);
-
-  for ( int k = 0; k < 16; ++k )
-  {
-    for ( int i = 0; i < 16; ++i )
-      cos_mod[j++] = cos((2*i+1)*(2*k+1)*M_PI/64);
-  }
-
-  for ( int k = 0; k < 16; ++k )
-  {
-    for ( int i = 0; i < 16; ++i )
-      cos_mod[j++] = cos((i)*(2*k+1)*M_PI/32);
-  }
-
-  for ( int k = 0; k < 16; ++k )
-  {
-    cos_mod[j++] = 0.25/(2*cos((2*k+1)*M_PI/128));
-  }
-
-  for ( int k = 0; k < 16; ++k )
-  {
-    cos_mod[j++] = -0.25/(2.0*sin((2*k+1)*M_PI/128));
-  }
-}
-
 ///////////////////////////////////////////////////////////////////////////////
 // FrameParser overrides
 
@@ -141,9 +113,10 @@ void DtsFrameParser::reset(void)
   bit_rate        = 0;
 
   memset(subband_samples_hist, 0, sizeof(subband_samples_hist));
-  memset(subband_fir_hist, 0, sizeof(subband_fir_hist));
-  memset(subband_fir_noidea, 0, sizeof(subband_fir_noidea));
   memset(lfe_data, 0, sizeof(lfe_data));
+
+  for ( int ch = 0; ch < DTS_PRIM_CHANNELS_MAX; ++ch )
+    _synth[ch].reset();
 }
 
 bool DtsFrameParser::parseFrame(uint8_t *frame, size_t size)
@@ -162,38 +135,8 @@ bool DtsFrameParser::parseFrame(uint8_t *frame, size_t size)
   _nSamples = hi.getSampleCount();
   _bs_type = hi.getBsType();
 
-  /////////////////////////////////////////////////////////
-  // Convert the bitstream type
-  // Note that we have to allocate a buffer for 14bit
-  // stream, because the size of the stream increases
-  // during conversion.
-
-  if ( _bs_type == BITSTREAM_14BE || _bs_type == BITSTREAM_14LE )
-  {
-    // Buffered conversion
-    if ( _frameBuf.size() < size * 8 / 7 )
-    {
-      if ( _frameBuf.allocate(size * 8 / 7) )
-        return false;
-    }
-
-    const size_t dataSize(bs_convert(frame, size, _bs_type, _frameBuf, BITSTREAM_8));
-
-    if ( dataSize == 0 )
-      return false;
-
-    _bs.set(_frameBuf, 0, dataSize * 8);
-  }
-  else
-  {
-    // Inplace conversion
-    const size_t dataSize(bs_convert(frame, size, _bs_type, frame, BITSTREAM_8));
-
-    if ( dataSize == 0 )
-      return false;
-
-    _bs.set(frame, 0, dataSize * 8);
-  }
+  // The frame is read in place whatever the bitstream type is
+  _bs.init(frame, size, _bs_type);
 
   if ( ! parseFrameHeader() )
     return false;
@@ -458,6 +401,8 @@ bool DtsFrameParser::parseFrameHeader(void)
 
 bool DtsFrameParser::parseSubFrameHeader(void)
 {
+  const DtsHuffTables &huff(DtsHuffTables::get());
+
   // Primary audio coding side information
 
   // Subsubframe count
@@ -493,7 +438,7 @@ bool DtsFrameParser::parseSubFrameHeader(void)
       else if ( bitalloc_huffman[ch] == 5 )
         bitalloc[ch][k] = _bs.get(4);
       else
-        bitalloc[ch][k] = InverseQ(bitalloc_12[bitalloc_huffman[ch]]);
+        bitalloc[ch][k] = huff.bitalloc_12[bitalloc_huffman[ch]].decode(_bs);
 
       if ( bitalloc[ch][k] > 26 )
       {
@@ -512,7 +457,7 @@ bool DtsFrameParser::parseSubFrameHeader(void)
       transition_mode[ch][k] = 0;
 
       if ( subsubframes > 1 && k < vq_start_subband[ch] && bitalloc[ch][k] > 0 )
-        transition_mode[ch][k] = InverseQ(tmode[transient_huffman[ch]]);
+        transition_mode[ch][k] = huff.tmode[transient_huffman[ch]].decode(_bs);
     }
   }
 
@@ -542,7 +487,7 @@ bool DtsFrameParser::parseSubFrameHeader(void)
       {
         if ( scalefactor_huffman[ch] < 5 )
           // huffman encoded
-          scale_sum += InverseQ(scales_129[scalefactor_huffman[ch]]);
+          scale_sum += huff.scales_129[scalefactor_huffman[ch]].decode(_bs);
         else if ( scalefactor_huffman[ch] == 5 )
           scale_sum = _bs.get(6);
         else if ( scalefactor_huffman[ch] == 6 )
@@ -556,7 +501,7 @@ bool DtsFrameParser::parseSubFrameHeader(void)
         // Get second scale factor
         if ( scalefactor_huffman[ch] < 5 )
           // huffman encoded
-          scale_sum += InverseQ(scales_129[scalefactor_huffman[ch]]);
+          scale_sum += huff.scales_129[scalefactor_huffman[ch]].decode(_bs);
         else if ( scalefactor_huffman[ch] == 5 )
           scale_sum = _bs.get(6);
         else if ( scalefactor_huffman[ch] == 6 )
@@ -592,7 +537,7 @@ bool DtsFrameParser::parseSubFrameHeader(void)
       {
         if ( joint_huff[ch] < 5 )
           // huffman encoded
-          scale = InverseQ(scales_129[joint_huff[ch]]);
+          scale = huff.scales_129[joint_huff[ch]].decode(_bs);
         else if ( joint_huff[ch] == 5 )
           scale = _bs.get(6);
         else if ( joint_huff[ch] == 6 )
@@ -673,6 +618,8 @@ bool DtsFrameParser::parseSubFrameHeader(void)
 
 bool DtsFrameParser::parseSubSubFrame(void)
 {
+  const DtsHuffTables &huff(DtsHuffTables::get());
+
   int ch, l;
   int subsubframe = current_subsubframe;
 
@@ -711,7 +658,7 @@ bool DtsFrameParser::parseSubSubFrame(void)
       // Determine its type
       int q_type = 1; // (Assume Huffman type by default)
 
-      if ( abits >= 11 || ! bitalloc_select[abits][sel] )
+      if ( abits >= 11 || huff.bitalloc_select[abits][sel].isEmpty() )
       {
         // Not Huffman type
         if ( abits <= 7 )
@@ -735,7 +682,7 @@ bool DtsFrameParser::parseSubSubFrame(void)
 
         case 1: // Huffman code
           for ( int m = 0; m < 8; ++m )
-            subband_samples[ch][l][m] = InverseQ(bitalloc_select[abits][sel]);
+            subband_samples[ch][l][m] = huff.bitalloc_select[abits][sel].decode(_bs);
           break;
 
         case 2: // No further encoding
@@ -922,8 +869,9 @@ bool DtsFrameParser::parseSubSubFrame(void)
   // 32 subbands QMF
   for ( ch = 0; ch < prim_channels; ++ch )
   {
-    qmf_32_subbands(ch,
-      subband_samples[ch],
+    _synth[ch].synth(subband_samples[ch],
+      subband_activity[ch],
+      multirate_inter != 0,
       _samples[reorder[amode][ch]] + base,
 //      pcmr2level_tbl[source_pcm_res]);
       32768.0);
@@ -977,168 +925,6 @@ bool DtsFrameParser::parseSubFrameFooter(void)
   return true;
 }
 
-int DtsFrameParser::InverseQ(const huff_entry_t *huff)
-{
-  int value(0);
-  int length(0);
-  int j;
-
-  for ( ; ; )
-  {
-    ++length;
-    value <<= 1;
-    value |= _bs.get(1);
-
-    for ( j = 0; huff[j].length != 0 && huff[j].length < length; ++j )
-      ;
-
-    if ( huff[j].length == 0 )
-      break;
-
-    for ( ; huff[j].length == length; ++j )
-    {
-      if ( huff[j].code == value )
-        return huff[j].value;
-    }
-  }
-
-  return 0;
-}
-
-void DtsFrameParser::qmf_32_subbands (int ch, double samples_in[32][8]
-  , sample_t *samples_out, double scale)
-{
-  const double *prCoeff;
-  int i, j, k;
-  double raXin[32];
-
-  double *subband_fir  = subband_fir_hist[ch];
-  double *subband_fir2 = subband_fir_noidea[ch];
-
-  int nChIndex = 0, NumSubband = 32, nStart = 0, nEnd = 8, nSubIndex;
-
-  // Select filter
-  if ( ! multirate_inter )
-    // Non-perfect reconstruction
-    prCoeff = fir_32bands_nonperfect;
-  else
-    // Perfect reconstruction
-    prCoeff = fir_32bands_perfect;
-
-  // Reconstructed channel sample index
-  scale = 1.0 / scale;
-  for ( nSubIndex = nStart; nSubIndex < nEnd; ++nSubIndex )
-  {
-    // Load in one sample from each subband
-    for ( i = 0; i < subband_activity[ch]; ++i )
-      raXin[i] = samples_in[i][nSubIndex];
-
-    // Clear inactive subbands
-    for ( i = subband_activity[ch]; i < NumSubband; ++i )
-      raXin[i] = 0.0;
-
-    sample_t a, b;
-    for ( j = 0, k = 0; k < 16; k++, j += 16 )
-    {
-      a  = (raXin[0]  + raXin[1])  * cos_mod[j+0];
-      a += (raXin[2]  + raXin[3])  * cos_mod[j+1];
-      a += (raXin[4]  + raXin[5])  * cos_mod[j+2];
-      a += (raXin[6]  + raXin[7])  * cos_mod[j+3];
-      a += (raXin[8]  + raXin[9])  * cos_mod[j+4];
-      a += (raXin[10] + raXin[11]) * cos_mod[j+5];
-      a += (raXin[12] + raXin[13]) * cos_mod[j+6];
-      a += (raXin[14] + raXin[15]) * cos_mod[j+7];
-      a += (raXin[16] + raXin[17]) * cos_mod[j+8];
-      a += (raXin[18] + raXin[19]) * cos_mod[j+9];
-      a += (raXin[20] + raXin[21]) * cos_mod[j+10];
-      a += (raXin[22] + raXin[23]) * cos_mod[j+11];
-      a += (raXin[24] + raXin[25]) * cos_mod[j+12];
-      a += (raXin[26] + raXin[27]) * cos_mod[j+13];
-      a += (raXin[28] + raXin[29]) * cos_mod[j+14];
-      a += (raXin[30] + raXin[31]) * cos_mod[j+15];
-
-      b  = (raXin[0])              * cos_mod[256 + j+0];
-      b += (raXin[2]  + raXin[1])  * cos_mod[256 + j+1];
-      b += (raXin[4]  + raXin[3])  * cos_mod[256 + j+2];
-      b += (raXin[6]  + raXin[5])  * cos_mod[256 + j+3];
-      b += (raXin[8]  + raXin[7])  * cos_mod[256 + j+4];
-      b += (raXin[10] + raXin[9])  * cos_mod[256 + j+5];
-      b += (raXin[12] + raXin[11]) * cos_mod[256 + j+6];
-      b += (raXin[14] + raXin[13]) * cos_mod[256 + j+7];
-      b += (raXin[16] + raXin[15]) * cos_mod[256 + j+8];
-      b += (raXin[18] + raXin[17]) * cos_mod[256 + j+9];
-      b += (raXin[20] + raXin[19]) * cos_mod[256 + j+10];
-      b += (raXin[22] + raXin[21]) * cos_mod[256 + j+11];
-      b += (raXin[24] + raXin[23]) * cos_mod[256 + j+12];
-      b += (raXin[26] + raXin[25]) * cos_mod[256 + j+13];
-      b += (raXin[28] + raXin[27]) * cos_mod[256 + j+14];
-      b += (raXin[30] + raXin[29]) * cos_mod[256 + j+15];
-
-      subband_fir[k]      = cos_mod[k + 512] * (a+b);
-      subband_fir[32-k-1] = cos_mod[k + 528] * (a-b);
-    }
-
-    // Multiply by filter coefficients
-    for ( k = 31, i = 0; i < 32; ++i, --k )
-    {
-      a = subband_fir2[i];
-      b = subband_fir2[32+i];
-
-      a += prCoeff[i] * (subband_fir[i] - subband_fir[k]);
-      b += prCoeff[32+i]*(-subband_fir[i] - subband_fir[k]);
-      a += prCoeff[i+64] * (subband_fir[i+64] - subband_fir[k+64]);
-      b += prCoeff[32+i+64]*(-subband_fir[i+64] - subband_fir[k+64]);
-      a += prCoeff[i+128] * (subband_fir[i+128] - subband_fir[k+128]);
-      b += prCoeff[32+i+128]*(-subband_fir[i+128] - subband_fir[k+128]);
-      a += prCoeff[i+192] * (subband_fir[i+192] - subband_fir[k+192]);
-      b += prCoeff[32+i+192]*(-subband_fir[i+192] - subband_fir[k+192]);
-      a += prCoeff[i+256] * (subband_fir[i+256] - subband_fir[k+256]);
-      b += prCoeff[32+i+256]*(-subband_fir[i+256] - subband_fir[k+256]);
-      a += prCoeff[i+320] * (subband_fir[i+320] - subband_fir[k+320]);
-      b += prCoeff[32+i+320]*(-subband_fir[i+320] - subband_fir[k+320]);
-      a += prCoeff[i+384] * (subband_fir[i+384] - subband_fir[k+384]);
-      b += prCoeff[32+i+384]*(-subband_fir[i+384] - subband_fir[k+384]);
-      a += prCoeff[i+448] * (subband_fir[i+448] - subband_fir[k+448]);
-      b += prCoeff[32+i+448]*(-subband_fir[i+448] - subband_fir[k+448]);
-
-      subband_fir2[i] = a;
-      subband_fir2[32+i] = b;
-    }
-
-    // Create 32 PCM output samples
-    for ( i = 0; i < 32; ++i )
-      samples_out[nChIndex++] = subband_fir2[i] * scale;
-
-    // Update working arrays
-    for ( i = 512-16; i >= 32; i -= 16 )
-    {
-      subband_fir[i+0]  = subband_fir[i-32+0];
-      subband_fir[i+1]  = subband_fir[i-32+1];
-      subband_fir[i+2]  = subband_fir[i-32+2];
-      subband_fir[i+3]  = subband_fir[i-32+3];
-      subband_fir[i+4]  = subband_fir[i-32+4];
-      subband_fir[i+5]  = subband_fir[i-32+5];
-      subband_fir[i+6]  = subband_fir[i-32+6];
-      subband_fir[i+7]  = subband_fir[i-32+7];
-      subband_fir[i+8]  = subband_fir[i-32+8];
-      subband_fir[i+9]  = subband_fir[i-32+9];
-      subband_fir[i+10] = subband_fir[i-32+10];
-      subband_fir[i+11] = subband_fir[i-32+11];
-      subband_fir[i+12] = subband_fir[i-32+12];
-      subband_fir[i+13] = subband_fir[i-32+13];
-      subband_fir[i+14] = subband_fir[i-32+14];
-      subband_fir[i+15] = subband_fir[i-32+15];
-    }
-
-    for ( i = 0; i < NumSubband; ++i )
-      subband_fir2[i] = subband_fir2[i+32];
-
-    for ( i = 0; i < NumSubband; ++i )
-      subband_fir2[i+32] = 0.0;
-
-  } // for (nSubIndex=nStart; nSubIndex<nEnd; nSubIndex++)
-}
-
 void DtsFrameParser::lfe_interpolation_fir(int nDecimationSelect, int nNumDeciSample,
                                  double *samples_in, sample_t *samples_out,
                                  double scale)
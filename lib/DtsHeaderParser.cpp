@@ -64,45 +64,14 @@ public:
   {
   }
 
-  bool init ( BitReader br )
+  // Reader positioned at the start of the frame. 14-bit streams are read
+  // through a 14-bit view of the reader, so all formats share the layout.
+  bool init ( BitReader &br )
   {
-    br.reset();
-    // 16 bit formats
-    if ( br.getByte() == 0x7f
-            && br.getByte() == 0xfe
-            && br.getByte() == 0x80
-            && br.getByte() == 0x01 )
-    {
-        _is14Bit = false;
-    }
-    else
-    {
-      // 14 bit formats
-      br.reset();
-      if (br.getByte() == 0x1f
-        && br.getByte() == 0xff
-        && br.getByte() == 0xe8
-        && br.getByte() == 0x00
-        && br.getByte() == 0x07
-        && br.getByte(4) == 0xf)
-      {
-        _is14Bit = true;
-/*
- * The original code was this, not sure I can parse the 14bit the same as the
- * 16 bit, but I can look at that later if there are problems
-    sampleBlocks = ((be2uint16(hdr16[2]) << 4)  & 0x70)
-            | ((be2uint16(hdr16[3]) >> 10) & 0x0f);
-    ++sampleBlocks;
-    amode = (be2uint16(hdr16[4]) >> 4)  & 0x3f;
-    sfreq = (be2uint16(hdr16[4]) >> 0)  & 0x0f;
-    lfe   = (be2uint16(hdr16[6]) >> 11) & 0x03;
-*/
-      }
-      else
-      {
-        return false; // invalid frame data
-      }
-    }
+    if ( br.get(32) != 0x7ffe8001 )
+      return false; // invalid frame data
+
+    _is14Bit = br.getBsType() == BITSTREAM_14BE || br.getBsType() == BITSTREAM_14LE;
 
     _isNormalFrame = br.getBool(); // 1
     _shortSamples = br.getInt(5); // 6
@@ -133,6 +102,12 @@ public:
     _frontSum = br.getBool();
     _surroundSum = br.getBool();
     _dialogNormalization = br.getInt(4);
+
+    // 14-bit sync is 0x1fffe800 0x07fX, i.e. the sync word is followed
+    // by a normal frame with the short samples field set.
+    if ( _is14Bit && ! (_isNormalFrame && _shortSamples == 0x1f) )
+      return false;
+
     return true;
   }
 
@@ -146,11 +121,18 @@ public:
       return _sampleBlocks;
   }
 
+  // Frame size in 16-bit words (as coded)
   int getFrameSize(void) const
   {
       return _frameSize;
   }
 
+  // Frame size in the stream (14-bit words take 16 bits)
+  int getStreamFrameSize(void) const
+  {
+      return _is14Bit ? _frameSize * 16 / 14 : _frameSize;
+  }
+
   int getChannelLayout(void) const
   {
     return _channelLayout;
@@ -219,24 +201,10 @@ public:
   {
   }
 
-  DtsHdFrameInfo(BitReader br)
-    : _ssIndex(0)
-    , _headerSize(0)
-    , _hdSize(0)
+  bool init ( BitReader &br )
   {
-    init(br);
-  }
-
-  bool init ( BitReader br )
-  {
-    br.reset();
-    if ( br.getByte() != 0x64
-        || br.getByte() != 0x58
-        || br.getByte() != 0x20
-        || br.getByte() != 0x25 )
-    {
+    if ( br.get(32) != 0x64582025 )
         return false;
-    }
 
     // * dca.c dca_exss_parse_header
 
@@ -263,18 +231,26 @@ private:
 
 bool DtsHeaderParser::parseHeader(const uint8_t *hdr, HeaderInfo *hinfo)
 {
-  DtsFrameInfo dtsFi;
+  // The first byte of the sync word tells the bitstream type,
+  // so the header is read in place through a view of that type.
+  // The view covers all header data: 14-bit words carry 112 bits
+  // in 16 bytes, less than the 120 bits of the core header.
+
   int bsType;
-  bool isBigEndian(true);
 
-  if ( dtsFi.init(BitReader(hdr, 16, true)) )
-      bsType = dtsFi.getIs14Bit() ? BITSTREAM_14BE : BITSTREAM_16BE;
-  else if ( dtsFi.init(BitReader(hdr, 16, false)) )
+  switch ( hdr[0] )
   {
-      bsType = dtsFi.getIs14Bit() ? BITSTREAM_14LE : BITSTREAM_16LE;
-      isBigEndian = false;
+    case 0x7f: bsType = BITSTREAM_16BE; break;
+    case 0xfe: bsType = BITSTREAM_16LE; break;
+    case 0x1f: bsType = BITSTREAM_14BE; break;
+    case 0xff: bsType = BITSTREAM_14LE; break;
+    default: return false;
   }
-  else
+
+  BitReader br(hdr, getHeaderSize(), bsType);
+  DtsFrameInfo dtsFi;
+
+  if ( ! dtsFi.init(br) )
     return false;
 
   /////////////////////////////////////////////////////////
@@ -289,7 +265,15 @@ bool DtsHeaderParser::parseHeader(const uint8_t *hdr, HeaderInfo *hinfo)
   else if ( dtsFi.getLfe() == 3 ) // constraint
     return false;
 
-  DtsHdFrameInfo dtsHdFrameInfo(BitReader(hdr+dtsFi.getFrameSize(), 16, isBigEndian));
+  // DTS-HD substream follows 16-bit core frames only
+  // (and is seen only when it starts within the header)
+  DtsHdFrameInfo dtsHdFrameInfo;
+
+  if ( ! dtsFi.getIs14Bit() && size_t(dtsFi.getFrameSize()) + 16 <= getHeaderSize() )
+  {
+    br.init(hdr + dtsFi.getFrameSize(), 16, bsType);
+    dtsHdFrameInfo.init(br);
+  }
 
   if ( hinfo )
   {
@@ -313,7 +297,7 @@ bool DtsHeaderParser::parseHeader(const uint8_t *hdr, HeaderInfo *hinfo)
     }
 
     hinfo->setSpeakers(Speakers(FORMAT_DTS, mask, dtsFi.getSampleRate(), 1.0, relation));
-    hinfo->setFrameSize(dtsFi.getFrameSize() + dtsHdFrameInfo.getHdSize());
+    hinfo->setFrameSize(dtsFi.getStreamFrameSize() + dtsHdFrameInfo.getHdSize());
     hinfo->setDtsHdSize(dtsHdFrameInfo.getHdSize());
     hinfo->setScanSize(16384); // always scan up to maximum DTS frame size
     hinfo->setSampleCount(dtsFi.getSampleCount());
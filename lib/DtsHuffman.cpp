@@ -0,0 +1,117 @@
+#include "DtsHuffman.h"
+#include "DtsTablesHuffman.h"
+
+namespace AudioFilter {
+
+///////////////////////////////////////////////////////////////////////////////
+// DtsHuffTable
+///////////////////////////////////////////////////////////////////////////////
+
+void DtsHuffTable::init(const huff_entry_t *huff)
+{
+  int n;
+  int max_length(0);
+
+  for ( n = 0; huff[n].length != 0; ++n )
+    if ( huff[n].length > max_length )
+      max_length = huff[n].length;
+
+  peek_bits = max_length + 1;
+  root_bits = peek_bits < root_bits_max? peek_bits: root_bits_max;
+
+  const Entry invalid = { 0, uint8_t(peek_bits), 0 };
+  table.assign(size_t(1) << root_bits, invalid);
+
+  /////////////////////////////////////////////////////////
+  // Subtables: as long as the longest code of the prefix
+
+  std::vector<unsigned> sub_bits(size_t(1) << root_bits, 0);
+
+  for ( n = 0; huff[n].length != 0; ++n )
+  {
+    const unsigned length(huff[n].length);
+
+    if ( length > root_bits )
+    {
+      const unsigned prefix(huff[n].code >> (length - root_bits));
+
+      if ( sub_bits[prefix] < length - root_bits )
+        sub_bits[prefix] = length - root_bits;
+    }
+  }
+
+  for ( size_t prefix = 0; prefix < sub_bits.size(); ++prefix )
+  {
+    if ( sub_bits[prefix] )
+    {
+      const size_t offset(table.size());
+      table[prefix].value = int16_t(offset);
+      table[prefix].sub_bits = uint8_t(sub_bits[prefix]);
+      table.resize(offset + (size_t(1) << sub_bits[prefix]), invalid);
+    }
+  }
+
+  /////////////////////////////////////////////////////////
+  // Codes fill all entries they are a prefix of
+
+  for ( n = 0; huff[n].length != 0; ++n )
+  {
+    const unsigned length(huff[n].length);
+    const Entry code = { int16_t(huff[n].value), uint8_t(length), 0 };
+
+    size_t first, count;
+
+    if ( length <= root_bits )
+    {
+      first = size_t(huff[n].code) << (root_bits - length);
+      count = size_t(1) << (root_bits - length);
+    }
+    else
+    {
+      const unsigned rest_bits(length - root_bits);
+      const Entry &link = table[huff[n].code >> rest_bits];
+      const size_t rest(huff[n].code & ((1 << rest_bits) - 1));
+
+      first = link.value + (rest << (link.sub_bits - rest_bits));
+      count = size_t(1) << (link.sub_bits - rest_bits);
+    }
+
+    for ( size_t i = 0; i < count; ++i )
+      table[first + i] = code;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// DtsHuffTables
+///////////////////////////////////////////////////////////////////////////////
+
+DtsHuffTables::DtsHuffTables()
+{
+  int i, j;
+
+  for ( i = 0; i < 5; ++i )
+    bitalloc_12[i].init(AudioFilter::bitalloc_12[i]);
+
+  for ( i = 0; i < 5; ++i )
+    scales_129[i].init(AudioFilter::scales_129[i]);
+
+  for ( i = 0; i < 4; ++i )
+    tmode[i].init(AudioFilter::tmode[i]);
+
+  for ( i = 0; i < 11; ++i )
+    for ( j = 0; j < 8; ++j )
+    {
+      if ( AudioFilter::bitalloc_select[i][j] )
+        bitalloc_select[i][j].init(AudioFilter::bitalloc_select[i][j]);
+    }
+}
+
+const DtsHuffTables &DtsHuffTables::get(void)
+{
+  static const DtsHuffTables t;
+  return t;
+}
+
+}; // namespace AudioFilter
+
+// vim: ts=2 sts=2 et
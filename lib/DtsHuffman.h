@@ -0,0 +1,91 @@
+#pragma once
+#ifndef VALIB_DTS_HUFFMAN_H
+#define VALIB_DTS_HUFFMAN_H
+/*
+  DTS Huffman decoding tables
+
+  DtsHuffTable is a lookup table for a code table (huff_entry_t list
+  terminated by a zero length entry). The decoder peeks max_length + 1 bits
+  (the most the bit-by-bit search may read) and looks up the first
+  root_bits of them in the root table. Codes longer than the root table
+  are found in a subtable of their root prefix, indexed by the bits
+  following the prefix. So a symbol takes one table read, or two for long
+  codes.
+
+  A bit sequence that is not a code gives value 0 and skips max_length + 1
+  bits, as the bit-by-bit search did.
+
+  DtsHuffTables holds lookup tables for all code tables of the decoder,
+  in the layout of the code table arrays of DtsTablesHuffman.h. They are
+  built once and shared.
+*/
+
+#include <vector>
+#include <AudioFilter/BitReader.h>
+#include <AudioFilter/DtsDefs.h>
+
+namespace AudioFilter {
+
+class DtsHuffTable
+{
+public:
+  enum { root_bits_max = 9 };
+
+  DtsHuffTable(): root_bits(0), peek_bits(0)
+  {}
+
+  void init(const huff_entry_t *huff);
+
+  bool isEmpty(void) const
+  {
+    return table.empty();
+  }
+
+  int decode(BitReader &bs) const
+  {
+    const uint32_t w(bs.peek(peek_bits));
+    const Entry *e(&table[w >> (peek_bits - root_bits)]);
+
+    if ( e->sub_bits )
+    {
+      const unsigned shift(peek_bits - root_bits - e->sub_bits);
+      e = &table[e->value + ((w >> shift) & ((1 << e->sub_bits) - 1))];
+    }
+
+    bs.skip(e->length);
+    return e->value;
+  }
+
+protected:
+  // Code entry: value and length of the code.
+  // Subtable link: sub_bits != 0, value is the subtable offset.
+  struct Entry
+  {
+    int16_t value;
+    uint8_t length;
+    uint8_t sub_bits;
+  };
+
+  unsigned root_bits;
+  unsigned peek_bits;
+  std::vector<Entry> table;
+};
+
+struct DtsHuffTables
+{
+  DtsHuffTable bitalloc_12[5];
+  DtsHuffTable scales_129[5];
+  DtsHuffTable tmode[4];
+  DtsHuffTable bitalloc_select[11][8];
+
+  static const DtsHuffTables &get(void);
+
+private:
+  DtsHuffTables();
+};
+
+}; // namespace AudioFilter
+
+#endif
+
+// vim: ts=2 sts=2 et
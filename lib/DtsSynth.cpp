@@ -0,0 +1,430 @@
+#include <math.h>
+#include <string.h>
+#include <AudioFilter/DtsSynth.h>
+
+#include "DtsTablesFir.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define SYNTH_VECTOR
+#define SYNTH_INLINE inline __attribute__((always_inline))
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX __attribute__((target("avx")))
+#else
+#define SYNTH_INLINE inline
+#endif
+
+namespace AudioFilter {
+
+namespace {
+
+const int bitrev16[16] = { 0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15 };
+
+///////////////////////////////////////////////////////////////////////////////
+// Shared tables
+//
+// DCT-IV of 32 points x[n] is done as a 16-point FFT of
+// z[n] = (x[2n] + i*x[31-2n]) * exp(-i*pi*(4n+1)/128), the output
+// y[k] = Z[k] * exp(-i*pi*k/32) gives X[2k] = re(y[k]) and
+// X[31-2k] = -im(y[k]).
+//
+// pre_re/im  - pre-FFT twiddles (in FFT input order)
+// fft_re/im  - FFT twiddles exp(-2*pi*i*k/16)
+// post_re/im - post-FFT twiddles
+// win        - window of each filter (non-perfect, perfect) for
+//              the history block of age 2m. Lanes 0-15 make output
+//              j, lanes 16-31 make output 31-j (from the antisymmetric
+//              half of the block), lanes 32-63 make the carry for the
+//              next output the same way (from the symmetric half).
+
+template <class T>
+struct DtsSynthTables
+{
+  T pre_re[16];
+  T pre_im[16];
+  T fft_re[8];
+  T fft_im[8];
+  T post_re[16];
+  T post_im[16];
+  T win[2][8][64];
+
+  DtsSynthTables();
+};
+
+template <class T>
+DtsSynthTables<T>::DtsSynthTables()
+{
+  int i, j, m;
+
+  for ( i = 0; i < 16; i++ )
+  {
+    pre_re[bitrev16[i]] = T(cos(M_PI * (4 * i + 1) / 128));
+    pre_im[bitrev16[i]] = T(sin(M_PI * (4 * i + 1) / 128));
+    post_re[i] = T(cos(M_PI * i / 32));
+    post_im[i] = T(sin(M_PI * i / 32));
+  }
+
+  for ( i = 0; i < 8; i++ )
+  {
+    fft_re[i] = T(cos(2 * M_PI * i / 16));
+    fft_im[i] = T(-sin(2 * M_PI * i / 16));
+  }
+
+  for ( int f = 0; f < 2; f++ )
+  {
+    const double *fir = f? fir_32bands_perfect: fir_32bands_nonperfect;
+
+    for ( m = 0; m < 8; m++ )
+      for ( j = 0; j < 16; j++ )
+      {
+        win[f][m][j]      = T( 0.25 * fir[64 * m + j]);
+        win[f][m][16 + j] = T(-0.25 * fir[64 * m + 31 - j]);
+        win[f][m][32 + j] = T( 0.25 * fir[64 * m + 32 + j]);
+        win[f][m][48 + j] = T( 0.25 * fir[64 * m + 63 - j]);
+      }
+  }
+}
+
+template <class T>
+const DtsSynthTables<T> &tables(void)
+{
+  static const DtsSynthTables<T> t;
+  return t;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Filter
+//
+// Templates take the sample type of the filter and a vector of it (the same
+// type for the scalar implementation). The modulation processes a vector of
+// samples at a time, the window a vector of outputs.
+
+template <class V, class T>
+SYNTH_INLINE void load(V &v, const T *p)
+{
+  memcpy(&v, p, sizeof(V));
+}
+
+template <class V, class T>
+SYNTH_INLINE void store(T *p, const V &v)
+{
+  memcpy(p, &v, sizeof(V));
+}
+
+// Modulated blocks of 8 samples of 32 subbands x[32][8] (lanes of a vector
+// are successive samples): antisymmetric half d[k] = X[k] - X[31-k] and
+// symmetric half d[16+k] = -X[k] - X[31-k] for k = 0..15, X is the DCT-IV
+// of a sample (the 1/4 is in the window). d is [32][8] as well.
+
+template <class V, class T>
+SYNTH_INLINE void modulate(const DtsSynthTables<T> &t, const T *x, T *d)
+{
+  const int lanes = sizeof(V) / sizeof(T);
+
+  for ( int s = 0; s < 8; s += lanes )
+  {
+    V re[16], im[16], a, b;
+    int i, k;
+
+    for ( i = 0; i < 16; i++ )
+    {
+      const int n = bitrev16[i];
+      load(a, x + 8 * (2 * n) + s);
+      load(b, x + 8 * (31 - 2 * n) + s);
+      re[i] = a * t.pre_re[i] + b * t.pre_im[i];
+      im[i] = b * t.pre_re[i] - a * t.pre_im[i];
+    }
+
+    for ( int half = 1; half < 16; half *= 2 )
+      for ( k = 0; k < half; k++ )
+      {
+        const T wr = t.fft_re[k * 8 / half];
+        const T wi = t.fft_im[k * 8 / half];
+
+        for ( i = k; i < 16; i += 2 * half )
+        {
+          const int j = i + half;
+          const V xr = re[j] * wr - im[j] * wi;
+          const V xi = re[j] * wi + im[j] * wr;
+          re[j] = re[i] - xr;
+          im[j] = im[i] - xi;
+          re[i] += xr;
+          im[i] += xi;
+        }
+      }
+
+    // X[2k] = yr, X[31-2k] = -yi for even outputs,
+    // X[2k+1] = -yi, X[30-2k] = yr of y[15-k] for odd ones.
+    for ( k = 0; k < 16; k++ )
+    {
+      const V yr = re[k] * t.post_re[k] + im[k] * t.post_im[k];
+      const V yi = im[k] * t.post_re[k] - re[k] * t.post_im[k];
+
+      if ( k < 8 )
+      {
+        store(d + 8 * (2 * k) + s,      V(yr + yi));
+        store(d + 8 * (16 + 2 * k) + s, V(yi - yr));
+      }
+      else
+      {
+        store(d + 8 * (31 - 2 * k) + s, V(-yr - yi));
+        store(d + 8 * (47 - 2 * k) + s, V(yi - yr));
+      }
+    }
+  }
+}
+
+// out[j] = carry[j] + (window of the even aged blocks)[j], the second
+// half of the window goes to the carry. res and carry keep outputs
+// 16-31 in the backward order.
+
+template <class V, class T>
+SYNTH_INLINE void window(const T *win, const T *hist, int pos, T *carry, T *res)
+{
+  const int lanes = sizeof(V) / sizeof(T);
+
+  for ( int j = 0; j < 16; j += lanes )
+  {
+    V d1, d2, w, c, a0, a1, a2, a3;
+    const T *d = hist + 32 * pos;
+
+    load(d1, d + j);
+    load(d2, d + 16 + j);
+    load(w, win + j);      a0 = w * d1;
+    load(w, win + 16 + j); a1 = w * d1;
+    load(w, win + 32 + j); a2 = w * d2;
+    load(w, win + 48 + j); a3 = w * d2;
+
+    for ( int m = 1; m < 8; m++ )
+    {
+      const T *wm = win + 64 * m;
+      d = hist + 32 * ((pos + 2 * m) & 15);
+
+      load(d1, d + j);
+      load(d2, d + 16 + j);
+      load(w, wm + j);      a0 += w * d1;
+      load(w, wm + 16 + j); a1 += w * d1;
+      load(w, wm + 32 + j); a2 += w * d2;
+      load(w, wm + 48 + j); a3 += w * d2;
+    }
+
+    load(c, carry + j);      store(res + j, V(c + a0));
+    load(c, carry + 16 + j); store(res + 16 + j, V(c + a1));
+    store(carry + j, a2);
+    store(carry + 16 + j, a3);
+  }
+}
+
+template <class V, class T>
+SYNTH_INLINE void synth(const double in[32][8], int nbands, bool perfect, sample_t *out, double scale, T *hist, T *carry, int &pos)
+{
+  const DtsSynthTables<T> &t = tables<T>();
+  const T *win = &t.win[perfect? 1: 0][0][0];
+  const T s = T(1.0 / scale);
+
+  T x[32][8], d[32][8], res[32];
+  int i, j, n;
+
+  for ( i = 0; i < nbands; i++ )
+    for ( n = 0; n < 8; n++ )
+      x[i][n] = T(in[i][n]);
+
+  for ( ; i < 32; i++ )
+    for ( n = 0; n < 8; n++ )
+      x[i][n] = 0;
+
+  modulate<V>(t, &x[0][0], &d[0][0]);
+
+  for ( n = 0; n < 8; n++ )
+  {
+    pos = (pos - 1) & 15;
+
+    T *h = hist + 32 * pos;
+    for ( j = 0; j < 32; j++ )
+      h[j] = d[j][n];
+
+    window<V>(win, hist, pos, carry, res);
+
+    for ( j = 0; j < 16; j++ )
+    {
+      out[j]      = sample_t(res[j] * s);
+      out[31 - j] = sample_t(res[16 + j] * s);
+    }
+
+    out += 32;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Implementations
+
+typedef void (*synth_double_t)(const double in[32][8], int nbands, bool perfect, sample_t *out, double scale, double *hist, double *carry, int &pos);
+typedef void (*synth_float_t)(const double in[32][8], int nbands, bool perfect, sample_t *out, double scale, float *hist, float *carry, int &pos);
+
+void synthDoubleScalar(const double in[32][8], int nbands, bool perfect, sample_t *out, double scale, double *hist, double *carry, int &pos)
+{
+  synth<double>(in, nbands, perfect, out, scale, hist, carry, pos);
+}
+
+void synthFloatScalar(const double in[32][8], int nbands, bool perfect, sample_t *out, double scale, float *hist, float *carry, int &pos)
+{
+  synth<float>(in, nbands, perfect, out, scale, hist, carry, pos);
+}
+
+#ifdef SYNTH_VECTOR
+
+typedef double vec128d_t __attribute__((vector_size(16)));
+typedef double vec256d_t __attribute__((vector_size(32)));
+typedef float  vec128f_t __attribute__((vector_size(16)));
+typedef float  vec256f_t __attribute__((vector_size(32)));
+
+TARGET_SSE2
+void synthDoubleSse2(const double in[32][8], int nbands, bool perfect, sample_t *out, double scale, double *hist, double *carry, int &pos)
+{
+  synth<vec128d_t>(in, nbands, perfect, out, scale, hist, carry, pos);
+}
+
+TARGET_SSE2
+void synthFloatSse2(const double in[32][8], int nbands, bool perfect, sample_t *out, double scale, float *hist, float *carry, int &pos)
+{
+  synth<vec128f_t>(in, nbands, perfect, out, scale, hist, carry, pos);
+}
+
+TARGET_AVX
+void synthDoubleAvx(const double in[32][8], int nbands, bool perfect, sample_t *out, double scale, double *hist, double *carry, int &pos)
+{
+  synth<vec256d_t>(in, nbands, perfect, out, scale, hist, carry, pos);
+}
+
+TARGET_AVX
+void synthFloatAvx(const double in[32][8], int nbands, bool perfect, sample_t *out, double scale, float *hist, float *carry, int &pos)
+{
+  synth<vec256f_t>(in, nbands, perfect, out, scale, hist, carry, pos);
+}
+
+int detectImpl(void)
+{
+  __builtin_cpu_init();
+
+  if ( __builtin_cpu_supports("avx") )
+    return DtsSynth::impl_avx;
+
+  if ( __builtin_cpu_supports("sse2") )
+    return DtsSynth::impl_sse2;
+
+  return DtsSynth::impl_scalar;
+}
+
+#else
+
+int detectImpl(void)
+{
+  return DtsSynth::impl_scalar;
+}
+
+#endif
+
+int bestImpl(void)
+{
+  static const int best = detectImpl();
+  return best;
+}
+
+}; // anonymous namespace
+
+///////////////////////////////////////////////////////////////////////////////
+// DtsSynth
+///////////////////////////////////////////////////////////////////////////////
+
+DtsSynth::DtsSynth()
+  : impl(impl_auto)
+  , precision(sizeof(sample_t) == sizeof(float)? prec_float: prec_double)
+{
+  // build the shared tables now rather than on the first block
+  tables<double>();
+  tables<float>();
+  reset();
+}
+
+void DtsSynth::reset(void)
+{
+  pos = 0;
+  memset(hist, 0, sizeof(hist));
+  memset(carry, 0, sizeof(carry));
+  memset(hist_f, 0, sizeof(hist_f));
+  memset(carry_f, 0, sizeof(carry_f));
+}
+
+bool DtsSynth::isImplSupported(int _impl)
+{
+  switch ( _impl )
+  {
+    case impl_auto:
+    case impl_scalar:
+      return true;
+
+    case impl_sse2:
+    case impl_avx:
+      return bestImpl() >= _impl;
+  }
+
+  return false;
+}
+
+bool DtsSynth::setImpl(int _impl)
+{
+  if ( ! isImplSupported(_impl) )
+    return false;
+
+  impl = _impl;
+  return true;
+}
+
+int DtsSynth::getImpl(void) const
+{
+  return impl == impl_auto ? bestImpl() : impl;
+}
+
+void DtsSynth::setPrecision(int _precision)
+{
+  if ( _precision != prec_float )
+    _precision = prec_double;
+
+  if ( precision != _precision )
+  {
+    precision = _precision;
+    reset();
+  }
+}
+
+void DtsSynth::synth(const double in[32][8], int nbands, bool perfect, sample_t *out, double scale)
+{
+  if ( nbands < 0 ) nbands = 0;
+  if ( nbands > 32 ) nbands = 32;
+
+  synth_double_t synth_double = synthDoubleScalar;
+  synth_float_t  synth_float  = synthFloatScalar;
+
+  switch ( getImpl() )
+  {
+#ifdef SYNTH_VECTOR
+    case impl_avx:
+      synth_double = synthDoubleAvx;
+      synth_float  = synthFloatAvx;
+      break;
+
+    case impl_sse2:
+      synth_double = synthDoubleSse2;
+      synth_float  = synthFloatSse2;
+      break;
+#endif
+  }
+
+  if ( precision == prec_float )
+    synth_float(in, nbands, perfect, out, scale, &hist_f[0][0], carry_f, pos);
+  else
+    synth_double(in, nbands, perfect, out, scale, &hist[0][0], carry, pos);
+}
+
+}; // namespace AudioFilter
+
+// vim: ts=2 sts=2 et
@@ -1,15 +1,18 @@
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <math.h>
 #include <AudioFilter/SpdifWrapper.h>
 #include <AudioFilter/FileParser.h>
+#include "Thread.h"
 
 #define FLOAT_THRESHOLD 1e-20
 
 namespace {
 
 const size_t max_buf_size(65536);
+const size_t max_map_window(1 << 20); // input window for a mapped file
 
 int compactSize(AudioFilter::AutoFile::fsize_t size)
 {
@@ -39,23 +42,58 @@ const char *compactSuffix(AudioFilter::AutoFile::fsize_t size)
 
 namespace AudioFilter {
 
+///////////////////////////////////////////////////////////////////////////////
+// FrameIndexBuilder - builds the frame index in a background thread
+
+class FrameIndexBuilder : public Thread
+{
+public:
+  FrameIndex index;
+  volatile bool done;
+  bool result;
+
+  FrameIndexBuilder(const char *_filename, HeaderParser *_parser)
+    : done(false), result(false), filename(_filename), parser(_parser)
+  {}
+
+  ~FrameIndexBuilder()
+  {
+    terminate();
+  }
+
+protected:
+  std::string filename;
+  HeaderParser *parser;
+
+  virtual int process(void)
+  {
+    result = index.build(filename.c_str(), parser, &f_terminate);
+    done = true;
+    return 0;
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// FileParser
+
 FileParser::FileParser()
   : filename()
 {
   init();
 }
 
-FileParser::FileParser(const char *_filename, HeaderParser *_parser, size_t _max_scan)
+FileParser::FileParser(const char *_filename, HeaderParser *_parser, size_t _max_scan, size_t _prefetch_depth)
   : filename()
 {
   init();
-  open(_filename, _parser, _max_scan);
+  open(_filename, _parser, _max_scan, _prefetch_depth);
 }
 
 void FileParser::init(void)
 {
   buf = new uint8_t[max_buf_size];
   buf_size = max_buf_size;
+  in = buf;
   buf_data = 0;
   buf_pos = 0;
 
@@ -65,6 +103,7 @@ void FileParser::init(void)
 
   max_scan = 0;
   _intHeaderParser = 0;
+  builder = 0;
 }
 
 FileParser::~FileParser()
@@ -81,7 +120,7 @@ FileParser::~FileParser()
 ///////////////////////////////////////////////////////////////////////////////
 // File operations
 
-bool FileParser::open(const char *_filename, HeaderParser *_parser, size_t _max_scan)
+bool FileParser::open(const char *_filename, HeaderParser *_parser, size_t _max_scan, size_t _prefetch_depth)
 {
   if ( ! _filename )
     return false;
@@ -97,6 +136,9 @@ bool FileParser::open(const char *_filename, HeaderParser *_parser, size_t _max_
     max_scan = _max_scan;
     filename = _filename;
 
+    if ( _prefetch_depth )
+      f.prefetch(_prefetch_depth);
+
     reset();
     return true;
   }
@@ -106,6 +148,8 @@ bool FileParser::open(const char *_filename, HeaderParser *_parser, size_t _max_
 
 void FileParser::close(void)
 {
+  stopIndex();
+  index.clear();
   stream.releaseParser();
   f.close();
   stat_size = 0;
@@ -118,28 +162,33 @@ bool FileParser::probe(void)
 {
   if ( f )
   {
-    fsize_t old_pos(f.pos());
+    fsize_t old_pos(getPos());
     bool result(loadFrame());
-    f.seek(old_pos);
+    seek(old_pos);
     return result;
   }
 
   return false;
 }
 
-bool FileParser::stats(unsigned max_measurements, vtime_t precision)
+bool FileParser::stats(unsigned max_measurements, vtime_t precision, RNG *rng)
 {
   if ( ! f )
     return false;
 
-  fsize_t old_pos = f.pos();
+  // The index gives exact stats
+
+  if ( pollIndex() )
+    return indexStats();
+
+  fsize_t old_pos = getPos();
 
   /* If we cannot load a frame we will not gather any stats.
    * (If file format is unknown, measurements may take a lot of time)
    */
   if ( ! loadFrame() )
   {
-    f.seek(old_pos);
+    seek(old_pos);
     return false;
   }
 
@@ -154,7 +203,9 @@ bool FileParser::stats(unsigned max_measurements, vtime_t precision)
 
   for ( unsigned int i = 0; i < max_measurements; ++i )
   {
-    fsize_t file_pos = fsize_t((double)rand() * f.size() / RAND_MAX);
+    fsize_t file_pos = rng
+      ? fsize_t((double)rng->getNext() * f.size() / 0x7fffffff)
+      : fsize_t((double)rand() * f.size() / RAND_MAX);
     f.seek(file_pos);
 
     if ( ! loadFrame() )
@@ -194,6 +245,19 @@ bool FileParser::stats(unsigned max_measurements, vtime_t precision)
   return stat_size > 0;
 }
 
+bool FileParser::indexStats(void)
+{
+  const vtime_t duration(index.getDuration());
+
+  if ( duration <= 0 )
+    return false;
+
+  stat_size = index.getFrameCount();
+  avg_frame_interval = float(double(f.size()) / stat_size);
+  avg_bitrate = float(double(f.size()) * 8 / duration);
+  return true;
+}
+
 std::string FileParser::getFileInfo(void) const
 {
   char info[1024];
@@ -265,6 +329,16 @@ FileParser::fsize_t FileParser::getPos(void) const
 
 double FileParser::getPos(units_t units) const
 {
+  if ( ! index.isEmpty() && (units == frames || units == time) )
+  {
+    FrameIndexEntry entry;
+
+    if ( ! index.getEntry(index.findPos(getPos()), entry) )
+      return 0;
+
+    return units == frames ? double(entry.frame) : entry.time;
+  }
+
   return getPos() * getUnitsFactor(units);
 }
 
@@ -275,6 +349,12 @@ FileParser::fsize_t FileParser::getSize(void) const
 
 double FileParser::getSize(units_t units) const
 {
+  if ( ! index.isEmpty() && units == frames )
+    return double(index.getFrameCount());
+
+  if ( ! index.isEmpty() && units == time )
+    return index.getDuration();
+
   return f.size() * getUnitsFactor(units);
 }
 
@@ -288,6 +368,17 @@ int FileParser::seek(fsize_t pos)
 
 int FileParser::seek(double pos, units_t units)
 {
+  if ( pollIndex() && (units == frames || units == time) )
+  {
+    const size_t frame(units == frames
+      ? (pos > 0 ? std::min(size_t(pos), index.getFrameCount() - 1) : 0)
+      : index.findTime(pos));
+
+    FrameIndexEntry entry;
+    index.getEntry(frame, entry);
+    return seek(entry.pos);
+  }
+
   const double factor(getUnitsFactor(units));
 
   if ( factor > FLOAT_THRESHOLD )
@@ -296,9 +387,120 @@ int FileParser::seek(double pos, units_t units)
   return -1;
 }
 
+bool FileParser::map(void)
+{
+  return f.map();
+}
+
+bool FileParser::prefetch(size_t depth)
+{
+  if ( ! depth )
+  {
+    f.stopPrefetch();
+    return true;
+  }
+
+  return f.prefetch(depth);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Frame index
+
+bool FileParser::buildIndex(void)
+{
+  if ( ! f || ! stream.getParser() )
+    return false;
+
+  stopIndex();
+  return index.build(filename.c_str(), stream.getParser());
+}
+
+bool FileParser::startIndex(HeaderParser *parser)
+{
+  if ( ! f || ! parser )
+    return false;
+
+  stopIndex();
+  builder = new FrameIndexBuilder(filename.c_str(), parser);
+
+  if ( ! builder->create() )
+  {
+    delete builder;
+    builder = 0;
+    return false;
+  }
+
+  return true;
+}
+
+void FileParser::stopIndex(void)
+{
+  if ( builder )
+  {
+    delete builder;
+    builder = 0;
+  }
+}
+
+bool FileParser::isIndexReady(void)
+{
+  return pollIndex();
+}
+
+// Take the index from the builder when it is done.
+// Returns true when the index is ready to use.
+
+bool FileParser::pollIndex(void)
+{
+  if ( builder && builder->done )
+  {
+    builder->join();
+
+    if ( builder->result )
+      index = builder->index;
+
+    delete builder;
+    builder = 0;
+  }
+
+  return ! index.isEmpty();
+}
+
+bool FileParser::loadIndex(void)
+{
+  if ( ! f )
+    return false;
+
+  stopIndex();
+  return index.load(FrameIndex::sidecarName(filename.c_str()).c_str(), f.size());
+}
+
+bool FileParser::saveIndex(void) const
+{
+  if ( ! f || index.isEmpty() )
+    return false;
+
+  return index.save(FrameIndex::sidecarName(filename.c_str()).c_str());
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Frame-level interface (StreamBuffer interface wrapper)
 
+// File offset of the frame loaded. The frame is either in the input (loaded
+// in place) or in the stream's sync buffer, which always ends at the current
+// position.
+
+FileParser::fsize_t FileParser::getFramePos(void) const
+{
+  const uint8_t *frame(stream.getFrame());
+
+  if ( frame >= in && frame < in + buf_data )
+    return fsize_t(f.pos() - buf_data + (frame - in));
+
+  const uint8_t *sync_end(stream.getBuffer() + stream.getBufferSize());
+  return getPos() - fsize_t(sync_end - frame);
+}
+
 void FileParser::reset(void)
 {
   buf_data = 0;
@@ -315,20 +517,20 @@ bool FileParser::loadFrame(void)
     ///////////////////////////////////////////////////////
     // Load a frame
 
-    uint8_t *pos(buf + buf_pos);
-    uint8_t *end(buf + buf_data);
+    uint8_t *pos(in + buf_pos);
+    uint8_t *end(in + buf_data);
 
     if ( stream.loadFrame(&pos, end) )
     {
-      buf_pos = pos - buf;
+      buf_pos = pos - in;
       return true;
     }
 
     ///////////////////////////////////////////////////////
     // Stop file scanning if scanned too much
 
-    sync_size += (pos - buf) - buf_pos;
-    buf_pos = pos - buf;
+    sync_size += (pos - in) - buf_pos;
+    buf_pos = pos - in;
 
     if ( max_scan > 0 ) // do limiting
     {
@@ -349,8 +551,20 @@ bool FileParser::loadFrame(void)
       buf_data -= buf_pos;
       */
 
+      // A mapped or prefetched file is parsed in place
+
       buf_pos = 0;
-      buf_data = fread(buf, 1, max_buf_size, f);
+
+      if ( f.isMapped() || f.isPrefetching() )
+      {
+        buf_data = max_map_window;
+        in = f.readDirect(buf_data);
+      }
+      else
+      {
+        buf_data = f.read(buf, max_buf_size);
+        in = buf;
+      }
 
       if ( ! buf_data )
         return false;
@@ -17,7 +17,16 @@ namespace AudioFilter {
 FilterGraph::FilterGraph(int _format_mask)
   :start(_format_mask)
   , end(-1)
+  , profiling(false)
+  , fusion(false)
+  , nfused(0)
+  , bypass(true)
+  , rechunking(false)
+  , low_latency(false)
 {
+  for ( int i = 0; i < graph_size; ++i )
+    stats[i].node = i;
+
   filter[node_start] = &start;
   filter[node_end]   = &end;
   dropChain();
@@ -53,6 +62,7 @@ FilterGraph::buildChain(int node)
     node = next[node];
   }
 
+  fuseChain();
   return true;
 }
 
@@ -67,6 +77,7 @@ void
 FilterGraph::dropChain(void)
 {
   ofdd = false;
+  unfuseChain();
 
   start.reset();
   end.reset();
@@ -170,7 +181,7 @@ FilterGraph::addNode(int node, Speakers spk)
   ///////////////////////////////////////////////////////
   // find the next node
 
-  int next_node = getNext(node, spk);
+  int next_node = nextNode(node, spk);
 
   // runtime protection
   // we may check get_next() result only here because
@@ -211,15 +222,42 @@ FilterGraph::addNode(int node, Speakers spk)
   // must do it BEFORE updating of filter lists
   // otherwise filter list may be broken in case of failure
 
+  if ( low_latency )
+    filter[next_node]->setLowLatency(true);
+
   if ( ! filter[next_node]->setInput(spk) )
     return false;
 
+  // insert a rechunker in front of the filter
+  // if it asks for a block size
+
+  int first_node = next_node;
+
+  if ( ! isAdapter(node) && needAdapter(next_node, spk) )
+  {
+    BlockSize block_size;
+    filter[next_node]->getBlockSize(block_size);
+
+    first_node = adapter_base + next_node;
+    filter[first_node] = &adapter[next_node];
+
+    if ( ! adapter[next_node].setMultiple(block_size.multiple) ||
+         ! adapter[next_node].setInput(spk) )
+      return false;
+
+    next[first_node] = next_node;
+    prev[next_node] = first_node;
+    node_state[first_node] = ns_ok;
+    ++stats[first_node].rebuilds;
+  }
+
   // update filter lists
-  next[node] = next_node;
-  prev[next_node] = node;
+  next[node] = first_node;
+  prev[first_node] = node;
   next[next_node] = node_end;
   prev[node_end] = next_node;
   node_state[next_node] = ns_ok;
+  ++stats[next_node].rebuilds;
 
   // update ofdd status
   // aggregate is data-dependent if chain has
@@ -237,6 +275,186 @@ FilterGraph::addNode(int node, Speakers spk)
   return true;
 }
 
+/////////////////////////////////////////////////////////
+// Fuse gain filters into the following filter
+//
+// void fuse_chain()
+// updates fusion of the whole chain (filters fused
+// before are restored first)
+
+void
+FilterGraph::fuseChain(void)
+{
+  unfuseChain();
+
+  if ( ! fusion )
+    return;
+
+  const double *gains[graph_nodes];
+  int run[graph_nodes];
+  int node = next[node_start];
+
+  while ( node != node_end )
+  {
+    // find a run of gain filters
+
+    int ngains = 0;
+    const double *gain;
+
+    while ( node != node_end && (gain = filter[node]->fuseGain(false)) != 0 )
+    {
+      gains[ngains] = gain;
+      run[ngains] = node;
+      ++ngains;
+      node = next[node];
+    }
+
+    if ( node == node_end )
+      break;
+
+    // fuse the run into the filter that follows it
+
+    if ( ngains && filter[node]->setInputGains(gains, ngains) )
+    {
+      for ( int i = 0; i < ngains; ++i )
+      {
+        filter[run[i]]->fuseGain(true);
+        fused[nfused++] = filter[run[i]];
+      }
+
+      fused[nfused++] = filter[node];
+    }
+
+    node = next[node];
+  }
+}
+
+void
+FilterGraph::unfuseChain(void)
+{
+  for ( int i = 0; i < nfused; ++i )
+  {
+    fused[i]->fuseGain(false);
+    fused[i]->setInputGains(0, 0);
+  }
+
+  nfused = 0;
+}
+
+void
+FilterGraph::setFusion(bool _fusion)
+{
+  fusion = _fusion;
+  fuseChain();
+}
+
+bool
+FilterGraph::getFusion(void) const
+{
+  return fusion;
+}
+
+/////////////////////////////////////////////////////////
+// Rechunker nodes
+//
+// int next_node(int node, Speakers spk)
+//   get_next() for graph nodes, the filter node for
+//   rechunker nodes
+//
+// bool need_adapter(int node, Speakers spk)
+//   node's filter (initialized with spk) must have a
+//   rechunker in front of it
+
+int
+FilterGraph::nextNode(int node, Speakers spk) const
+{
+  if ( isAdapter(node) )
+    return node - adapter_base;
+
+  return getNext(node, spk);
+}
+
+const char *
+FilterGraph::nodeName(int node) const
+{
+  if ( isAdapter(node) )
+    return "Rechunker";
+
+  return getName(node);
+}
+
+bool
+FilterGraph::needAdapter(int node, Speakers spk) const
+{
+  BlockSize block_size;
+
+  if ( ! spk.isLinear() || ! filter[node]->getBlockSize(block_size) )
+    return false;
+
+  if ( block_size.multiple <= 1 )
+    return false;
+
+  if ( block_size.required )
+    return true;
+
+  return rechunking && ! low_latency &&
+    ( ! block_size.max_latency || block_size.multiple - 1 <= block_size.max_latency );
+}
+
+void
+FilterGraph::setRechunking(bool _rechunking)
+{
+  rechunking = _rechunking;
+}
+
+bool
+FilterGraph::getRechunking(void) const
+{
+  return rechunking;
+}
+
+/////////////////////////////////////////////////////////
+// Find the node to send the data to
+//
+// int data_next(int node, Speakers spk)
+// node - node that outputs the data
+// spk - format of the data
+// returns the next node skipping identity nodes
+
+int
+FilterGraph::dataNext(int node, Speakers spk) const
+{
+  int dst = next[node];
+
+  if ( ! bypass )
+    return dst;
+
+  while ( dst != node_end
+    && node_state[dst] == ns_ok
+    && node_state[next[dst]] <= ns_dirty
+    && filter[dst]->isIdentity()
+    && filter[dst]->isEmpty()
+    && filter[dst]->getOutput() == spk
+    && filter[next[dst]]->getInput() == spk )
+  {
+    dst = next[dst];
+  }
+
+  return dst;
+}
+
+void
+FilterGraph::setBypass(bool _bypass)
+{
+  bypass = _bypass;
+}
+
+bool
+FilterGraph::getBypass(void) const
+{
+  return bypass;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Chain data flow
 ///////////////////////////////////////////////////////////////////////////////
@@ -298,7 +516,12 @@ FilterGraph::processInternal(bool rebuild)
       //
       // If chain changes without format change we must
       // flush downstream before rebuilding the chain.
-      if ( next[node] != getNext(node, spk) )
+      int next_node = next[node];
+
+      if ( isAdapter(next_node) )
+        next_node -= adapter_base;
+
+      if ( next_node != nextNode(node, spk) )
         node_state[next[node]] = ns_flush;
       else
         node_state[node] = ns_ok;
@@ -307,28 +530,33 @@ FilterGraph::processInternal(bool rebuild)
     /////////////////////////////////////////////////////
     // process data downstream
 
-    if ( node_state[next[node]] == ns_flush )
+    int dst = next[node];
+
+    if ( node_state[dst] == ns_flush )
     {
       // flush downstream
       chunk.setEmpty(spk, false, 0, true);
 
-      if ( ! filter[next[node]]->process(&chunk) )
+      if ( ! nodeProcess(dst, &chunk) )
         return false;
 
-      node_state[next[node]] = ns_rebuild;
+      node_state[dst] = ns_rebuild;
     }
     else
     {
       // process data
-      if ( ! filter[node]->getChunk(&chunk) )
+      // (identity nodes are skipped)
+      dst = dataNext(node, spk);
+
+      if ( ! nodeGetChunk(node, &chunk) )
         return false;
 
-      if ( ! filter[next[node]]->process(&chunk) )
+      if ( ! nodeProcess(dst, &chunk) )
         return false;
 
     }
 
-    node = next[node];
+    node = dst;
   }
 
   return true;
@@ -370,13 +598,13 @@ FilterGraph::chainText(char *buf, size_t buf_size) const
 
     if ( spk.getMask() || spk.getSampleRate() )
       i = snprintf(buf_ptr, buf_size, " -> %s -> (%s %s %i)"
-                    , getName(node)
+                    , nodeName(node)
                     , spk.getFormatText()
                     , spk.getModeText()
                     , spk.getSampleRate());
     else
       i = snprintf(buf_ptr, buf_size, " -> %s -> (%s)"
-                    , getName(node)
+                    , nodeName(node)
                     , spk.getFormatText());
 
     buf_ptr += i;
@@ -388,6 +616,250 @@ FilterGraph::chainText(char *buf, size_t buf_size) const
   return buf_ptr - buf;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Profiling
+///////////////////////////////////////////////////////////////////////////////
+
+static inline void countData(const Chunk *chunk, uint64_t &chunks, uint64_t &bytes, uint64_t &samples)
+{
+  if ( chunk->isDummy() )
+    return;
+
+  ++chunks;
+
+  if ( chunk->spk.isLinear() )
+    samples += chunk->size;
+  else
+    bytes += chunk->size;
+}
+
+static inline void countTime(vtime_t time, vtime_t &total, vtime_t &max)
+{
+  total += time;
+
+  if ( time > max )
+    max = time;
+}
+
+/////////////////////////////////////////////////////////
+// Node calls
+//
+// Only one branch is added to each call when profiling
+// is disabled.
+
+bool
+FilterGraph::nodeProcess(int node, const Chunk *chunk)
+{
+  if ( chunk->eos )
+    ++stats[node].flushes;
+
+  if ( ! profiling )
+    return filter[node]->process(chunk);
+
+  NodeStats &s = stats[node];
+  vtime_t time = getWallClock();
+  vtime_t cpu = getCpuTime();
+
+  bool result = filter[node]->process(chunk);
+
+  countTime(getCpuTime() - cpu, s.process_cpu, s.process_cpu_max);
+  countTime(getWallClock() - time, s.process_time, s.process_time_max);
+
+  ++s.process_calls;
+  countData(chunk, s.chunks_in, s.bytes_in, s.samples_in);
+  return result;
+}
+
+bool
+FilterGraph::nodeGetChunk(int node, Chunk *chunk)
+{
+  if ( ! profiling )
+    return filter[node]->getChunk(chunk);
+
+  NodeStats &s = stats[node];
+  vtime_t time = getWallClock();
+  vtime_t cpu = getCpuTime();
+
+  bool result = filter[node]->getChunk(chunk);
+
+  countTime(getCpuTime() - cpu, s.getchunk_cpu, s.getchunk_cpu_max);
+  countTime(getWallClock() - time, s.getchunk_time, s.getchunk_time_max);
+
+  ++s.getchunk_calls;
+
+  if ( result )
+    countData(chunk, s.chunks_out, s.bytes_out, s.samples_out);
+
+  return result;
+}
+
+void
+FilterGraph::setProfiling(bool _profiling)
+{
+  profiling = _profiling;
+}
+
+bool
+FilterGraph::getProfiling(void) const
+{
+  return profiling;
+}
+
+void
+FilterGraph::resetStats(void)
+{
+  for ( int i = 0; i < graph_size; ++i )
+    stats[i].reset();
+}
+
+size_t
+FilterGraph::getStats(NodeStats *_stats, size_t max_nodes) const
+{
+  size_t n = 0;
+  int node = next[node_start];
+
+  while ( node != node_end && n < max_nodes )
+  {
+    _stats[n] = stats[node];
+    _stats[n].node = node;
+    _stats[n].name = nodeName(node);
+    ++n;
+
+    node = next[node];
+  }
+
+  return n;
+}
+
+/////////////////////////////////////////////////////////
+// Quote a node name for statsText(): JSON string escapes
+// ('"', '\' and control characters) or doubled quotes in
+// CSV. Too long names are truncated.
+
+static void quoteName(char *out, size_t out_size, const char *name, bool csv)
+{
+  size_t n = 0;
+
+  for ( ; *name; ++name )
+  {
+    const unsigned char c = *name;
+    char esc[8] = { char(c), 0 };
+
+    if ( csv )
+    {
+      if ( c == '"' )
+        strcpy(esc, "\"\"");
+    }
+    else if ( c == '"' || c == '\\' )
+    {
+      esc[0] = '\\';
+      esc[1] = char(c);
+      esc[2] = 0;
+    }
+    else if ( c < 0x20 )
+      snprintf(esc, sizeof(esc), "\\u%04x", c);
+
+    const size_t len = strlen(esc);
+
+    if ( n + len >= out_size )
+      break;
+
+    memcpy(out + n, esc, len);
+    n += len;
+  }
+
+  out[n] = 0;
+}
+
+/////////////////////////////////////////////////////////
+// Print statistics
+//
+// JSON: {"nodes": [{"node": 0, "name": "...", ...}, ...]}
+// CSV:  header line and a line per node
+//
+// Names are quoted and escaped. Times are printed in
+// seconds.
+
+size_t
+FilterGraph::statsText(char *buf, size_t buf_size, int format) const
+{
+  size_t i;
+  char *buf_ptr = buf;
+  int node = next[node_start];
+
+  if ( format == stats_csv )
+    i = snprintf(buf_ptr, buf_size,
+      "node,name,process_calls,getchunk_calls,chunks_in,chunks_out,"
+      "bytes_in,bytes_out,samples_in,samples_out,"
+      "process_time,process_time_max,process_cpu,process_cpu_max,"
+      "getchunk_time,getchunk_time_max,getchunk_cpu,getchunk_cpu_max,"
+      "rebuilds,flushes\n");
+  else
+    i = snprintf(buf_ptr, buf_size, "{\"nodes\": [");
+
+  buf_ptr += i;
+  buf_size = (buf_size > i)? buf_size - i: 0;
+
+  while ( node != node_end )
+  {
+    const NodeStats &s = stats[node];
+    const char *name = nodeName(node);
+
+    if ( ! name )
+      name = "";
+
+    char quoted[256];
+    quoteName(quoted, sizeof(quoted), name, format == stats_csv);
+
+    if ( format == stats_csv )
+      i = snprintf(buf_ptr, buf_size,
+        "%i,\"%s\",%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,"
+        "%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%i,%i\n",
+        node, quoted,
+        (unsigned long long)s.process_calls, (unsigned long long)s.getchunk_calls,
+        (unsigned long long)s.chunks_in, (unsigned long long)s.chunks_out,
+        (unsigned long long)s.bytes_in, (unsigned long long)s.bytes_out,
+        (unsigned long long)s.samples_in, (unsigned long long)s.samples_out,
+        s.process_time, s.process_time_max, s.process_cpu, s.process_cpu_max,
+        s.getchunk_time, s.getchunk_time_max, s.getchunk_cpu, s.getchunk_cpu_max,
+        s.rebuilds, s.flushes);
+    else
+      i = snprintf(buf_ptr, buf_size,
+        "%s{\"node\": %i, \"name\": \"%s\", "
+        "\"process_calls\": %llu, \"getchunk_calls\": %llu, "
+        "\"chunks_in\": %llu, \"chunks_out\": %llu, "
+        "\"bytes_in\": %llu, \"bytes_out\": %llu, "
+        "\"samples_in\": %llu, \"samples_out\": %llu, "
+        "\"process_time\": %.6f, \"process_time_max\": %.6f, "
+        "\"process_cpu\": %.6f, \"process_cpu_max\": %.6f, "
+        "\"getchunk_time\": %.6f, \"getchunk_time_max\": %.6f, "
+        "\"getchunk_cpu\": %.6f, \"getchunk_cpu_max\": %.6f, "
+        "\"rebuilds\": %i, \"flushes\": %i}",
+        node == next[node_start]? "": ", ", node, quoted,
+        (unsigned long long)s.process_calls, (unsigned long long)s.getchunk_calls,
+        (unsigned long long)s.chunks_in, (unsigned long long)s.chunks_out,
+        (unsigned long long)s.bytes_in, (unsigned long long)s.bytes_out,
+        (unsigned long long)s.samples_in, (unsigned long long)s.samples_out,
+        s.process_time, s.process_time_max, s.process_cpu, s.process_cpu_max,
+        s.getchunk_time, s.getchunk_time_max, s.getchunk_cpu, s.getchunk_cpu_max,
+        s.rebuilds, s.flushes);
+
+    buf_ptr += i;
+    buf_size = (buf_size > i)? buf_size - i: 0;
+
+    node = next[node];
+  }
+
+  if ( format != stats_csv )
+  {
+    i = snprintf(buf_ptr, buf_size, "]}");
+    buf_ptr += i;
+    buf_size = (buf_size > i)? buf_size - i: 0;
+  }
+
+  return buf_ptr - buf;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Filter interface
 ///////////////////////////////////////////////////////////////////////////////
@@ -500,6 +972,44 @@ FilterGraph::getChunk(Chunk *chunk)
   return true;
 }
 
+vtime_t
+FilterGraph::getLatency(void) const
+{
+  // Nodes bypassed by the data are skipped
+  vtime_t latency = 0;
+  int node = dataNext(node_start, filter[node_start]->getOutput());
+
+  while ( node != node_end )
+  {
+    latency += filter[node]->getLatency();
+    node = dataNext(node, filter[node]->getOutput());
+  }
+
+  return latency;
+}
+
+bool
+FilterGraph::setLowLatency(bool _low_latency)
+{
+  low_latency = _low_latency;
+
+  int node = next[node_start];
+
+  while ( node != node_end )
+  {
+    filter[node]->setLowLatency(low_latency);
+    node = next[node];
+  }
+
+  return true;
+}
+
+bool
+FilterGraph::getLowLatency(void) const
+{
+  return low_latency;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // FilterChain
 ///////////////////////////////////////////////////////////////////////////////
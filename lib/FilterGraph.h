@@ -35,6 +35,8 @@
 */
 
 #include <AudioFilter/Filter.h>
+#include <AudioFilter/VTime.h>
+#include "filters/Rechunker.h"
 
 /* statics here is wrong,
  * change it when you get a chance
@@ -46,6 +48,63 @@ static const int node_err(-1);
 
 namespace AudioFilter {
 
+///////////////////////////////////////////////////////////////////////////////
+// NodeStats - per-node statistics collected by FilterGraph
+//
+// Calls, chunks and data counters are for the node filter's process() and
+// getChunk() calls made by the graph (dummy output chunks are not counted).
+// Data is counted in bytes for raw data and in samples (per channel) for
+// linear format. Time is in seconds: wall clock and CPU time of the calling
+// thread. rebuilds is the number of times the node filter was (re)inserted
+// into the chain, flushes is the number of eos-chunks the node received
+// (stream end or flushing before the chain rebuild).
+
+struct NodeStats
+{
+  int         node;
+  const char *name;
+
+  uint64_t process_calls;
+  uint64_t getchunk_calls;
+  uint64_t chunks_in;
+  uint64_t chunks_out;
+  uint64_t bytes_in;
+  uint64_t bytes_out;
+  uint64_t samples_in;
+  uint64_t samples_out;
+
+  vtime_t process_time;
+  vtime_t process_time_max;
+  vtime_t process_cpu;
+  vtime_t process_cpu_max;
+  vtime_t getchunk_time;
+  vtime_t getchunk_time_max;
+  vtime_t getchunk_cpu;
+  vtime_t getchunk_cpu_max;
+
+  int rebuilds;
+  int flushes;
+
+  NodeStats(): node(0), name(0)
+  {
+    reset();
+  }
+
+  void reset(void)
+  {
+    process_calls = getchunk_calls = 0;
+    chunks_in = chunks_out = 0;
+    bytes_in = bytes_out = 0;
+    samples_in = samples_out = 0;
+    process_time = process_time_max = 0;
+    process_cpu = process_cpu_max = 0;
+    getchunk_time = getchunk_time_max = 0;
+    getchunk_cpu = getchunk_cpu_max = 0;
+    rebuilds = 0;
+    flushes = 0;
+  }
+};
+
 class FilterGraph : public Filter
 {
 public:
@@ -62,6 +121,90 @@ public:
 
   size_t chainText(char *buf, size_t buf_size) const;
 
+  /////////////////////////////////////////////////////////
+  // Profiling
+  //
+  // Time and data counters are collected only when
+  // profiling is enabled (disabled by default). Rebuild and
+  // flush counters are always collected.
+  //
+  // size_t get_stats(NodeStats *stats, size_t max_nodes)
+  //   fills statistics for the nodes of the current chain
+  //   in chain order, returns number of nodes filled
+  //
+  // size_t stats_text(char *buf, size_t buf_size, int format)
+  //   prints statistics of the current chain as JSON object
+  //   or CSV table (node names are quoted and escaped),
+  //   returns number of printed bytes
+
+  enum { stats_json, stats_csv };
+
+  void setProfiling(bool _profiling);
+  bool getProfiling(void) const;
+  void resetStats(void);
+
+  size_t getStats(NodeStats *stats, size_t max_nodes) const;
+  size_t statsText(char *buf, size_t buf_size, int format = stats_json) const;
+
+  /////////////////////////////////////////////////////////
+  // Stage fusion
+  //
+  // Each filter makes its own pass over the data, so a
+  // chain of gain -> ... -> gain -> convert to PCM reads
+  // and writes all samples for each stage. With fusion
+  // enabled (disabled by default) the graph finds runs of
+  // adjacent pure gain filters (Filter::fuseGain()) followed
+  // by a filter that can apply the gains itself
+  // (Filter::setInputGains(), i.e. Converter) and makes the
+  // last one apply the gains block by block right before
+  // its own processing. Gain filters just pass data through
+  // in this case. Result is bit-exact with the unfused chain.
+  //
+  // Fusion is updated each time the chain is rebuilt.
+  // setFusion() should be called when the graph is empty.
+  // Filters stay fused until the chain is dropped (reset(),
+  // setInput(), FilterChain::drop()) or fusion is disabled,
+  // so the filters must not be used outside of the graph
+  // meanwhile.
+
+  void setFusion(bool _fusion);
+  bool getFusion(void) const;
+
+  /////////////////////////////////////////////////////////
+  // Identity bypass
+  //
+  // Filters that do nothing in the current configuration
+  // (Filter::isIdentity(), i.e. Convolver with identity
+  // FIR) are spliced out of the data path: the data goes
+  // directly to the next filter. A filter is bypassed only
+  // when it is empty and has no pending flushing or chain
+  // changes, and it is checked for each chunk, so it comes
+  // back into the data path as soon as its configuration
+  // changes (no chain rebuild required). Format changes go
+  // through the bypassed filters as usual.
+  //
+  // Enabled by default.
+
+  void setBypass(bool _bypass);
+  bool getBypass(void) const;
+
+  /////////////////////////////////////////////////////////
+  // Block size negotiation
+  //
+  // When a filter asks for a block size
+  // (Filter::getBlockSize()) the graph inserts a Rechunker
+  // node in front of it (the node has "Rechunker" name and
+  // is shown in chain text and statistics). Rechunker is
+  // always inserted for a required block size, and for a
+  // preferred block size only when rechunking is enabled
+  // (disabled by default, because it adds latency) and the
+  // latency added is within the filter's max latency.
+  //
+  // Rechunking mode takes effect at the next chain rebuild.
+
+  void setRechunking(bool _rechunking);
+  bool getRechunking(void) const;
+
   /////////////////////////////////////////////////////////
   // Filter interface
 
@@ -77,6 +220,15 @@ public:
   virtual bool isEmpty(void) const;
   virtual bool getChunk(Chunk *chunk);
 
+  // Latency of the chain is the sum of latencies of the
+  // nodes in the data path (bypassed nodes are skipped).
+  // Low latency mode is set for all nodes that support it
+  // (including nodes created later) and disables optional
+  // rechunking.
+  virtual vtime_t getLatency(void) const;
+  virtual bool setLowLatency(bool _low_latency);
+  virtual bool getLowLatency(void) const;
+
 protected:
   /////////////////////////////////////////////////////////
   // public chain operations
@@ -183,13 +335,63 @@ private:
   //   process_internal() and rebuild() functions can
   //     change node_state[]
 
+  // Rechunker nodes follow the start and end nodes:
+  // adapter[i] is at node adapter_base + i in front of
+  // the node i.
+
+  enum { adapter_base = graph_nodes + 2, graph_size = graph_nodes * 2 + 2 };
+
   NullFilter start;
   NullFilter end;
+  Rechunker adapter[graph_nodes];
+
+  int next[graph_size];
+  int prev[graph_size];
+  Filter *filter[graph_size];
+  enum { ns_ok, ns_dirty, ns_flush, ns_rebuild } node_state[graph_size];
+
+  /////////////////////////////////////////////////////////
+  // Node statistics
+
+  bool profiling;
+  NodeStats stats[graph_size];
+
+  bool nodeProcess(int node, const Chunk *chunk);
+  bool nodeGetChunk(int node, Chunk *chunk);
+
+  /////////////////////////////////////////////////////////
+  // Stage fusion
+  //
+  // fused[] - filters changed by fuseChain()
+
+  bool fusion;
+  int nfused;
+  Filter *fused[graph_nodes];
+
+  void fuseChain(void);
+  void unfuseChain(void);
+
+  /////////////////////////////////////////////////////////
+  // Identity bypass
+
+  bool bypass;
+
+  int dataNext(int node, Speakers spk) const;
+
+  /////////////////////////////////////////////////////////
+  // Block size negotiation
+
+  bool rechunking;
+  bool low_latency;
+
+  inline bool isAdapter(int node) const
+  {
+    return node >= adapter_base;
+  }
 
-  int next[graph_nodes + 2];
-  int prev[graph_nodes + 2];
-  Filter *filter[graph_nodes + 2];
-  enum { ns_ok, ns_dirty, ns_flush, ns_rebuild } node_state[graph_nodes + 2];
+  int nextNode(int node, Speakers spk) const;
+  const char *nodeName(int node) const;
+  bool needAdapter(int node, Speakers spk) const;
 
   /////////////////////////////////////////////////////////
   // Chain operations
@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <cstring>
+#include <AudioFilter/FileParser.h>
+#include <AudioFilter/FrameIndex.h>
+
+namespace {
+
+const char     sidecar_ext[]  = ".idx";
+const uint32_t sidecar_magic  = 0x58444946; // 'FIDX'
+const uint32_t sidecar_version = 2;
+
+// Sidecar file layout: the header, frame positions (int64_t each) and
+// segments. Fields are fixed-size and naturally aligned, so structures have
+// no implicit padding and the layout does not depend on the compiler. Byte
+// order and the double format are the host's ones.
+
+struct SidecarHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  int64_t  file_size;
+  uint64_t frames;
+  uint64_t segments;
+};
+
+struct SidecarSegment
+{
+  uint64_t first_frame;
+  double   time;
+  uint32_t sample_rate;
+  uint32_t sample_count;
+  uint32_t new_stream;
+  uint32_t reserved;
+};
+
+// compile-time layout checks (array of negative size fails)
+typedef char sidecar_header_size_check[sizeof(SidecarHeader) == 32? 1: -1];
+typedef char sidecar_segment_size_check[sizeof(SidecarSegment) == 32? 1: -1];
+typedef char sidecar_pos_size_check[sizeof(AudioFilter::AutoFile::fsize_t) == sizeof(int64_t)? 1: -1];
+
+}; // anonymous namespace
+
+namespace AudioFilter {
+
+///////////////////////////////////////////////////////////////////////////////
+// Build
+
+bool FrameIndex::build(const char *filename, HeaderParser *parser, const volatile bool *cancel)
+{
+  clear();
+
+  FileParser file(filename, parser);
+
+  if ( ! file.isOpen() )
+    return false;
+
+  file.map();
+  setFileSize(file.getSize());
+
+  while ( file.loadFrame() )
+  {
+    if ( cancel && *cancel )
+    {
+      clear();
+      return false;
+    }
+
+    addFrame(file.getFramePos(), file.getHeaderInfo(), file.isNewStream());
+  }
+
+  return true;
+}
+
+void FrameIndex::clear(void)
+{
+  file_size = 0;
+  pos.clear();
+  segment.clear();
+}
+
+void FrameIndex::addFrame(fsize_t frame_pos, const HeaderInfo &hinfo, bool new_stream)
+{
+  const unsigned sample_rate(hinfo.getSpeakers().getSampleRate());
+  const size_t sample_count(hinfo.getSampleCount());
+
+  if ( segment.empty() || new_stream
+      || segment.back().sample_rate != sample_rate
+      || segment.back().sample_count != sample_count )
+  {
+    Segment s;
+    s.first_frame = pos.size();
+    s.time = 0;
+    s.sample_rate = sample_rate;
+    s.sample_count = sample_count;
+    s.new_stream = segment.empty() || new_stream;
+
+    if ( ! segment.empty() )
+    {
+      const Segment &last(segment.back());
+      s.time = last.time + (pos.size() - last.first_frame) * last.getFrameDuration();
+    }
+
+    segment.push_back(s);
+  }
+
+  pos.push_back(frame_pos);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Sidecar file
+
+std::string FrameIndex::sidecarName(const char *filename)
+{
+  return std::string(filename) + sidecar_ext;
+}
+
+bool FrameIndex::save(const char *filename) const
+{
+  AutoFile f(filename, "wb");
+
+  if ( ! f )
+    return false;
+
+  SidecarHeader h;
+  h.magic = sidecar_magic;
+  h.version = sidecar_version;
+  h.file_size = file_size;
+  h.frames = pos.size();
+  h.segments = segment.size();
+
+  if ( f.write(&h, sizeof(h)) != sizeof(h) )
+    return false;
+
+  if ( ! pos.empty() && f.write(&pos[0], pos.size() * sizeof(fsize_t)) != pos.size() * sizeof(fsize_t) )
+    return false;
+
+  for ( size_t i = 0; i < segment.size(); ++i )
+  {
+    SidecarSegment s;
+    s.first_frame = segment[i].first_frame;
+    s.time = segment[i].time;
+    s.sample_rate = segment[i].sample_rate;
+    s.sample_count = uint32_t(segment[i].sample_count);
+    s.new_stream = segment[i].new_stream;
+    s.reserved = 0;
+
+    if ( f.write(&s, sizeof(s)) != sizeof(s) )
+      return false;
+  }
+
+  return true;
+}
+
+bool FrameIndex::load(const char *filename, fsize_t _file_size)
+{
+  clear();
+
+  AutoFile f(filename);
+
+  if ( ! f )
+    return false;
+
+  SidecarHeader h;
+
+  if ( f.read(&h, sizeof(h)) != sizeof(h)
+      || h.magic != sidecar_magic
+      || h.version != sidecar_version
+      || h.file_size != _file_size
+      || (h.frames && ! h.segments) )
+    return false;
+
+  // Check the size before allocation, so a broken file
+  // does not make us allocate a huge table.
+
+  if ( fsize_t(sizeof(h) + h.frames * sizeof(fsize_t) + h.segments * sizeof(SidecarSegment)) != f.size() )
+    return false;
+
+  pos.resize(size_t(h.frames));
+
+  if ( ! pos.empty() && f.read(&pos[0], pos.size() * sizeof(fsize_t)) != pos.size() * sizeof(fsize_t) )
+  {
+    clear();
+    return false;
+  }
+
+  segment.resize(size_t(h.segments));
+
+  for ( size_t i = 0; i < segment.size(); ++i )
+  {
+    SidecarSegment s;
+
+    // segments must cover all frames: the first one
+    // starts at frame 0, the others follow in order
+
+    if ( f.read(&s, sizeof(s)) != sizeof(s)
+        || s.first_frame >= h.frames
+        || (i == 0 && s.first_frame != 0)
+        || (i && s.first_frame <= segment[i - 1].first_frame) )
+    {
+      clear();
+      return false;
+    }
+
+    segment[i].first_frame = size_t(s.first_frame);
+    segment[i].time = s.time;
+    segment[i].sample_rate = s.sample_rate;
+    segment[i].sample_count = s.sample_count;
+    segment[i].new_stream = i == 0 || s.new_stream;
+  }
+
+  file_size = _file_size;
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Lookup
+
+vtime_t FrameIndex::getDuration(void) const
+{
+  if ( segment.empty() )
+    return 0;
+
+  const Segment &last(segment.back());
+  return last.time + (pos.size() - last.first_frame) * last.getFrameDuration();
+}
+
+size_t FrameIndex::findSegment(size_t frame) const
+{
+  size_t lo(0);
+  size_t hi(segment.size());
+
+  // last segment with first_frame <= frame
+
+  while ( hi - lo > 1 )
+  {
+    const size_t mid((lo + hi) / 2);
+
+    if ( segment[mid].first_frame <= frame )
+      lo = mid;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+bool FrameIndex::getEntry(size_t frame, FrameIndexEntry &entry) const
+{
+  if ( frame >= pos.size() )
+    return false;
+
+  const size_t i(findSegment(frame));
+  const Segment &s(segment[i]);
+
+  entry.pos = pos[frame];
+  entry.frame = frame;
+  entry.time = s.time + (frame - s.first_frame) * s.getFrameDuration();
+  entry.format_change = frame == s.first_frame;
+  entry.new_stream = entry.format_change && s.new_stream;
+  return true;
+}
+
+size_t FrameIndex::findTime(vtime_t time) const
+{
+  if ( pos.empty() || time <= 0 )
+    return 0;
+
+  size_t lo(0);
+  size_t hi(segment.size());
+
+  // last segment starting at or before the time
+
+  while ( hi - lo > 1 )
+  {
+    const size_t mid((lo + hi) / 2);
+
+    if ( segment[mid].time <= time )
+      lo = mid;
+    else
+      hi = mid;
+  }
+
+  const Segment &s(segment[lo]);
+  const size_t end(lo + 1 < segment.size() ? segment[lo + 1].first_frame : pos.size());
+  const vtime_t duration(s.getFrameDuration());
+
+  size_t frame(s.first_frame);
+
+  if ( duration > 0 )
+    frame += size_t((time - s.time) / duration);
+
+  return std::min(frame, end - 1);
+}
+
+size_t FrameIndex::findPos(fsize_t file_pos) const
+{
+  std::vector<fsize_t>::const_iterator it(std::upper_bound(pos.begin(), pos.end(), file_pos));
+
+  if ( it == pos.begin() )
+    return 0;
+
+  return size_t(it - pos.begin()) - 1;
+}
+
+}; // namespace AudioFilter
+
+// vim: ts=2 sts=2 et
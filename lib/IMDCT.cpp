@@ -0,0 +1,603 @@
+#include <math.h>
+#include <string.h>
+#include <AudioFilter/IMDCT.h>
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define IMDCT_VECTOR
+#define IMDCT_INLINE inline __attribute__((always_inline))
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX __attribute__((target("avx")))
+#else
+#define IMDCT_INLINE inline
+#endif
+
+namespace AudioFilter {
+
+namespace {
+
+const sample_t imdct_window[256] =
+{
+  0.00014, 0.00024, 0.00037, 0.00051, 0.00067, 0.00086, 0.00107, 0.00130,
+  0.00157, 0.00187, 0.00220, 0.00256, 0.00297, 0.00341, 0.00390, 0.00443,
+  0.00501, 0.00564, 0.00632, 0.00706, 0.00785, 0.00871, 0.00962, 0.01061,
+  0.01166, 0.01279, 0.01399, 0.01526, 0.01662, 0.01806, 0.01959, 0.02121,
+  0.02292, 0.02472, 0.02662, 0.02863, 0.03073, 0.03294, 0.03527, 0.03770,
+  0.04025, 0.04292, 0.04571, 0.04862, 0.05165, 0.05481, 0.05810, 0.06153,
+  0.06508, 0.06878, 0.07261, 0.07658, 0.08069, 0.08495, 0.08935, 0.09389,
+  0.09859, 0.10343, 0.10842, 0.11356, 0.11885, 0.12429, 0.12988, 0.13563,
+  0.14152, 0.14757, 0.15376, 0.16011, 0.16661, 0.17325, 0.18005, 0.18699,
+  0.19407, 0.20130, 0.20867, 0.21618, 0.22382, 0.23161, 0.23952, 0.24757,
+  0.25574, 0.26404, 0.27246, 0.28100, 0.28965, 0.29841, 0.30729, 0.31626,
+  0.32533, 0.33450, 0.34376, 0.35311, 0.36253, 0.37204, 0.38161, 0.39126,
+  0.40096, 0.41072, 0.42054, 0.43040, 0.44030, 0.45023, 0.46020, 0.47019,
+  0.48020, 0.49022, 0.50025, 0.51028, 0.52031, 0.53033, 0.54033, 0.55031,
+  0.56026, 0.57019, 0.58007, 0.58991, 0.59970, 0.60944, 0.61912, 0.62873,
+  0.63827, 0.64774, 0.65713, 0.66643, 0.67564, 0.68476, 0.69377, 0.70269,
+  0.71150, 0.72019, 0.72877, 0.73723, 0.74557, 0.75378, 0.76186, 0.76981,
+  0.77762, 0.78530, 0.79283, 0.80022, 0.80747, 0.81457, 0.82151, 0.82831,
+  0.83496, 0.84145, 0.84779, 0.85398, 0.86001, 0.86588, 0.87160, 0.87716,
+  0.88257, 0.88782, 0.89291, 0.89785, 0.90264, 0.90728, 0.91176, 0.91610,
+  0.92028, 0.92432, 0.92822, 0.93197, 0.93558, 0.93906, 0.94240, 0.94560,
+  0.94867, 0.95162, 0.95444, 0.95713, 0.95971, 0.96217, 0.96451, 0.96674,
+  0.96887, 0.97089, 0.97281, 0.97463, 0.97635, 0.97799, 0.97953, 0.98099,
+  0.98236, 0.98366, 0.98488, 0.98602, 0.98710, 0.98811, 0.98905, 0.98994,
+  0.99076, 0.99153, 0.99225, 0.99291, 0.99353, 0.99411, 0.99464, 0.99513,
+  0.99558, 0.99600, 0.99639, 0.99674, 0.99706, 0.99736, 0.99763, 0.99788,
+  0.99811, 0.99831, 0.99850, 0.99867, 0.99882, 0.99895, 0.99908, 0.99919,
+  0.99929, 0.99938, 0.99946, 0.99953, 0.99959, 0.99965, 0.99969, 0.99974,
+  0.99978, 0.99981, 0.99984, 0.99986, 0.99988, 0.99990, 0.99992, 0.99993,
+  0.99994, 0.99995, 0.99996, 0.99997, 0.99998, 0.99998, 0.99998, 0.99999,
+  0.99999, 0.99999, 0.99999, 1.00000, 1.00000, 1.00000, 1.00000, 1.00000,
+  1.00000, 1.00000, 1.00000, 1.00000, 1.00000, 1.00000, 1.00000, 1.00000
+};
+
+const uint8_t fftorder[128] =
+{
+    0, 128,  64, 192,  32, 160, 224,  96,  16, 144,  80, 208, 240, 112,  48, 176,
+    8, 136,  72, 200,  40, 168, 232, 104, 248, 120,  56, 184,  24, 152, 216,  88,
+    4, 132,  68, 196,  36, 164, 228, 100,  20, 148,  84, 212, 244, 116,  52, 180,
+  252, 124,  60, 188,  28, 156, 220,  92,  12, 140,  76, 204, 236, 108,  44, 172,
+    2, 130,  66, 194,  34, 162, 226,  98,  18, 146,  82, 210, 242, 114,  50, 178,
+   10, 138,  74, 202,  42, 170, 234, 106, 250, 122,  58, 186,  26, 154, 218,  90,
+  254, 126,  62, 190,  30, 158, 222,  94,  14, 142,  78, 206, 238, 110,  46, 174,
+    6, 134,  70, 198,  38, 166, 230, 102, 246, 118,  54, 182,  22, 150, 214,  86
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Shared tables
+//
+// pass_re/im     - IFFT pass twiddles: w[n + j] = exp(i*pi*j/(2*n)) for
+//                  the pass of size n = 2..32
+// pre1, pre2     - pre-IFFT twiddles (in IFFT input order)
+// post1, post2   - post-IFFT twiddles: output m is (p*re + q*im, q*re - p*im)
+//                  (the second half of the output is read backwards, so its
+//                  coefs are swapped)
+
+struct IMDCTTables
+{
+  sample_t pass_re[64];
+  sample_t pass_im[64];
+
+  sample_t pre1_re[128];
+  sample_t pre1_im[128];
+  sample_t post1_p[128];
+  sample_t post1_q[128];
+
+  sample_t pre2_re[64];
+  sample_t pre2_im[64];
+  sample_t post2_p[64];
+  sample_t post2_q[64];
+
+  IMDCTTables();
+};
+
+IMDCTTables::IMDCTTables()
+{
+  int i, k, n;
+
+  pass_re[0] = pass_re[1] = 0;
+  pass_im[0] = pass_im[1] = 0;
+
+  for ( n = 2; n < 64; n *= 2 )
+    for ( i = 0; i < n; i++ )
+    {
+      pass_re[n + i] = cos((M_PI / 2) * i / n);
+      pass_im[n + i] = sin((M_PI / 2) * i / n);
+    }
+
+  for ( i = 0; i < 128; i++ )
+  {
+    const double sign = i < 64 ? 1 : -1;
+    k = fftorder[i] / 2 + 64;
+    pre1_re[i] = sign * cos((M_PI / 256) * (k - 0.25));
+    pre1_im[i] = sign * sin((M_PI / 256) * (k - 0.25));
+  }
+
+  // Post-IFFT coefs are pre-scaled by 2
+  // (moved here from overlap/add step)
+  for ( i = 0; i < 64; i++ )
+  {
+    post1_p[i] = post1_q[127 - i] = 2 * cos((M_PI / 256) * (i + 0.5));
+    post1_q[i] = post1_p[127 - i] = 2 * sin((M_PI / 256) * (i + 0.5));
+  }
+
+  for ( i = 0; i < 64; i++ )
+  {
+    k = fftorder[i] / 4;
+    pre2_re[i] = cos((M_PI / 128) * (k - 0.25));
+    pre2_im[i] = sin((M_PI / 128) * (k - 0.25));
+  }
+
+  for ( i = 0; i < 32; i++ )
+  {
+    post2_p[i] = post2_q[63 - i] = 2 * cos((M_PI / 128) * (i + 0.5));
+    post2_q[i] = post2_p[63 - i] = 2 * sin((M_PI / 128) * (i + 0.5));
+  }
+}
+
+const IMDCTTables &tables(void)
+{
+  static const IMDCTTables t;
+  return t;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Transform
+//
+// Templates take a vector type (sample_t for the scalar implementation) and
+// are instantiated for each implementation. Loops process a vector of
+// samples at a time, the tail shorter than a vector is done by scalars.
+
+template <class V>
+IMDCT_INLINE void load(V &v, const sample_t *p)
+{
+  memcpy(&v, p, sizeof(V));
+}
+
+template <class V>
+IMDCT_INLINE void store(sample_t *p, const V &v)
+{
+  memcpy(p, &v, sizeof(V));
+}
+
+// (re, im) * (c - i*s)
+template <class V>
+IMDCT_INLINE void preTwiddle(sample_t *re, sample_t *im, const sample_t *c, const sample_t *s)
+{
+  V r, i, tc, ts;
+  load(r, re); load(i, im);
+  load(tc, c); load(ts, s);
+  store(re, V(tc * r + ts * i));
+  store(im, V(tc * i - ts * r));
+}
+
+template <class V>
+IMDCT_INLINE void postTwiddle(sample_t *re, sample_t *im, const sample_t *p, const sample_t *q)
+{
+  V r, i, tp, tq;
+  load(r, re); load(i, im);
+  load(tp, p); load(tq, q);
+  store(re, V(tp * r + tq * i));
+  store(im, V(tq * r - tp * i));
+}
+
+// the basic split-radix ifft butterfly
+template <class V>
+IMDCT_INLINE void butterfly(sample_t *re, sample_t *im, const sample_t *wr, const sample_t *wi, int n)
+{
+  V a0r, a0i, a1r, a1i, a2r, a2i, a3r, a3i, w_r, w_i;
+  load(a0r, re);         load(a0i, im);
+  load(a1r, re + n);     load(a1i, im + n);
+  load(a2r, re + 2 * n); load(a2i, im + 2 * n);
+  load(a3r, re + 3 * n); load(a3i, im + 3 * n);
+  load(w_r, wr);         load(w_i, wi);
+
+  const V tmp5 = a2r * w_r + a2i * w_i;
+  const V tmp6 = a2i * w_r - a2r * w_i;
+  const V tmp7 = a3r * w_r - a3i * w_i;
+  const V tmp8 = a3i * w_r + a3r * w_i;
+  const V tmp1 = tmp5 + tmp7;
+  const V tmp2 = tmp6 + tmp8;
+  const V tmp3 = tmp6 - tmp8;
+  const V tmp4 = tmp7 - tmp5;
+
+  store(re + 2 * n, V(a0r - tmp1));
+  store(im + 2 * n, V(a0i - tmp2));
+  store(re + 3 * n, V(a1r - tmp3));
+  store(im + 3 * n, V(a1i - tmp4));
+  store(re,         V(a0r + tmp1));
+  store(im,         V(a0i + tmp2));
+  store(re + n,     V(a1r + tmp3));
+  store(im + n,     V(a1i + tmp4));
+}
+
+// split-radix ifft butterfly, specialized for wr=1 wi=0
+IMDCT_INLINE void butterfly_zero(sample_t *re, sample_t *im, int n)
+{
+  sample_t tmp1, tmp2, tmp3, tmp4;
+
+  tmp1 = re[2 * n] + re[3 * n];
+  tmp2 = im[2 * n] + im[3 * n];
+  tmp3 = im[2 * n] - im[3 * n];
+  tmp4 = re[3 * n] - re[2 * n];
+  re[2 * n] = re[0] - tmp1;
+  im[2 * n] = im[0] - tmp2;
+  re[3 * n] = re[n] - tmp3;
+  im[3 * n] = im[n] - tmp4;
+  re[0] += tmp1;
+  im[0] += tmp2;
+  re[n] += tmp3;
+  im[n] += tmp4;
+}
+
+template <class V>
+IMDCT_INLINE void ifft_pass(const IMDCTTables &t, sample_t *re, sample_t *im, int n)
+{
+  const int w = sizeof(V) / sizeof(sample_t);
+  int i = 0;
+
+  for ( ; i + w <= n; i += w )
+    butterfly<V>(re + i, im + i, t.pass_re + n + i, t.pass_im + n + i, n);
+
+  if ( i == 0 )
+  {
+    butterfly_zero(re, im, n);
+    i = 1;
+  }
+
+  for ( ; i < n; i++ )
+    butterfly<sample_t>(re + i, im + i, t.pass_re + n + i, t.pass_im + n + i, n);
+}
+
+IMDCT_INLINE void ifft2(sample_t *re, sample_t *im)
+{
+  sample_t r, i;
+
+  r = re[0];
+  i = im[0];
+  re[0] += re[1];
+  im[0] += im[1];
+  re[1] = r - re[1];
+  im[1] = i - im[1];
+}
+
+IMDCT_INLINE void ifft4(sample_t *re, sample_t *im)
+{
+  sample_t tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8;
+
+  tmp1 = re[0] + re[1];
+  tmp2 = re[3] + re[2];
+  tmp3 = im[0] + im[1];
+  tmp4 = im[2] + im[3];
+  tmp5 = re[0] - re[1];
+  tmp6 = im[0] - im[1];
+  tmp7 = im[2] - im[3];
+  tmp8 = re[3] - re[2];
+
+  re[0] = tmp1 + tmp2;
+  im[0] = tmp3 + tmp4;
+  re[2] = tmp1 - tmp2;
+  im[2] = tmp3 - tmp4;
+  re[1] = tmp5 + tmp7;
+  im[1] = tmp6 + tmp8;
+  re[3] = tmp5 - tmp7;
+  im[3] = tmp6 - tmp8;
+}
+
+template <class V>
+IMDCT_INLINE void ifft8(const IMDCTTables &t, sample_t *re, sample_t *im)
+{
+  ifft4(re, im);
+  ifft2(re + 4, im + 4);
+  ifft2(re + 6, im + 6);
+  ifft_pass<V>(t, re, im, 2);
+}
+
+template <class V>
+IMDCT_INLINE void ifft16(const IMDCTTables &t, sample_t *re, sample_t *im)
+{
+  ifft8<V>(t, re, im);
+  ifft4(re + 8, im + 8);
+  ifft4(re + 12, im + 12);
+  ifft_pass<V>(t, re, im, 4);
+}
+
+template <class V>
+IMDCT_INLINE void ifft32(const IMDCTTables &t, sample_t *re, sample_t *im)
+{
+  ifft16<V>(t, re, im);
+  ifft8<V>(t, re + 16, im + 16);
+  ifft8<V>(t, re + 24, im + 24);
+  ifft_pass<V>(t, re, im, 8);
+}
+
+template <class V>
+IMDCT_INLINE void ifft64(const IMDCTTables &t, sample_t *re, sample_t *im)
+{
+  ifft32<V>(t, re, im);
+  ifft16<V>(t, re + 32, im + 32);
+  ifft16<V>(t, re + 48, im + 48);
+  ifft_pass<V>(t, re, im, 16);
+}
+
+template <class V>
+IMDCT_INLINE void ifft128(const IMDCTTables &t, sample_t *re, sample_t *im)
+{
+  ifft64<V>(t, re, im);
+  ifft32<V>(t, re + 64, im + 64);
+  ifft32<V>(t, re + 96, im + 96);
+  ifft_pass<V>(t, re, im, 32);
+}
+
+template <class V>
+IMDCT_INLINE void twiddle(sample_t *re, sample_t *im, const sample_t *c, const sample_t *s, int n, bool pre)
+{
+  const int w = sizeof(V) / sizeof(sample_t);
+
+  for ( int i = 0; i < n; i += w )
+    if ( pre )
+      preTwiddle<V>(re + i, im + i, c + i, s + i);
+    else
+      postTwiddle<V>(re + i, im + i, c + i, s + i);
+}
+
+template <class V>
+IMDCT_INLINE void imdct512(const IMDCTTables &t, sample_t *data, sample_t *delay, sample_t *re, sample_t *im)
+{
+  int i, k;
+  sample_t a_r, a_i, b_r, b_i, w_1, w_2;
+  const sample_t *window = imdct_window;
+
+  // Pre IFFT complex multiply plus IFFT complex conjugate
+  for ( i = 0; i < 128; i++ )
+  {
+    k = fftorder[i];
+    re[i] = data[k];
+    im[i] = data[255-k];
+  }
+
+  twiddle<V>(re, im, t.pre1_re, t.pre1_im, 128, true);
+  ifft128<V>(t, re, im);
+  twiddle<V>(re, im, t.post1_p, t.post1_q, 128, false);
+
+  // Window and convert to real valued signal
+  for ( i = 0; i < 64; i++ )
+  {
+    a_r = re[i];
+    a_i = im[i];
+    b_r = re[127-i];
+    b_i = im[127-i];
+
+    w_1 = window[2*i];
+    w_2 = window[255-2*i];
+    data[2*i]     = delay[2*i] * w_2 - a_r * w_1;
+    data[255-2*i] = delay[2*i] * w_1 + a_r * w_2;
+    delay[2*i] = a_i;
+
+    w_1 = window[2*i+1];
+    w_2 = window[254-2*i];
+    data[2*i+1]   = delay[2*i+1] * w_2 + b_r * w_1;
+    data[254-2*i] = delay[2*i+1] * w_1 - b_r * w_2;
+    delay[2*i+1] = b_i;
+  }
+}
+
+template <class V>
+IMDCT_INLINE void imdct256(const IMDCTTables &t, sample_t *data, sample_t *delay, sample_t *re, sample_t *im)
+{
+  int i, k;
+  sample_t a_r, a_i, b_r, b_i, c_r, c_i, d_r, d_i, w_1, w_2;
+  const sample_t *window = imdct_window;
+
+  // Pre IFFT complex multiply plus IFFT complex conjugate
+  // (first transform in [0, 64), second in [64, 128))
+  for ( i = 0; i < 64; i++ )
+  {
+    k = fftorder[i];
+    re[i] = data[k];
+    im[i] = data[254-k];
+    re[64+i] = data[k+1];
+    im[64+i] = data[255-k];
+  }
+
+  twiddle<V>(re, im, t.pre2_re, t.pre2_im, 64, true);
+  twiddle<V>(re + 64, im + 64, t.pre2_re, t.pre2_im, 64, true);
+  ifft64<V>(t, re, im);
+  ifft64<V>(t, re + 64, im + 64);
+  twiddle<V>(re, im, t.post2_p, t.post2_q, 64, false);
+  twiddle<V>(re + 64, im + 64, t.post2_p, t.post2_q, 64, false);
+
+  // Window and convert to real valued signal
+  for ( i = 0; i < 32; i++ )
+  {
+    a_r = re[i];
+    a_i = im[i];
+    b_r = re[63-i];
+    b_i = im[63-i];
+    c_r = re[64+i];
+    c_i = im[64+i];
+    d_r = re[127-i];
+    d_i = im[127-i];
+
+    w_1 = window[2*i];
+    w_2 = window[255-2*i];
+    data[2*i]     = delay[2*i] * w_2 - a_r * w_1;
+    data[255-2*i] = delay[2*i] * w_1 + a_r * w_2;
+    delay[2*i] = c_i;
+
+    w_1 = window[128+2*i];
+    w_2 = window[127-2*i];
+    data[128+2*i] = delay[127-2*i] * w_2 + a_i * w_1;
+    data[127-2*i] = delay[127-2*i] * w_1 - a_i * w_2;
+    delay[127-2*i] = c_r;
+
+    w_1 = window[2*i+1];
+    w_2 = window[254-2*i];
+    data[2*i+1]   = delay[2*i+1] * w_2 - b_i * w_1;
+    data[254-2*i] = delay[2*i+1] * w_1 + b_i * w_2;
+    delay[2*i+1] = d_r;
+
+    w_1 = window[129+2*i];
+    w_2 = window[126-2*i];
+    data[129+2*i] = delay[126-2*i] * w_2 + b_r * w_1;
+    data[126-2*i] = delay[126-2*i] * w_1 - b_r * w_2;
+    delay[126-2*i] = d_i;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Implementations
+
+void imdct512Scalar(sample_t *data, sample_t *delay, sample_t *re, sample_t *im)
+{
+  imdct512<sample_t>(tables(), data, delay, re, im);
+}
+
+void imdct256Scalar(sample_t *data, sample_t *delay, sample_t *re, sample_t *im)
+{
+  imdct256<sample_t>(tables(), data, delay, re, im);
+}
+
+#ifdef IMDCT_VECTOR
+
+typedef sample_t vec128_t __attribute__((vector_size(16)));
+typedef sample_t vec256_t __attribute__((vector_size(32)));
+
+TARGET_SSE2
+void imdct512Sse2(sample_t *data, sample_t *delay, sample_t *re, sample_t *im)
+{
+  imdct512<vec128_t>(tables(), data, delay, re, im);
+}
+
+TARGET_SSE2
+void imdct256Sse2(sample_t *data, sample_t *delay, sample_t *re, sample_t *im)
+{
+  imdct256<vec128_t>(tables(), data, delay, re, im);
+}
+
+TARGET_AVX
+void imdct512Avx(sample_t *data, sample_t *delay, sample_t *re, sample_t *im)
+{
+  imdct512<vec256_t>(tables(), data, delay, re, im);
+}
+
+TARGET_AVX
+void imdct256Avx(sample_t *data, sample_t *delay, sample_t *re, sample_t *im)
+{
+  imdct256<vec256_t>(tables(), data, delay, re, im);
+}
+
+int detectImpl(void)
+{
+  __builtin_cpu_init();
+
+  if ( __builtin_cpu_supports("avx") )
+    return IMDCT::impl_avx;
+
+  if ( __builtin_cpu_supports("sse2") )
+    return IMDCT::impl_sse2;
+
+  return IMDCT::impl_scalar;
+}
+
+#else
+
+int detectImpl(void)
+{
+  return IMDCT::impl_scalar;
+}
+
+#endif
+
+int bestImpl(void)
+{
+  static const int best = detectImpl();
+  return best;
+}
+
+}; // anonymous namespace
+
+///////////////////////////////////////////////////////////////////////////////
+// IMDCT
+///////////////////////////////////////////////////////////////////////////////
+
+IMDCT::IMDCT()
+  : impl(impl_auto)
+{
+  // build the shared tables now rather than on the first block
+  tables();
+}
+
+bool IMDCT::isImplSupported(int _impl)
+{
+  switch ( _impl )
+  {
+    case impl_auto:
+    case impl_scalar:
+      return true;
+
+    case impl_sse2:
+    case impl_avx:
+      return bestImpl() >= _impl;
+  }
+
+  return false;
+}
+
+bool IMDCT::setImpl(int _impl)
+{
+  if ( ! isImplSupported(_impl) )
+    return false;
+
+  impl = _impl;
+  return true;
+}
+
+int IMDCT::getImpl(void) const
+{
+  return impl == impl_auto ? bestImpl() : impl;
+}
+
+void IMDCT::imdct_512(sample_t *data, sample_t *delay)
+{
+  switch ( getImpl() )
+  {
+#ifdef IMDCT_VECTOR
+    case impl_avx:
+      imdct512Avx(data, delay, buf_re, buf_im);
+      return;
+
+    case impl_sse2:
+      imdct512Sse2(data, delay, buf_re, buf_im);
+      return;
+#endif
+
+    default:
+      imdct512Scalar(data, delay, buf_re, buf_im);
+      return;
+  }
+}
+
+void IMDCT::imdct_256(sample_t *data, sample_t *delay)
+{
+  switch ( getImpl() )
+  {
+#ifdef IMDCT_VECTOR
+    case impl_avx:
+      imdct256Avx(data, delay, buf_re, buf_im);
+      return;
+
+    case impl_sse2:
+      imdct256Sse2(data, delay, buf_re, buf_im);
+      return;
+#endif
+
+    default:
+      imdct256Scalar(data, delay, buf_re, buf_im);
+      return;
+  }
+}
+
+}; // namespace AudioFilter
+
+// vim: ts=2 sts=2 et
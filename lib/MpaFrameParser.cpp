@@ -25,7 +25,7 @@ MpaFrameParser::~MpaFrameParser()
 ///////////////////////////////////////////////////////////////////////////////
 // FrameParser overrides
 
-const HeaderParser *MpaFrameParser::getHeaderParser(void) const
+HeaderParser *MpaFrameParser::getHeaderParser(void)
 {
   return &_mpaHeaderParser;
 }
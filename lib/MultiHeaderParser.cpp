@@ -5,10 +5,14 @@ namespace AudioFilter {
 MultiHeaderParser::MultiHeaderParser()
   : parserVec()
   , currentParser(0)
+  , currentIndex(-1)
   , iOwnParsers(true)
   , f_header_size(0)
   , f_min_frame_size(0)
   , f_max_frame_size(0)
+  , f_scan()
+  , f_syncs()
+  , f_stats()
 {
 }
 
@@ -48,15 +52,29 @@ void MultiHeaderParser::initSizes(void)
     f_min_frame_size = f_header_size;
 }
 
+void MultiHeaderParser::initDispatch(void)
+{
+  f_scan.clearAll();
+  f_syncs.resize(parserVec.size());
+
+  for ( size_t i = 0; i < parserVec.size(); ++i )
+    f_syncs[i] = parserVec[i]->addSyncs(f_scan);
+
+  f_stats.matches.assign(parserVec.size(), 0);
+  f_stats.reset();
+}
+
 void MultiHeaderParser::addParser(HeaderParser *hp)
 {
   parserVec.push_back(hp);
   initSizes();
+  initDispatch();
 }
 
 void MultiHeaderParser::releaseParsers(void)
 {
   currentParser = 0;
+  currentIndex = -1;
 
   if ( iOwnParsers )
   {
@@ -67,6 +85,7 @@ void MultiHeaderParser::releaseParsers(void)
 
   parserVec.clear();
   zeroSizes();
+  initDispatch();
 }
 
 void MultiHeaderParser::zeroSizes(void)
@@ -81,12 +100,12 @@ bool MultiHeaderParser::canParse(int format)
   if ( currentParser && currentParser->canParse(format) )
     return true;
 
-  for ( HeaderParserVec::iterator i = parserVec.begin()
-        ; i < parserVec.end(); i++ )
+  for ( size_t i = 0; i < parserVec.size(); ++i )
   {
-    if ( (*i)->canParse(format) )
+    if ( parserVec[i]->canParse(format) )
     {
-      currentParser = *i;
+      currentParser = parserVec[i];
+      currentIndex = (int)i;
       return true;
     }
   }
@@ -94,22 +113,52 @@ bool MultiHeaderParser::canParse(int format)
   return false;
 }
 
-bool MultiHeaderParser::parseHeader(const uint8_t *hdr, HeaderInfo *hinfo)
+// Find the parser that accepts the header (-1 if none). The current parser
+// goes first, other parsers are called only when the header starts with one
+// of their syncpoints. Parser calls are counted in the stats when
+// 'stats' is set (for parseHeader() only).
+
+int MultiHeaderParser::findParser(const uint8_t *hdr, HeaderInfo *hinfo, bool stats)
 {
-  if ( currentParser && currentParser->parseHeader(hdr, hinfo) )
-    return true;
+  const uint32_t sync(f_scan.getSync(hdr));
 
-  for ( HeaderParserVec::iterator i = parserVec.begin()
-        ; i < parserVec.end(); i++ )
+  if ( currentIndex >= 0 && (! f_syncs[currentIndex] || (f_syncs[currentIndex] & sync)) )
   {
-    if ( (*i)->parseHeader(hdr, hinfo) )
-    {
-      currentParser = *i;
-      return true;
-    }
+    if ( stats )
+      ++f_stats.calls;
+
+    if ( currentParser->parseHeader(hdr, hinfo) )
+      return currentIndex;
   }
 
-  return false;
+  for ( size_t i = 0; i < parserVec.size(); ++i )
+  {
+    if ( (int)i == currentIndex || (f_syncs[i] && ! (f_syncs[i] & sync)) )
+      continue;
+
+    if ( stats )
+      ++f_stats.calls;
+
+    if ( parserVec[i]->parseHeader(hdr, hinfo) )
+      return (int)i;
+  }
+
+  return -1;
+}
+
+bool MultiHeaderParser::parseHeader(const uint8_t *hdr, HeaderInfo *hinfo)
+{
+  ++f_stats.headers;
+
+  const int i(findParser(hdr, hinfo, true));
+
+  if ( i < 0 )
+    return false;
+
+  currentParser = parserVec[i];
+  currentIndex = i;
+  ++f_stats.matches[i];
+  return true;
 }
 
 bool MultiHeaderParser::compareHeaders(const uint8_t *hdr1 , const uint8_t *hdr2)
@@ -117,12 +166,17 @@ bool MultiHeaderParser::compareHeaders(const uint8_t *hdr1 , const uint8_t *hdr2
   if ( currentParser && currentParser->compareHeaders(hdr1, hdr2) )
     return true;
 
-  for ( HeaderParserVec::iterator i = parserVec.begin()
-        ; i < parserVec.end(); i++ )
+  const uint32_t sync(f_scan.getSync(hdr1));
+
+  for ( size_t i = 0; i < parserVec.size(); ++i )
   {
-    if ( (*i)->compareHeaders(hdr1, hdr2) )
+    if ( (int)i == currentIndex || (f_syncs[i] && ! (f_syncs[i] & sync)) )
+      continue;
+
+    if ( parserVec[i]->compareHeaders(hdr1, hdr2) )
     {
-      currentParser = *i;
+      currentParser = parserVec[i];
+      currentIndex = (int)i;
       return true;
     }
   }
@@ -132,20 +186,32 @@ bool MultiHeaderParser::compareHeaders(const uint8_t *hdr1 , const uint8_t *hdr2
 
 std::string MultiHeaderParser::getHeaderInfo(const uint8_t *hdr)
 {
-  if ( currentParser && currentParser->parseHeader(hdr) )
-    return currentParser->getHeaderInfo(hdr);
+  const int i(findParser(hdr, 0, false));
 
-  for ( HeaderParserVec::iterator i = parserVec.begin()
-        ; i < parserVec.end(); i++ )
+  if ( i < 0 )
+    return "";
+
+  currentParser = parserVec[i];
+  currentIndex = i;
+  return currentParser->getHeaderInfo(hdr);
+}
+
+uint32_t MultiHeaderParser::addSyncs(SyncScan &scan) const
+{
+  uint32_t syncmask = 0;
+
+  for ( size_t i = 0; i < parserVec.size(); ++i )
   {
-    if ( (*i)->parseHeader(hdr) )
-    {
-      currentParser = *i;
-      return (*i)->getHeaderInfo(hdr);
-    }
+    const uint32_t parser_syncmask = parserVec[i]->addSyncs(scan);
+
+    // each position must be checked for this parser
+    if ( ! parser_syncmask )
+      return 0;
+
+    syncmask |= parser_syncmask;
   }
 
-  return "";
+  return syncmask;
 }
 
 }; // namespace AudioFilter
@@ -0,0 +1,403 @@
+#include "BatchEngine.h"
+#include "ParallelDecoder.h"
+
+namespace AudioFilter {
+
+ParallelDecoder::ParallelDecoder(int _nthreads)
+  : nthreads(_nthreads > 0? _nthreads: BatchEngine::getCpuCount())
+  , segment_frames(64)
+  , preroll_samples(512)
+  , filename(0)
+  , factory(0)
+  , next_segment(0)
+  , next_output(0)
+  , cancel(false)
+{
+}
+
+bool
+ParallelDecoder::decode(const char *_filename, FrameParserFactory *_factory, Sink *_sink)
+{
+  stats = ParallelDecoderStats();
+
+  if ( ! _filename || ! _factory || ! _sink )
+    return false;
+
+  /////////////////////////////////////////////////////////
+  // Frame positions
+
+  {
+    FrameParser *parser = _factory->createParser();
+
+    if ( ! parser )
+      return false;
+
+    bool indexed;
+
+    {
+      FileParser file(_filename, parser->getHeaderParser());
+      indexed = file.isOpen() && (file.loadIndex() || file.buildIndex());
+
+      if ( indexed )
+        index = file.getIndex();
+    }
+
+    delete parser;
+
+    if ( ! indexed )
+      return false;
+  }
+
+  const size_t nframes(index.getFrameCount());
+
+  segment.clear();
+
+  for ( size_t first = 0; first < nframes; first += segment_frames )
+  {
+    Segment s;
+    s.first = first;
+    s.end = std::min(first + segment_frames, nframes);
+    s.state = seg_pending;
+    segment.push_back(s);
+  }
+
+  filename = _filename;
+  factory = _factory;
+  next_segment = 0;
+  next_output = 0;
+  cancel = false;
+
+  std::vector<Worker *> worker;
+
+  for ( int i = 0; i < nthreads && i < (int)segment.size(); ++i )
+  {
+    Worker *w = new Worker(this);
+
+    if ( ! w->create() )
+    {
+      delete w;
+      break;
+    }
+
+    worker.push_back(w);
+  }
+
+  /////////////////////////////////////////////////////////
+  // Give segments to the sink in order as they are done
+
+  Speakers spk(Speakers::UNKNOWN);
+  bool result = ! worker.empty() || segment.empty();
+
+  for ( size_t i = 0; result && i < segment.size(); ++i )
+  {
+    Segment &s = segment[i];
+
+    {
+      AutoLock l(&lock);
+
+      while ( s.state != seg_done && s.state != seg_failed )
+        sink_cond.wait(&lock);
+    }
+
+    // The worker does not touch a finished segment,
+    // so it is read without the lock.
+
+    result = s.state == seg_done && output(s, _sink, spk);
+
+    stats.frames += s.stats.frames;
+    stats.errors += s.stats.errors;
+    stats.preroll_frames += s.stats.preroll_frames;
+    stats.retries += s.stats.retries;
+    ++stats.segments;
+
+    std::vector<Frame>().swap(s.frames);
+    std::vector<sample_t>().swap(s.data);
+
+    {
+      AutoLock l(&lock);
+      next_output = i + 1;
+      worker_cond.broadcast();
+    }
+  }
+
+  if ( ! result )
+  {
+    AutoLock l(&lock);
+    cancel = true;
+    worker_cond.broadcast();
+  }
+
+  for ( size_t i = 0; i < worker.size(); ++i )
+  {
+    worker[i]->join();
+    delete worker[i];
+  }
+
+  if ( result && spk != Speakers::UNKNOWN )
+  {
+    Chunk eos;
+    eos.setEmpty(spk, false, 0, true);
+    result = _sink->process(&eos);
+  }
+
+  filename = 0;
+  factory = 0;
+  index.clear();
+  segment.clear();
+
+  return result;
+}
+
+bool
+ParallelDecoder::output(Segment &_seg, Sink *_sink, Speakers &_spk)
+{
+  for ( size_t i = 0; i < _seg.frames.size(); ++i )
+  {
+    const Frame &f = _seg.frames[i];
+
+    if ( f.spk != _spk )
+    {
+      if ( ! _sink->setInput(f.spk) )
+        return false;
+
+      _spk = f.spk;
+    }
+
+    samples_t samples;
+    samples.zero();
+
+    for ( int ch = 0; ch < f.spk.getChannelCount(); ++ch )
+      samples[ch] = &_seg.data[f.offset + ch * f.nsamples];
+
+    Chunk chunk(f.spk, samples, f.nsamples, true, f.time);
+
+    if ( ! _sink->process(&chunk) )
+      return false;
+  }
+
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Workers
+///////////////////////////////////////////////////////////////////////////////
+
+void
+ParallelDecoder::runWorker(void)
+{
+  FrameParser *parser;
+
+  {
+    AutoLock l(&lock);
+    parser = factory->createParser();
+  }
+
+  runSegments(parser);
+  delete parser;
+}
+
+void
+ParallelDecoder::runSegments(FrameParser *_parser)
+{
+  FileParser file(filename, _parser? _parser->getHeaderParser(): 0);
+
+  // Workers jump between segments, a mapping
+  // does not read ahead data that is not used.
+
+  file.map();
+
+  // Pre-roll found for the last segment
+  size_t preroll(1);
+
+  for ( ; ; )
+  {
+    size_t i;
+
+    /////////////////////////////////////////////////////
+    // Take the next segment (at most 2 segments per
+    // worker are decoded ahead of the sink)
+
+    {
+      AutoLock l(&lock);
+
+      while ( ! cancel && next_segment < segment.size() && next_segment >= next_output + 2 * nthreads )
+        worker_cond.wait(&lock);
+
+      if ( cancel || next_segment >= segment.size() )
+        break;
+
+      i = next_segment++;
+      segment[i].state = seg_busy;
+    }
+
+    // Segments are preallocated, so each worker
+    // writes its own segment without the lock.
+
+    const bool ok = _parser && file.isOpen() && decodeSegment(file, _parser, segment[i], preroll);
+
+    {
+      AutoLock l(&lock);
+      segment[i].state = ok? seg_done: seg_failed;
+      sink_cond.broadcast();
+    }
+  }
+}
+
+bool
+ParallelDecoder::decodeSegment(FileParser &_file, FrameParser *_parser, Segment &_seg, size_t &_preroll)
+{
+  size_t back(_preroll);
+  size_t retries(0);
+
+  for ( ; ; )
+  {
+    const size_t start(_seg.first > back? _seg.first - back: 0);
+
+    if ( tryDecode(_file, _parser, _seg, start, _preroll) )
+    {
+      _seg.stats.retries = retries;
+      return true;
+    }
+
+    if ( cancel || start == 0 )
+      return false;
+
+    ++retries;
+    back *= 2;
+  }
+}
+
+/////////////////////////////////////////////////////////
+// Decode the segment starting at the frame given.
+// Returns false when the parser state at the segment
+// start may differ from the serial decode or frames of
+// the segment were not loaded (the stream buffer syncs
+// after the seek and may miss frames near the end of a
+// stream), so the segment must be decoded from an
+// earlier frame.
+
+bool
+ParallelDecoder::tryDecode(FileParser &_file, FrameParser *_parser, Segment &_seg, size_t _start, size_t &_preroll)
+{
+  _seg.frames.clear();
+  _seg.data.clear();
+  _seg.stats = ParallelDecoderStats();
+
+  FrameIndexEntry entry;
+
+  if ( ! index.getEntry(_start, entry) )
+    return false;
+
+  // Serial decode starts at the beginning of the file
+  _file.seek(_start? entry.pos: 0);
+
+  // exact       - parser state equals the state of the serial decode
+  // run_frames  - frames decoded without errors in a row
+  // run_samples - samples in these frames
+  // next        - next frame expected
+
+  bool   exact = false;
+  size_t run_frames = 0;
+  size_t run_samples = 0;
+  size_t next = _start;
+
+  while ( next < _seg.end && _file.loadFrame() )
+  {
+    if ( cancel )
+      return false;
+
+    /////////////////////////////////////////////////////
+    // Find the frame in the index
+
+    const FrameIndex::fsize_t pos(_file.getFramePos());
+    size_t n(next);
+
+    if ( ! index.getEntry(n, entry) || entry.pos != pos )
+    {
+      n = index.findPos(pos);
+
+      // not a frame of the serial decode
+      if ( n < next || ! index.getEntry(n, entry) || entry.pos != pos )
+        continue;
+
+      // frames of the segment were missed
+      if ( n > _seg.first )
+        return false;
+
+      exact = false;
+      run_frames = 0;
+      run_samples = 0;
+    }
+
+    next = n + 1;
+
+    if ( n >= _seg.end )
+      break;
+
+    /////////////////////////////////////////////////////
+    // Decode
+
+    if ( entry.new_stream )
+    {
+      _parser->reset();
+      exact = true;
+    }
+
+    if ( n >= _seg.first && ! exact )
+      return false;
+
+    const bool decoded = _parser->parseFrame(_file.getFrame(), _file.getFrameSize());
+
+    if ( n < _seg.first )
+    {
+      ++_seg.stats.preroll_frames;
+
+      if ( ! decoded )
+      {
+        run_frames = 0;
+        run_samples = 0;
+        continue;
+      }
+
+      ++run_frames;
+      run_samples += _parser->getSampleCount();
+
+      if ( ! exact && run_samples >= preroll_samples )
+      {
+        exact = true;
+        _preroll = run_frames;
+      }
+
+      continue;
+    }
+
+    if ( ! decoded )
+    {
+      ++_seg.stats.errors;
+      continue;
+    }
+
+    /////////////////////////////////////////////////////
+    // Keep the output
+
+    Frame f;
+    f.spk = _parser->getSpeakers();
+    f.time = entry.time;
+    f.offset = _seg.data.size();
+    f.nsamples = _parser->getSampleCount();
+
+    samples_t samples = _parser->getSamples();
+
+    for ( int ch = 0; ch < f.spk.getChannelCount(); ++ch )
+      _seg.data.insert(_seg.data.end(), samples[ch], samples[ch] + f.nsamples);
+
+    _seg.frames.push_back(f);
+    ++_seg.stats.frames;
+  }
+
+  return next >= _seg.end;
+}
+
+}; // namespace AudioFilter
+
+// vim: ts=2 sts=2 et
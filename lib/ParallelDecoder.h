@@ -0,0 +1,210 @@
+#pragma once
+#ifndef VALIB_PARALLEL_DECODER_H
+#define VALIB_PARALLEL_DECODER_H
+/*
+  ParallelDecoder - decodes a compressed audio file on several threads.
+
+  For offline conversion the frames of a file do not have to be decoded one
+  after another: a frame depends on the previous frames only through a
+  short decoder state (IMDCT overlap for AC3, synthesis window for MPEG
+  audio). The decoder splits the frames of the file into segments decoded
+  by a pool of worker threads, each with its own file handle and frame
+  parser, and gives the decoded audio to the sink in file order:
+
+    ParallelDecoder dec;
+    dec.decode("movie.ac3", &factory, &sink);
+
+  Pre-roll
+  ========
+  A worker starts decoding a few frames before its segment (the pre-roll)
+  and drops their output. The pre-roll is long enough when the frames
+  decoded before the segment cover the decoder history (preroll_samples,
+  512 by default: the MPEG audio synthesis window, AC3 needs 256). So AC3
+  and MPEG Layer II need one frame and Layer I needs two. The state is
+  only trusted when all pre-roll frames were decoded without errors, the
+  worker seeks further back otherwise (up to the start of the stream where
+  the parser is reset anyway). So the output matches a serial decode of the
+  file sample by sample.
+
+  The parser is reset at the first frame of each stream (new stream flag in
+  the frame index), as a serial decoder does. Other format changes in the
+  index (sample rate or sample count) do not reset the parser.
+  Frames that fail to decode give no output.
+
+  Frame parsers must not keep other state between frames (for this reason
+  AC3 dither is restarted at each frame and the IMDCT overlap is dropped
+  when the channel layout changes). State carried over by broken
+  streams, e.g. rematrixing flags reused by an AC3 frame that does not
+  send them, is restored only when it is sent within the pre-roll.
+
+  Segments
+  ========
+  Frame positions are taken from the frame index of the file (loaded from
+  the sidecar when possible, built otherwise). Segments are segment_frames
+  long (64 by default, about 2 seconds of AC3) and at most 2 segments per
+  worker are decoded ahead of the sink, so memory use does not depend on
+  the file length.
+*/
+
+#include <vector>
+#include <AudioFilter/FileParser.h>
+#include <AudioFilter/Filter.h>
+#include "Thread.h"
+
+namespace AudioFilter {
+
+///////////////////////////////////////////////////////////////////////////////
+// FrameParserFactory - makes a parser for a worker
+// Called from worker threads, parsers are deleted by the workers.
+
+class FrameParserFactory
+{
+public:
+  virtual ~FrameParserFactory() {}
+  virtual FrameParser *createParser(void) = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ParallelDecoderStats - decode counters
+//
+// frames         - frames decoded into the output
+// errors         - frames failed to decode (no output)
+// segments       - number of segments
+// preroll_frames - frames decoded for the pre-roll only
+// retries        - segments restarted with a longer pre-roll
+
+struct ParallelDecoderStats
+{
+  size_t frames;
+  size_t errors;
+  size_t segments;
+  size_t preroll_frames;
+  size_t retries;
+
+  ParallelDecoderStats()
+    : frames(0), errors(0), segments(0), preroll_frames(0), retries(0)
+  {}
+};
+
+class ParallelDecoder
+{
+public:
+  // _nthreads == 0 - worker per CPU
+  ParallelDecoder(int _nthreads = 0);
+
+  /////////////////////////////////////////////////////////
+  // Settings
+  //
+  // setSegmentFrames()
+  //   Number of frames in a segment.
+  //
+  // setPrerollSamples()
+  //   Decoder history to cover with the pre-roll (samples).
+
+  void setSegmentFrames(size_t _segment_frames)
+  {
+    segment_frames = _segment_frames > 0? _segment_frames: 1;
+  }
+
+  void setPrerollSamples(size_t _preroll_samples)
+  {
+    preroll_samples = _preroll_samples;
+  }
+
+  int getThreadCount(void) const
+  {
+    return nthreads;
+  }
+
+  const ParallelDecoderStats &getStats(void) const
+  {
+    return stats;
+  }
+
+  /////////////////////////////////////////////////////////
+  // Decode the file to the sink (blocks until done).
+  // Each chunk given to the sink is a decoded frame. The
+  // sink receives an end-of-stream chunk at the end.
+  // Returns false when the file cannot be opened or
+  // indexed, or the sink fails.
+
+  bool decode(const char *_filename, FrameParserFactory *_factory, Sink *_sink);
+
+protected:
+  /////////////////////////////////////////////////////////
+  // Segment of frames and its output
+  //
+  // Decoded frames are kept in one buffer, channels of
+  // a frame follow each other starting at the offset.
+
+  enum { seg_pending, seg_busy, seg_done, seg_failed };
+
+  struct Frame
+  {
+    Speakers spk;
+    vtime_t  time;
+    size_t   offset;
+    size_t   nsamples;
+  };
+
+  struct Segment
+  {
+    size_t first;
+    size_t end;
+    int    state;
+
+    std::vector<Frame> frames;
+    std::vector<sample_t> data;
+    ParallelDecoderStats stats;
+  };
+
+  /////////////////////////////////////////////////////////
+  // Worker
+
+  class Worker : public Thread
+  {
+  public:
+    Worker(ParallelDecoder *_dec): dec(_dec)
+    {}
+
+    ParallelDecoder *dec;
+
+  protected:
+    virtual int process(void)
+    {
+      dec->runWorker();
+      return 0;
+    }
+  };
+
+  int    nthreads;
+  size_t segment_frames;
+  size_t preroll_samples;
+  ParallelDecoderStats stats;
+
+  // Run state (guarded by the lock)
+
+  CritSec lock;
+  Condition worker_cond; // signalled when a segment is given to the sink
+  Condition sink_cond;   // signalled when a segment is decoded
+
+  const char *filename;
+  FrameParserFactory *factory;
+  FrameIndex index;
+  std::vector<Segment> segment;
+  size_t next_segment;
+  size_t next_output;
+  volatile bool cancel;
+
+  void runWorker(void);
+  void runSegments(FrameParser *_parser);
+  bool decodeSegment(FileParser &_file, FrameParser *_parser, Segment &_seg, size_t &_preroll);
+  bool tryDecode(FileParser &_file, FrameParser *_parser, Segment &_seg, size_t _start, size_t &_preroll);
+  bool output(Segment &_seg, Sink *_sink, Speakers &_spk);
+};
+
+}; // namespace AudioFilter
+
+#endif
+
+// vim: ts=2 sts=2 et
@@ -1,6 +1,6 @@
-#include <iostream>
 #include <cstdio>
 #include <AudioFilter/Parsers.h>
+#include <AudioFilter/VTime.h>
 
 namespace AudioFilter {
 
@@ -76,8 +76,9 @@ StreamBuffer::StreamBuffer()
   , _headerSize(0)
   , _minFrameSize(0)
   , _maxFrameSize(0)
+  , _scan()
+  , _syncMask(0)
   , _buf()
-  , _headerBuf(new uint8_t[65536])
   , _hinfo()
   , _sync()
   , _preFrameSize(0)
@@ -85,6 +86,8 @@ StreamBuffer::StreamBuffer()
   , _frame()
   , _isInSync(false)
   , _isNewStream(false)
+  , _stats()
+  , _callback(0)
 {
   _hinfo.drop();
 }
@@ -94,8 +97,9 @@ StreamBuffer::StreamBuffer(HeaderParser *parser)
   , _headerSize(0)
   , _minFrameSize(0)
   , _maxFrameSize(0)
+  , _scan()
+  , _syncMask(0)
   , _buf()
-  , _headerBuf(new uint8_t[65536])
   , _hinfo()
   , _sync()
   , _preFrameSize(0)
@@ -103,6 +107,8 @@ StreamBuffer::StreamBuffer(HeaderParser *parser)
   , _frame()
   , _isInSync(false)
   , _isNewStream(false)
+  , _stats()
+  , _callback(0)
 {
   _hinfo.drop();
   setParser(parser);
@@ -110,7 +116,6 @@ StreamBuffer::StreamBuffer(HeaderParser *parser)
 
 StreamBuffer::~StreamBuffer()
 {
-  delete[] _headerBuf;
 }
 
 bool StreamBuffer::setParser(HeaderParser *parser)
@@ -124,7 +129,8 @@ bool StreamBuffer::setParser(HeaderParser *parser)
     _headerSize = _parser->getHeaderSize();
     _minFrameSize = _parser->getMinFrameSize();
     _maxFrameSize = _parser->getMaxFrameSize();
-    //_headerBuf = _buf.data();
+    _scan.clearAll();
+    _syncMask = _parser->addSyncs(_scan);
     _sync.ptr = _buf.data() + _headerSize;
     _sync.size = _maxFrameSize * 3 + _headerSize;
 
@@ -142,8 +148,8 @@ void StreamBuffer::releaseParser(void)
   _headerSize = 0;
   _minFrameSize = 0;
   _maxFrameSize = 0;
+  _syncMask = 0;
 
-  //_headerBuf = 0;
   _sync.ptr = 0;
   _sync.size = 0;
 }
@@ -189,6 +195,46 @@ bool StreamBuffer::loadBuffer(uint8_t **data, uint8_t *end, size_t required_size
   }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Skip positions that cannot start a header. Returns the first position of
+// a syncpoint in the data up to 'data_end', starting from 'pos' and up to
+// 'pos_max'. Returns 'pos_max' + 1 when there is no syncpoint up to
+// 'pos_max', and the first position not checked when the data ends before
+// 'pos_max'. Header at the position returned must still be checked with the
+// parser.
+
+uint8_t *StreamBuffer::findSync(uint8_t *pos, uint8_t *pos_max, uint8_t *data_end) const
+{
+  if ( ! _syncMask )
+    return pos;
+
+  // positions with the whole syncword loaded
+  uint8_t *limit(pos_max + 1);
+
+  if ( data_end - pos < 4 )
+    return pos;
+
+  if ( limit > data_end - 3 )
+    limit = data_end - 3;
+
+  if ( pos >= limit )
+    return pos;
+
+  uint32_t syncword;
+  ::memcpy(&syncword, pos, 4);
+
+  if ( _scan.getSync((uint8_t *)&syncword) )
+    return pos;
+
+  // scan syncwords starting at pos + 1 ... limit - 1
+  const size_t gone(_scan.scan((uint8_t *)&syncword, pos + 4, limit - pos - 1));
+
+  if ( _scan.getSync((uint8_t *)&syncword) )
+    return pos + gone;
+
+  return limit;
+}
+
 bool StreamBuffer::loadFrame(uint8_t **data, uint8_t *end)
 {
   while ( *data < end || isFrameLoaded() || isDebrisExists() )
@@ -211,7 +257,7 @@ bool StreamBuffer::load(uint8_t **data, uint8_t *end)
   }
 
   if ( ! _isInSync )
-    return reSync(data, end);
+    return sync(data, end);
 
   if ( isFrameLoaded() ) // Drop old debris and frame data
   {
@@ -222,6 +268,11 @@ bool StreamBuffer::load(uint8_t **data, uint8_t *end)
 
   _isNewStream = false;
 
+  if ( ! _sync.dataSize && loadDirect(data, end) )
+    return true;
+
+  uint8_t *start(*data);
+
   /////////////////////////////////////////////////////////////////////////////
   // Load next frame
 
@@ -236,6 +287,11 @@ bool StreamBuffer::load(uint8_t **data, uint8_t *end)
 
   while ( _frame.ptr <= frame_max )
   {
+    _frame.ptr = findSync(_frame.ptr, frame_max);
+
+    if ( _frame.ptr > frame_max )
+      break;
+
     if ( ! loadBuffer(data, end, _frame.ptr - _sync.ptr + _headerSize) )
       return false;
 
@@ -257,18 +313,8 @@ bool StreamBuffer::load(uint8_t **data, uint8_t *end)
     ///////////////////////////////////////////////////////////////////////////
     // DONE! Prepare new frame output.
 
-    if ( _hinfo.getFrameSize() )
-      _frame.interval = _hinfo.getFrameSize() + _frame.ptr - _sync.ptr;
-
-    ::memcpy(_headerBuf, _frame.ptr, _hinfo.getFrameSize());
-    _parser->parseHeader(_headerBuf, &_hinfo);
-
-    _debris.ptr = _sync.ptr;
-    _debris.size = _frame.ptr - _sync.ptr;
-
-    _frame.size = ( _hinfo.getFrameSize() ) ? _hinfo.getFrameSize() : _frame.interval;
-
-    ++_frame.count;
+    setFrame(_sync.ptr, _frame.ptr, hi);
+    unloadBuffer(data, start);
     return true;
   }
 
@@ -281,7 +327,133 @@ bool StreamBuffer::load(uint8_t **data, uint8_t *end)
   _frame.ptr = 0;
   _frame.size = 0;
   _frame.interval = 0;
-  return reSync(data, end);
+
+  ++_stats.resyncs;
+  if ( _callback )
+    _callback->onSync(SyncCallback::sync_lost, _stats);
+
+  return sync(data, end);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// reSync() with statistics
+
+bool StreamBuffer::sync(uint8_t **data, uint8_t *end)
+{
+  const vtime_t start_time(getWallClock());
+  const bool result(reSync(data, end));
+
+  _stats.sync_time += getWallClock() - start_time;
+  _stats.debris_bytes += _debris.size;
+
+  if ( _isInSync )
+  {
+    ++_stats.syncs;
+    if ( _callback )
+      _callback->onSync(SyncCallback::sync_found, _stats);
+  }
+
+  return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Zero-copy frame loading. When nothing is buffered and the next frame is
+// contained in the input data, debris and frame point directly into the
+// input and no data is copied. Only BITSTREAM_8 frames are loaded so:
+// frame parsers convert other bitstreams to BITSTREAM_8 in place, and this
+// must not change the input (a file mapping is read again after a seek).
+// Returns false without any change when the frame is not found in
+// the input (it may cross the input boundary, or it is time to resync) or
+// must be copied, so load() may repeat the search on buffered data.
+// Search rules are the same as in load().
+
+bool StreamBuffer::loadDirect(uint8_t **data, uint8_t *end)
+{
+  uint8_t *base(*data);
+  uint8_t *frame_ptr(base);
+  uint8_t *frame_max(base);
+
+  if ( _hinfo.getFrameSize() && _hinfo.getFrameSize() < _hinfo.getScanSize() )
+    frame_max += _hinfo.getScanSize() - _hinfo.getFrameSize();
+
+  while ( frame_ptr <= frame_max )
+  {
+    frame_ptr = findSync(frame_ptr, frame_max, end);
+
+    if ( frame_ptr > frame_max )
+      return false;
+
+    if ( size_t(end - frame_ptr) < _headerSize )
+      return false;
+
+    HeaderInfo hi;
+
+    if ( ! _parser->parseHeader(frame_ptr, &hi) )
+    {
+      ++frame_ptr;
+      continue;
+    }
+
+    if ( hi.getBsType() != BITSTREAM_8 )
+      return false;
+
+    // frame size as set by setFrame()
+    size_t frame_size(hi.getFrameSize());
+
+    if ( ! frame_size )
+      frame_size = _hinfo.getFrameSize() ? _hinfo.getFrameSize() + (frame_ptr - base) : _frame.interval;
+
+    if ( size_t(end - frame_ptr) < frame_size )
+      return false;
+
+    setFrame(base, frame_ptr, hi);
+    *data = frame_ptr + _frame.size;
+    return true;
+  }
+
+  return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Return the data buffered after the frame back to the input when all of
+// it was loaded from the input since 'start' (so it is still there). The
+// buffer becomes empty after the frame is dropped, and the next frame may be
+// loaded directly from the input.
+
+void StreamBuffer::unloadBuffer(uint8_t **data, uint8_t *start)
+{
+  const size_t used(_debris.size + _frame.size);
+
+  if ( _sync.dataSize <= used )
+    return;
+
+  const size_t excess(_sync.dataSize - used);
+
+  if ( excess <= size_t(*data - start) )
+  {
+    *data -= excess;
+    _sync.dataSize = used;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Set the frame found at 'frame_ptr' with debris from 'debris_ptr'.
+
+void StreamBuffer::setFrame(uint8_t *debris_ptr, uint8_t *frame_ptr, const HeaderInfo &hi)
+{
+  if ( _hinfo.getFrameSize() )
+    _frame.interval = _hinfo.getFrameSize() + frame_ptr - debris_ptr;
+
+  _hinfo = hi;
+
+  _debris.ptr = debris_ptr;
+  _debris.size = frame_ptr - debris_ptr;
+  _stats.debris_bytes += _debris.size;
+
+  _frame.ptr = frame_ptr;
+  _frame.size = ( _hinfo.getFrameSize() ) ? _hinfo.getFrameSize() : _frame.interval;
+
+  ++_frame.count;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -311,6 +483,8 @@ bool StreamBuffer::reSync(uint8_t **data, uint8_t *end)
   assert(!_isInSync && !_isNewStream);
   assert(_frame.ptr == 0 && _frame.size == 0 && _frame.interval == 0);
 
+  uint8_t *start(*data);
+
   /////////////////////////////////////////////////////////////////////////////
   // Drop debris
 
@@ -337,10 +511,16 @@ bool StreamBuffer::reSync(uint8_t **data, uint8_t *end)
 
   while ( pf1 <= pf1Max )
   {
+    pf1 = findSync(pf1, pf1Max);
+
+    if ( pf1 > pf1Max )
+      break;
+
     if ( ! loadBuffer(data, end, pf1 - _sync.ptr + _headerSize) )
       return false;
 
     HeaderInfo hi1;
+    ++_stats.candidates;
 
     if ( _parser->parseHeader(pf1, &hi1) )
     {
@@ -356,7 +536,6 @@ bool StreamBuffer::reSync(uint8_t **data, uint8_t *end)
 
       if ( hi1.getFrameSize() )
       {
-        std::cout << "FrameSize1=" << hi1.getFrameSize() << std::endl;
         pf2 = pf1 + hi1.getFrameSize();
         pf2Max = pf1 + MAX(hi1.getScanSize(), hi1.getFrameSize());
       }
@@ -368,10 +547,16 @@ bool StreamBuffer::reSync(uint8_t **data, uint8_t *end)
 
       while ( pf2 <= pf2Max )
       {
+        pf2 = findSync(pf2, pf2Max);
+
+        if ( pf2 > pf2Max )
+          break;
+
         if ( ! loadBuffer(data, end, pf2 - _sync.ptr + _headerSize) )
           return false;
 
         HeaderInfo hi2;
+        ++_stats.candidates;
 
         if ( ! _parser->parseHeader(pf2, &hi2) )
         {
@@ -391,7 +576,6 @@ bool StreamBuffer::reSync(uint8_t **data, uint8_t *end)
 
         if ( hi2.getFrameSize() )
         {
-          std::cout << "FrameSize2=" << hi2.getFrameSize() << std::endl;
           pf3 = pf2 + hi2.getFrameSize();
           pf3Max = pf2 + MAX(hi2.getScanSize(), hi2.getFrameSize());
         }
@@ -403,9 +587,16 @@ bool StreamBuffer::reSync(uint8_t **data, uint8_t *end)
 
         while ( pf3 <= pf3Max )
         {
+          pf3 = findSync(pf3, pf3Max);
+
+          if ( pf3 > pf3Max )
+            break;
+
           if ( ! loadBuffer(data, end, pf3 - _sync.ptr + _headerSize) )
             return false;
 
+          ++_stats.candidates;
+
           if ( ! _parser->parseHeader(pf3) )
           {
             ++pf3;
@@ -428,9 +619,7 @@ bool StreamBuffer::reSync(uint8_t **data, uint8_t *end)
           ///////////////////////////////////////////////////////////////////////
           // DONE! Prepare first frame output.
 
-          //::memcpy(_headerBuf, pf1, _headerSize);
-          ::memcpy(_headerBuf, pf1, hi1.getFrameSize());
-          _parser->parseHeader(_headerBuf, &_hinfo);
+          _hinfo = hi1;
 
           _frame.ptr = pf1;
           _frame.interval = pf2 - pf1;
@@ -440,6 +629,7 @@ bool StreamBuffer::reSync(uint8_t **data, uint8_t *end)
           _isNewStream = true;
 
           ++_frame.count;
+          unloadBuffer(data, start);
           return true;
         }
 
@@ -455,6 +645,8 @@ bool StreamBuffer::reSync(uint8_t **data, uint8_t *end)
       // No correct sync sequence found.
       /////////////////////////////////////////////////////////////////////////
 
+      ++_stats.false_syncs;
+
     } // if (_parser->parse_header(pf1, &hdr))
 
     ++pf1;
@@ -474,6 +666,13 @@ bool StreamBuffer::reSync(uint8_t **data, uint8_t *end)
 
   while ( pos <= posMax )
   {
+    pos = findSync(pos, posMax);
+
+    if ( pos > posMax )
+      break;
+
+    ++_stats.candidates;
+
     if ( _parser->parseHeader(pos) )
       break;
 
@@ -497,6 +696,7 @@ bool StreamBuffer::flush(void)
 
   _debris.ptr = _sync.ptr;
   _debris.size = _sync.dataSize;
+  _stats.debris_bytes += _debris.size;
 
   return _debris.size > 0;
 }
@@ -508,11 +708,6 @@ void StreamBuffer::dropBuffer(size_t size)
   if ( ! _sync.dataSize )
     return;
 
-  if ( _sync.dataSize < size )
-  {
-    std::cout << "Messed up in dropBuf _sync.dataSize=" << _sync.dataSize
-            << " size=" << size << std::endl;
-  }
   assert(_sync.dataSize >= size);
   _sync.dataSize -= size;
   ::memmove(_sync.ptr, _sync.ptr + size, _sync.dataSize);
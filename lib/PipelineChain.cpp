@@ -0,0 +1,577 @@
+#include <cstdio>  // snprintf
+#include <cstring> // memcpy
+#include "PipelineChain.h"
+
+#ifdef _MSC_VER
+#define snprintf _snprintf
+#endif
+
+namespace AudioFilter {
+
+PipelineChain::PipelineChain(size_t _queue_depth)
+  : running(false)
+  , low_latency(false)
+  , cancelled(false)
+  , failed(false)
+  , inflight(0)
+  , pending_eos(0)
+  , queue_depth(_queue_depth? _queue_depth: 1)
+  , nstages(0)
+{
+  updateCapacity();
+}
+
+PipelineChain::~PipelineChain()
+{
+  drop();
+  clearQueues();
+
+  for ( int i = 0; i <= graph_nodes; ++i )
+  {
+    for ( size_t j = 0; j < queue[i].pool.size(); ++j )
+      delete queue[i].pool[j];
+
+    queue[i].pool.clear();
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// PipelineChain interface
+///////////////////////////////////////////////////////////////////////////////
+
+bool
+PipelineChain::addFront(Filter *_filter, const char *_desc, bool _same_stage)
+{
+  stop();
+
+  if ( ! _same_stage || ! nstages )
+  {
+    if ( nstages >= graph_nodes )
+      return false;
+
+    for ( int i = nstages; i > 0; --i )
+    {
+      stage[i] = stage[i-1];
+      stage[i]->index = i;
+    }
+
+    stage[0] = new Stage(this, 0);
+    ++nstages;
+    updateCapacity();
+  }
+
+  return stage[0]->chain.addFront(_filter, _desc);
+}
+
+bool
+PipelineChain::addBack(Filter *_filter, const char *_desc, bool _same_stage)
+{
+  stop();
+
+  if ( ! _same_stage || ! nstages )
+  {
+    if ( nstages >= graph_nodes )
+      return false;
+
+    stage[nstages] = new Stage(this, nstages);
+    ++nstages;
+    updateCapacity();
+  }
+
+  return stage[nstages-1]->chain.addBack(_filter, _desc);
+}
+
+void
+PipelineChain::drop(void)
+{
+  stop();
+
+  for ( int i = 0; i < nstages; ++i )
+  {
+    delete stage[i];
+    stage[i] = 0;
+  }
+
+  nstages = 0;
+  updateCapacity();
+  in_spk = Speakers::UNKNOWN;
+  out_spk = Speakers::UNKNOWN;
+}
+
+void
+PipelineChain::setQueueDepth(size_t _queue_depth)
+{
+  stop();
+  queue_depth = _queue_depth? _queue_depth: 1;
+  updateCapacity();
+}
+
+size_t
+PipelineChain::chainText(char *buf, size_t buf_size) const
+{
+  size_t i;
+  char *buf_ptr = buf;
+
+  for ( int s = 0; s < nstages; ++s )
+  {
+    if ( s )
+    {
+      i = snprintf(buf_ptr, buf_size, " | ");
+      buf_ptr += i;
+      buf_size = (buf_size > i)? buf_size - i: 0;
+    }
+
+    i = stage[s]->chain.chainText(buf_ptr, buf_size);
+    buf_ptr += i;
+    buf_size = (buf_size > i)? buf_size - i: 0;
+  }
+
+  return buf_ptr - buf;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Workers and queues
+///////////////////////////////////////////////////////////////////////////////
+
+void
+PipelineChain::updateCapacity(void)
+{
+  for ( int i = 0; i <= graph_nodes; ++i )
+    queue[i].capacity = queue_depth;
+
+  // output queue is drained by the caller
+  queue[nstages].capacity = 0;
+}
+
+bool
+PipelineChain::start(void)
+{
+  if ( running )
+    return true;
+
+  running = true;
+
+  for ( int i = 0; i < nstages; ++i )
+  {
+    stage[i]->chain.setLowLatency(low_latency);
+
+    if ( ! stage[i]->create() )
+    {
+      stop();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void
+PipelineChain::stop(void)
+{
+  if ( running )
+  {
+    {
+      AutoLock l(&lock);
+      cancelled = true;
+      cond.broadcast();
+    }
+
+    for ( int i = 0; i < nstages; ++i )
+      stage[i]->join();
+  }
+
+  AutoLock l(&lock);
+  clearQueues();
+  running = false;
+  cancelled = false;
+  failed = false;
+  inflight = 0;
+  pending_eos = 0;
+}
+
+void
+PipelineChain::clearQueues(void)
+{
+  for ( int i = 0; i <= graph_nodes; ++i )
+  {
+    Queue &q = queue[i];
+
+    if ( q.current )
+      recycle(q, q.current);
+
+    q.current = 0;
+
+    while ( ! q.data.empty() )
+    {
+      recycle(q, q.data.front());
+      q.data.pop_front();
+    }
+  }
+}
+
+void
+PipelineChain::recycle(Queue &q, Slot *slot)
+{
+  // let upstream reuse its block
+  slot->chunk.buf.release();
+  q.pool.push_back(slot);
+}
+
+void
+PipelineChain::copyChunk(Slot *slot, const Chunk *chunk)
+{
+  Chunk &c = slot->chunk;
+
+  if ( chunk->isEmpty() )
+  {
+    c.setEmpty(chunk->spk, chunk->sync, chunk->time, chunk->eos);
+    return;
+  }
+
+  if ( chunk->spk.isLinear() )
+  {
+    const unsigned nch = chunk->spk.getChannelCount();
+
+    // keep the upstream block instead of copying
+    unsigned ch = 0;
+    while ( ch < nch && chunk->buf.contains(chunk->samples[ch], chunk->size * sizeof(sample_t)) )
+      ++ch;
+
+    if ( ch == nch )
+    {
+      c = *chunk;
+      return;
+    }
+
+    if ( slot->samples.getChannelCount() != nch || slot->samples.getSampleCount() < chunk->size )
+      slot->samples.allocate(nch, chunk->size);
+
+    for ( unsigned ch = 0; ch < nch; ++ch )
+      memcpy(slot->samples[ch], chunk->samples[ch], chunk->size * sizeof(sample_t));
+
+    c.setLinear(chunk->spk, slot->samples, chunk->size, chunk->sync, chunk->time, chunk->eos);
+  }
+  else
+  {
+    if ( chunk->buf.contains(chunk->rawdata, chunk->size) )
+    {
+      c = *chunk;
+      return;
+    }
+
+    slot->rawdata.allocate(chunk->size);
+    memcpy(slot->rawdata, chunk->rawdata, chunk->size);
+
+    c.setRawData(chunk->spk, slot->rawdata, chunk->size, chunk->sync, chunk->time, chunk->eos);
+  }
+}
+
+/////////////////////////////////////////////////////////
+// Put a copy of the chunk into the queue.
+// Blocks while the queue is full. Returns false when
+// the pipeline is stopped or a stage has failed (the
+// failed stage does not drain its queue any more).
+
+bool
+PipelineChain::push(int q, const Chunk *chunk)
+{
+  Queue &dst = queue[q];
+  Slot *slot;
+
+  {
+    AutoLock l(&lock);
+
+    while ( ! cancelled && ! failed && dst.capacity && dst.data.size() >= dst.capacity )
+      cond.wait(&lock);
+
+    if ( cancelled || failed )
+      return false;
+
+    if ( dst.pool.empty() )
+      slot = new Slot;
+    else
+    {
+      slot = dst.pool.back();
+      dst.pool.pop_back();
+    }
+  }
+
+  // copy outside of the lock, single producer
+  // owns the slot until it is queued
+
+  copyChunk(slot, chunk);
+
+  AutoLock l(&lock);
+
+  if ( cancelled || failed )
+  {
+    recycle(dst, slot);
+    return false;
+  }
+
+  dst.data.push_back(slot);
+
+  if ( q < nstages )
+    ++inflight;
+
+  cond.broadcast();
+  return true;
+}
+
+/////////////////////////////////////////////////////////
+// Get the next chunk from the queue.
+// Chunk data is valid until the next pop() from the same
+// queue. Blocks while the queue is empty. Returns false
+// when the pipeline is stopped or a stage has failed.
+
+bool
+PipelineChain::pop(int q, Chunk *chunk)
+{
+  Queue &src = queue[q];
+  AutoLock l(&lock);
+
+  if ( src.current )
+    recycle(src, src.current);
+
+  src.current = 0;
+
+  while ( ! cancelled && ! failed && src.data.empty() )
+    cond.wait(&lock);
+
+  if ( cancelled || failed )
+    return false;
+
+  src.current = src.data.front();
+  src.data.pop_front();
+  *chunk = src.current->chunk;
+
+  cond.broadcast();
+  return true;
+}
+
+void
+PipelineChain::runStage(int index)
+{
+  FilterChain &chain = stage[index]->chain;
+  Chunk in, out;
+
+  while ( pop(index, &in) )
+  {
+    bool ok = chain.process(&in);
+
+    while ( ok && ! chain.isEmpty() )
+    {
+      ok = chain.getChunk(&out);
+
+      if ( ok && ! out.isDummy() && ! push(index + 1, &out) )
+        return; // stopped or failed
+    }
+
+    // the chunk is done only after all its output
+    // is queued downstream, so inflight never drops
+    // to zero while there is some work to do
+
+    AutoLock l(&lock);
+    --inflight;
+
+    // wake up the stages and the caller blocked on
+    // the queues, so the error reaches process()
+
+    if ( ! ok )
+      failed = true;
+
+    cond.broadcast();
+
+    if ( ! ok )
+      return;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Filter interface
+///////////////////////////////////////////////////////////////////////////////
+
+void
+PipelineChain::reset(void)
+{
+  stop();
+
+  for ( int i = 0; i < nstages; ++i )
+    stage[i]->chain.reset();
+
+  in_spk = Speakers::UNKNOWN;
+  out_spk = Speakers::UNKNOWN;
+}
+
+bool
+PipelineChain::isOfdd(void) const
+{
+  for ( int i = 0; i < nstages; ++i )
+  {
+    if ( stage[i]->chain.isOfdd() )
+      return true;
+  }
+
+  return false;
+}
+
+bool
+PipelineChain::queryInput(Speakers _spk) const
+{
+  if ( ! nstages )
+    return true;
+
+  return stage[0]->chain.queryInput(_spk);
+}
+
+bool
+PipelineChain::setInput(Speakers _spk)
+{
+  reset();
+
+  Speakers spk = _spk;
+
+  for ( int i = 0; i < nstages; ++i )
+  {
+    if ( ! stage[i]->chain.setInput(spk) )
+    {
+      reset();
+      return false;
+    }
+
+    spk = stage[i]->chain.getOutput();
+  }
+
+  in_spk = _spk;
+  out_spk = spk;
+  return true;
+}
+
+Speakers
+PipelineChain::getInput(void) const
+{
+  return in_spk;
+}
+
+bool
+PipelineChain::process(const Chunk *_chunk)
+{
+  if ( _chunk->isDummy() )
+    return true;
+
+  {
+    AutoLock l(&lock);
+
+    if ( failed )
+      return false;
+
+    // forget eos-chunks swallowed by some filter
+    if ( ! inflight && queue[nstages].data.empty() )
+      pending_eos = 0;
+
+    if ( _chunk->eos )
+      ++pending_eos;
+  }
+
+  if ( ! start() )
+    return false;
+
+  in_spk = _chunk->spk;
+  return push(0, _chunk);
+}
+
+Speakers
+PipelineChain::getOutput(void) const
+{
+  AutoLock l(&lock);
+
+  const Queue &out = queue[nstages];
+
+  if ( ! out.data.empty() )
+    return out.data.front()->chunk.spk;
+
+  return out_spk;
+}
+
+bool
+PipelineChain::isEmpty(void) const
+{
+  AutoLock l(&lock);
+
+  // report error at getChunk()
+  if ( failed )
+    return false;
+
+  if ( ! queue[nstages].data.empty() )
+    return false;
+
+  // wait for the flushed data
+  return ! pending_eos || ! inflight;
+}
+
+bool
+PipelineChain::getChunk(Chunk *_chunk)
+{
+  Queue &out = queue[nstages];
+  AutoLock l(&lock);
+
+  if ( out.current )
+    recycle(out, out.current);
+
+  out.current = 0;
+
+  while ( out.data.empty() && inflight && ! failed )
+    cond.wait(&lock);
+
+  if ( out.data.empty() )
+  {
+    _chunk->setDummy();
+    pending_eos = 0;
+    return ! failed;
+  }
+
+  out.current = out.data.front();
+  out.data.pop_front();
+  *_chunk = out.current->chunk;
+
+  out_spk = _chunk->spk;
+
+  if ( _chunk->eos && pending_eos )
+    --pending_eos;
+
+  cond.broadcast();
+  return true;
+}
+
+vtime_t
+PipelineChain::getLatency(void) const
+{
+  vtime_t latency = 0;
+
+  for ( int i = 0; i < nstages; ++i )
+    latency += stage[i]->chain.getLatency();
+
+  return latency;
+}
+
+bool
+PipelineChain::setLowLatency(bool _low_latency)
+{
+  low_latency = _low_latency;
+
+  if ( ! running )
+    for ( int i = 0; i < nstages; ++i )
+      stage[i]->chain.setLowLatency(low_latency);
+
+  return true;
+}
+
+bool
+PipelineChain::getLowLatency(void) const
+{
+  return low_latency;
+}
+
+}; // namespace AudioFilter
+
+// vim: ts=2 sts=2 et
@@ -0,0 +1,204 @@
+#pragma once
+#ifndef VALIB_PIPELINE_CHAIN_H
+#define VALIB_PIPELINE_CHAIN_H
+/*
+  PipelineChain - pipelined (multi-threaded) version of FilterChain.
+
+  Filters are grouped into stages. Each stage is a FilterChain driven by its
+  own worker thread, and stages are linked with bounded single-producer /
+  single-consumer chunk queues. So a decode -> mix -> convolve -> convert
+  chain may use a core per stage instead of running on the caller's thread:
+
+    PipelineChain chain;
+    chain.addBack(&dec, "Decoder");          // stage 0
+    chain.addBack(&mixer, "Mixer");          // stage 1
+    chain.addBack(&conv, "Convolver", true); // also stage 1
+    chain.addBack(&out, "Converter");        // stage 2
+
+    chain.setInput(src.getOutput());
+    chain.transform(&src, &sink);
+
+  Queued chunks are copies of the data produced by the upstream stage,
+  because a chunk only points into the upstream filter's buffer that is
+  valid until the next call to it. Chunks that carry a buffer handle
+  (see ChunkBuf.h) are queued by reference without copying.
+
+  Ordering
+  ========
+  All chunks (data, empty format-change chunks and eos-chunks) pass each
+  queue in order, so format changes and flushing propagate exactly as in a
+  serial chain. ns_flush/ns_rebuild states are handled by each stage's own
+  FilterGraph. After an eos-chunk is given to process() the chain reports
+  non-empty state until the flushed data leaves the last stage, i.e. the
+  usual "process(eos); while (!isEmpty()) getChunk()" loop drains the chain
+  completely (getChunk() blocks until the next output chunk is ready).
+
+  Output queue is not bounded: the caller drains it after each process()
+  call and a bounded output would deadlock the caller blocked on the full
+  input queue.
+
+  reset(), setInput() and any chain modification stop the workers. Workers
+  are (re)started by the next process() call.
+*/
+
+#include <deque>
+#include <vector>
+#include <AudioFilter/Buffer.h>
+#include "FilterGraph.h"
+#include "Thread.h"
+
+namespace AudioFilter {
+
+class PipelineChain : public Filter
+{
+public:
+  PipelineChain(size_t _queue_depth = 4);
+  virtual ~PipelineChain();
+
+  /////////////////////////////////////////////////////////
+  // PipelineChain interface
+  //
+  // addFront(), addBack()
+  //   Add a filter at the front/back of the chain. The filter starts a new
+  //   stage (gets its own worker) unless _same_stage is set. In this case it
+  //   joins the first/last stage.
+  //
+  // setQueueDepth()
+  //   Max number of chunks queued between two stages.
+
+  bool addFront(Filter *_filter, const char *_desc, bool _same_stage = false);
+  bool addBack(Filter *_filter, const char *_desc, bool _same_stage = false);
+  void drop(void);
+
+  void setQueueDepth(size_t _queue_depth);
+
+  size_t getQueueDepth(void) const
+  {
+    return queue_depth;
+  }
+
+  int getStageCount(void) const
+  {
+    return nstages;
+  }
+
+  size_t chainText(char *buf, size_t buf_size) const;
+
+  /////////////////////////////////////////////////////////
+  // Filter interface
+
+  virtual void reset(void);
+
+  virtual bool isOfdd(void) const;
+  virtual bool queryInput(Speakers spk) const;
+  virtual bool setInput(Speakers spk);
+  virtual Speakers getInput(void) const;
+
+  virtual bool process(const Chunk *chunk);
+  virtual Speakers getOutput(void) const;
+  virtual bool isEmpty(void) const;
+  virtual bool getChunk(Chunk *chunk);
+
+  // Sum of the stage latencies. Chunks queued between the
+  // stages add up to queue_depth chunks of delay per stage
+  // that is not counted here. Latency mode is applied to
+  // the stages when workers start.
+  virtual vtime_t getLatency(void) const;
+  virtual bool setLowLatency(bool _low_latency);
+  virtual bool getLowLatency(void) const;
+
+protected:
+  /////////////////////////////////////////////////////////
+  // Queued chunk with its own copy of the data
+
+  struct Slot
+  {
+    Chunk     chunk;
+    UInt8Buf  rawdata;
+    SampleBuf samples;
+  };
+
+  /////////////////////////////////////////////////////////
+  // Chunk queue
+  //
+  // data     - queued slots
+  // pool     - free slots
+  // current  - slot held by the consumer (its chunk is in use)
+  // capacity - max number of queued slots (0 - unbounded)
+
+  struct Queue
+  {
+    std::deque<Slot *>  data;
+    std::vector<Slot *> pool;
+    Slot  *current;
+    size_t capacity;
+
+    Queue(): current(0), capacity(0) {}
+  };
+
+  /////////////////////////////////////////////////////////
+  // Stage worker
+
+  class Stage : public Thread
+  {
+  public:
+    Stage(PipelineChain *_pipeline, int _index)
+      : pipeline(_pipeline), index(_index)
+    {}
+
+    FilterChain chain;
+    PipelineChain *pipeline;
+    int index;
+
+  protected:
+    virtual int process(void)
+    {
+      pipeline->runStage(index);
+      return 0;
+    }
+  };
+
+  /////////////////////////////////////////////////////////
+  // Pipeline state (guarded by lock)
+  //
+  // queue[i]       - input queue of stage i
+  // queue[nstages] - output queue
+  // inflight       - chunks queued for or being processed by workers
+  // pending_eos    - eos-chunks given to process() and not received yet
+
+  mutable CritSec lock;
+  Condition cond;
+
+  bool running;
+  bool low_latency;
+  bool cancelled;
+  bool failed;
+  int  inflight;
+  int  pending_eos;
+
+  Speakers in_spk;
+  Speakers out_spk;
+
+  size_t queue_depth;
+  int    nstages;
+  Stage *stage[graph_nodes];
+  Queue  queue[graph_nodes + 1];
+
+  bool start(void);
+  void stop(void);
+  void clearQueues(void);
+  void updateCapacity(void);
+
+  bool push(int q, const Chunk *chunk);
+  bool pop(int q, Chunk *chunk);
+  void runStage(int index);
+
+  static void recycle(Queue &q, Slot *slot);
+  static void copyChunk(Slot *slot, const Chunk *chunk);
+};
+
+}; // namespace AudioFilter
+
+#endif
+
+// vim: ts=2 sts=2 et
@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <cstring>
+#include "ReadAhead.h"
+
+namespace {
+
+const size_t block_align(4096);
+
+int seek_file(FILE *f, AudioFilter::AutoFile::fsize_t pos)
+{
+#if defined(_MSC_VER) && (_MSC_VER >= 1400)
+  return _fseeki64(f, pos, SEEK_SET);
+#elif defined(__GNUC__)
+  return ::fseeko64(f, pos, SEEK_SET);
+#else
+  return ::fseek(f, (long)pos, SEEK_SET);
+#endif
+}
+
+}; // anonymous namespace
+
+namespace AudioFilter {
+
+ReadAhead::ReadAhead(FILE *_f, fsize_t _pos, size_t _depth, size_t _block_size)
+  : f(_f)
+  , depth(_depth ? _depth : 1)
+  , block_size(_block_size)
+  , head(0)
+  , count(0)
+  , offset(0)
+  , allowed(1)
+  , next_pos(_pos)
+  , cur_pos(_pos)
+  , at_eof(false)
+  , gen(0)
+{
+}
+
+ReadAhead::~ReadAhead()
+{
+  terminate();
+}
+
+bool ReadAhead::create(void)
+{
+  buf.setAlignment(block_align);
+
+  if ( ! block_size || ! buf.allocate(depth * block_size) || ! filled.allocate(depth) )
+    return false;
+
+  return Thread::create();
+}
+
+void ReadAhead::terminate(void)
+{
+  lock.lock();
+  f_terminate = true;
+  reader_cond.signal();
+  lock.unlock();
+
+  join();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Consumer
+
+// Wait for data at the consumer position, freeing the blocks consumed.
+// Returns false at the end of the file. The lock must be held.
+
+bool ReadAhead::wait(void)
+{
+  for ( ; ; )
+  {
+    if ( count && offset < filled[head] )
+      return true;
+
+    if ( count )
+    {
+      head = (head + 1) % depth;
+      --count;
+      offset = 0;
+      allowed = std::min(allowed * 2, depth);
+      reader_cond.signal();
+      continue;
+    }
+
+    if ( at_eof )
+      return false;
+
+    consumer_cond.wait(&lock);
+  }
+}
+
+size_t ReadAhead::read(void *data, size_t size)
+{
+  AutoLock auto_lock(&lock);
+  size_t done(0);
+
+  while ( done < size && wait() )
+  {
+    const size_t n(std::min(size - done, filled[head] - offset));
+
+    memcpy((uint8_t *)data + done, buf + head * block_size + offset, n);
+    offset += n;
+    cur_pos += n;
+    done += n;
+  }
+
+  return done;
+}
+
+uint8_t *ReadAhead::readDirect(size_t &size)
+{
+  AutoLock auto_lock(&lock);
+
+  if ( ! wait() )
+  {
+    size = 0;
+    return 0;
+  }
+
+  size = std::min(size, filled[head] - offset);
+
+  uint8_t *data(buf + head * block_size + offset);
+  offset += size;
+  cur_pos += size;
+  return data;
+}
+
+void ReadAhead::seek(fsize_t pos)
+{
+  AutoLock auto_lock(&lock);
+
+  ++gen;
+  head = 0;
+  count = 0;
+  offset = 0;
+  allowed = 1;
+  next_pos = pos;
+  cur_pos = pos;
+  at_eof = false;
+
+  reader_cond.signal();
+}
+
+ReadAhead::fsize_t ReadAhead::pos(void) const
+{
+  AutoLock auto_lock(&lock);
+  return cur_pos;
+}
+
+bool ReadAhead::eof(void) const
+{
+  AutoLock auto_lock(&lock);
+  return at_eof && cur_pos >= next_pos;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Reader thread
+//
+// The block is read without the lock held. A seek during the read changes
+// the generation and the data read is dropped.
+
+int ReadAhead::process(void)
+{
+  fsize_t file_pos(-1);
+  AutoLock auto_lock(&lock);
+
+  while ( ! f_terminate )
+  {
+    if ( at_eof || count >= allowed )
+    {
+      reader_cond.wait(&lock);
+      continue;
+    }
+
+    const unsigned block_gen(gen);
+    const fsize_t block_pos(next_pos);
+    const size_t block((head + count) % depth);
+
+    lock.unlock();
+
+    size_t size(0);
+
+    if ( file_pos == block_pos || seek_file(f, block_pos) == 0 )
+    {
+      size = fread(buf + block * block_size, 1, block_size, f);
+      file_pos = block_pos + size;
+    }
+    else
+      file_pos = -1;
+
+    lock.lock();
+
+    if ( block_gen != gen )
+      continue;
+
+    filled[block] = size;
+    ++count;
+    next_pos += size;
+    at_eof = size < block_size;
+    consumer_cond.signal();
+  }
+
+  return 0;
+}
+
+}; // namespace AudioFilter
+
+// vim: ts=2 sts=2 et
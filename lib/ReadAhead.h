@@ -0,0 +1,98 @@
+#pragma once
+#ifndef VALIB_READ_AHEAD_H
+#define VALIB_READ_AHEAD_H
+/*
+  ReadAhead - reads a file ahead of the consumer in a background thread.
+
+  The reader thread fills a ring of large aligned blocks with the data
+  following the consumer's position, so read() usually copies data that is
+  already in memory and never waits for the storage:
+
+    ReadAhead ahead(f, pos, depth, block_size);
+    ahead.create();
+    ...
+    ahead.read(buf, size);
+
+  The file handle belongs to the reader thread while ReadAhead exists. The
+  owner must not use it directly (AutoFile routes read(), seek(), pos() and
+  eof() here when prefetching is on).
+
+  Ramp-up
+  =======
+  After a seek the reader reads a single block and the number of blocks
+  read ahead doubles each time the consumer finishes a block, up to the
+  depth given. So sequential reading gets the full depth quickly while
+  random probing (seek, read a little, seek again) does not read megabytes
+  that are never used.
+
+  readDirect()
+  ============
+  Returns a pointer into the current block instead of copying (at most the
+  rest of the block). The data is valid until the next read(),
+  readDirect() or seek() call.
+*/
+
+#include <AudioFilter/AutoFile.h>
+#include <AudioFilter/Buffer.h>
+#include "Thread.h"
+
+namespace AudioFilter {
+
+class ReadAhead : public Thread
+{
+public:
+  typedef AutoFile::fsize_t fsize_t;
+
+  ReadAhead(FILE *f, fsize_t pos, size_t depth, size_t block_size);
+  ~ReadAhead();
+
+  size_t read(void *buf, size_t size);
+  uint8_t *readDirect(size_t &size);
+  void seek(fsize_t pos);
+  fsize_t pos(void) const;
+  bool eof(void) const;
+
+  virtual bool create(void);
+  virtual void terminate(void);
+
+protected:
+  FILE *f;
+  size_t depth;
+  size_t block_size;
+  UInt8Buf buf;            // depth blocks of block_size bytes
+  AutoBuf<size_t> filled;  // data size of each block
+
+  mutable CritSec lock;
+  Condition reader_cond;   // signalled when a block is freed or on seek
+  Condition consumer_cond; // signalled when a block is filled
+
+  // Ring state (guarded by the lock)
+  //
+  // head      - block being consumed
+  // count     - number of blocks filled (including the head)
+  // offset    - consumer offset in the head block
+  // allowed   - number of blocks the reader may fill (ramp-up)
+  // next_pos  - file position of the next block to read
+  // cur_pos   - consumer position
+  // at_eof    - the reader reached the end of the file
+  // gen       - seek generation (data read before a seek is dropped)
+
+  size_t  head;
+  size_t  count;
+  size_t  offset;
+  size_t  allowed;
+  fsize_t next_pos;
+  fsize_t cur_pos;
+  bool    at_eof;
+  unsigned gen;
+
+  bool wait(void);
+
+  virtual int process(void);
+};
+
+}; // namespace AudioFilter
+
+#endif
+
+// vim: ts=2 sts=2 et
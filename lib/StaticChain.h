@@ -0,0 +1,450 @@
+#pragma once
+#ifndef VALIB_STATIC_CHAIN_H
+#define VALIB_STATIC_CHAIN_H
+/*
+  StaticChain - filter chain linked at compile time.
+
+  FilterChain links its filters at runtime and pays a virtual call for each
+  isEmpty(), getOutput(), getChunk() and process() call at each node for each
+  chunk. For a fixed chain the filter types are known at compile time, so the
+  chain may call the filters directly (and the compiler may inline the calls
+  across stages):
+
+    Converter pcm2linear(2048);
+    GainFilter gain(0.5);
+    Converter linear2pcm(2048);
+
+    StaticChain<Converter, GainFilter, Converter> chain(&pcm2linear, &gain, &linear2pcm);
+
+    chain.setInput(spk);
+    chain.transform(&src, &sink);
+
+  StaticChain implements the Filter interface itself, so it may be used
+  anywhere a filter is expected, including a node of FilterChain or a stage of
+  PipelineChain. Up to 8 filters may be chained (use nested chains for more).
+
+  Filter types must be the exact (most derived) types of the filter objects:
+  calls are bound statically, so overrides of a more derived class are not
+  called.
+
+  Format changes and flushing
+  ===========================
+  Data flows exactly as in FilterGraph with a fixed getNext(): a filter is
+  drained before its upstream is asked for more data, and when a chunk of a
+  new format comes to a filter, the filter is re-initialized with the new
+  format before it receives the chunk (so it is re-initialized after it
+  flushed its data according to format change rules). When the output format
+  of a filter is unknown (ofdd filter in transition state), the rest of the
+  chain stays unlinked until the filter produces data with a known format.
+  Since the chain is fixed there is no flushing because of chain changes.
+
+  The input chunk is processed on the following getChunk() calls (as with
+  any filter, chunk data must stay valid until the chain is empty).
+
+  Implementation
+  ==============
+  StaticHead<F> is the first stage, StaticLink<Prefix, F> appends a filter to
+  a chain prefix. StaticChain<F1, ..., F8> builds the stages from its
+  parameters (StaticNone parameters are skipped) and wraps them into the
+  Filter interface.
+
+  Each stage counts format changes of its filter (format_id). A stage
+  re-initializes its filter when a chunk comes in a format different from
+  the filter's input format or after its upstream was re-initialized.
+*/
+
+#include <AudioFilter/Filter.h>
+
+namespace AudioFilter {
+
+///////////////////////////////////////////////////////////////////////////////
+// StaticHead - the first stage of the chain
+
+template <class F>
+class StaticHead
+{
+public:
+  enum { size = 1 };
+  typedef StaticHead<F> Head;
+
+  F *f;
+  unsigned format_id;
+
+  StaticHead(): f(0), format_id(0), has_input(false)
+  {}
+
+  void bind(void **filters)
+  {
+    f = (F *)filters[0];
+  }
+
+  Head &head(void)
+  {
+    return *this;
+  }
+
+  const Head &head(void) const
+  {
+    return *this;
+  }
+
+  void reset(void)
+  {
+    has_input = false;
+    input.setDummy();
+    f->F::reset();
+  }
+
+  bool isOfdd(void) const
+  {
+    return f->F::isOfdd();
+  }
+
+  bool isLinked(void) const
+  {
+    return true;
+  }
+
+  vtime_t getLatency(void) const
+  {
+    return f->F::getLatency();
+  }
+
+  bool setLowLatency(bool low_latency)
+  {
+    return f->F::setLowLatency(low_latency);
+  }
+
+  bool setInput(Speakers spk)
+  {
+    has_input = false;
+    input.setDummy();
+    ++format_id;
+    return f->F::setInput(spk);
+  }
+
+  Speakers getInput(void) const
+  {
+    return f->F::getInput();
+  }
+
+  Speakers getOutput(void) const
+  {
+    return f->F::getOutput();
+  }
+
+  bool isEmpty(void) const
+  {
+    return ! has_input && f->F::isEmpty();
+  }
+
+  void put(const Chunk *chunk)
+  {
+    input = *chunk;
+    has_input = true;
+  }
+
+  /////////////////////////////////////////////////////////
+  // Get the next output chunk of the stage.
+  // 'produced' is cleared when the chain is empty up to
+  // this stage.
+
+  bool pull(Chunk *chunk, bool &produced)
+  {
+    while ( true )
+    {
+      if ( ! f->F::isEmpty() )
+      {
+        produced = true;
+        return f->F::getChunk(chunk);
+      }
+
+      if ( ! has_input )
+      {
+        produced = false;
+        return true;
+      }
+
+      has_input = false;
+
+      if ( ! f->F::process(&input) )
+        return false;
+    }
+  }
+
+protected:
+  bool  has_input;
+  Chunk input;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// StaticLink - filter appended to a chain prefix
+
+template <class Prefix, class F>
+class StaticLink
+{
+public:
+  enum { size = Prefix::size + 1 };
+  typedef typename Prefix::Head Head;
+
+  Prefix prefix;
+  F *f;
+  unsigned format_id;
+
+  StaticLink(): f(0), format_id(0), linked_id(0)
+  {}
+
+  void bind(void **filters)
+  {
+    prefix.bind(filters);
+    f = (F *)filters[Prefix::size];
+  }
+
+  Head &head(void)
+  {
+    return prefix.head();
+  }
+
+  const Head &head(void) const
+  {
+    return prefix.head();
+  }
+
+  void reset(void)
+  {
+    prefix.reset();
+    f->F::reset();
+  }
+
+  bool isOfdd(void) const
+  {
+    return prefix.isOfdd() || f->F::isOfdd();
+  }
+
+  bool isLinked(void) const
+  {
+    return prefix.isLinked() && linked_id == prefix.format_id;
+  }
+
+  vtime_t getLatency(void) const
+  {
+    return prefix.getLatency() + f->F::getLatency();
+  }
+
+  bool setLowLatency(bool low_latency)
+  {
+    // all filters must be switched
+    bool result = prefix.setLowLatency(low_latency);
+    return f->F::setLowLatency(low_latency) && result;
+  }
+
+  bool setInput(Speakers spk)
+  {
+    if ( ! prefix.setInput(spk) )
+      return false;
+
+    spk = prefix.getOutput();
+
+    if ( ! prefix.isLinked() || spk == Speakers::UNKNOWN )
+    {
+      // unlinked until data of a known format comes
+      linked_id = prefix.format_id - 1;
+      f->F::reset();
+      return true;
+    }
+
+    return link(spk);
+  }
+
+  Speakers getInput(void) const
+  {
+    return prefix.getInput();
+  }
+
+  Speakers getOutput(void) const
+  {
+    return f->F::getOutput();
+  }
+
+  bool isEmpty(void) const
+  {
+    return prefix.isEmpty() && f->F::isEmpty();
+  }
+
+  bool pull(Chunk *chunk, bool &produced)
+  {
+    Chunk in;
+
+    while ( true )
+    {
+      if ( ! f->F::isEmpty() )
+      {
+        produced = true;
+        return f->F::getChunk(chunk);
+      }
+
+      if ( ! prefix.pull(&in, produced) )
+        return false;
+
+      if ( ! produced )
+        return true;
+
+      if ( ! in.isDummy() )
+        if ( linked_id != prefix.format_id || in.spk != f->F::getInput() )
+          if ( ! link(in.spk) )
+            return false;
+
+      if ( ! f->F::process(&in) )
+        return false;
+    }
+  }
+
+protected:
+  unsigned linked_id; // prefix format_id the filter was initialized with
+
+  bool link(Speakers spk)
+  {
+    ++format_id;
+    linked_id = prefix.format_id;
+    return f->F::setInput(spk);
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// StaticChain
+
+struct StaticNone {};
+
+template <class Prefix, class F>
+struct StaticAppend
+{
+  typedef StaticLink<Prefix, F> type;
+};
+
+template <class Prefix>
+struct StaticAppend<Prefix, StaticNone>
+{
+  typedef Prefix type;
+};
+
+template <class F1, class F2 = StaticNone, class F3 = StaticNone, class F4 = StaticNone,
+          class F5 = StaticNone, class F6 = StaticNone, class F7 = StaticNone, class F8 = StaticNone>
+class StaticChain : public Filter
+{
+public:
+  typedef StaticHead<F1> S1;
+  typedef typename StaticAppend<S1, F2>::type S2;
+  typedef typename StaticAppend<S2, F3>::type S3;
+  typedef typename StaticAppend<S3, F4>::type S4;
+  typedef typename StaticAppend<S4, F5>::type S5;
+  typedef typename StaticAppend<S5, F6>::type S6;
+  typedef typename StaticAppend<S6, F7>::type S7;
+  typedef typename StaticAppend<S7, F8>::type Stages;
+
+  StaticChain(F1 *f1, F2 *f2 = 0, F3 *f3 = 0, F4 *f4 = 0,
+              F5 *f5 = 0, F6 *f6 = 0, F7 *f7 = 0, F8 *f8 = 0)
+  {
+    void *filters[8] = { f1, f2, f3, f4, f5, f6, f7, f8 };
+    stages.bind(filters);
+    low_latency = false;
+  }
+
+  int getSize(void) const
+  {
+    return Stages::size;
+  }
+
+  /////////////////////////////////////////////////////////
+  // Filter interface
+
+  virtual void reset(void)
+  {
+    stages.reset();
+  }
+
+  virtual bool isOfdd(void) const
+  {
+    return stages.isOfdd();
+  }
+
+  virtual bool queryInput(Speakers spk) const
+  {
+    return stages.head().f->F1::queryInput(spk);
+  }
+
+  virtual bool setInput(Speakers spk)
+  {
+    if ( ! queryInput(spk) )
+      return false;
+
+    return stages.setInput(spk);
+  }
+
+  virtual Speakers getInput(void) const
+  {
+    return stages.getInput();
+  }
+
+  virtual bool process(const Chunk *chunk)
+  {
+    if ( chunk->isDummy() )
+      return true;
+
+    if ( chunk->spk != stages.getInput() )
+      if ( ! setInput(chunk->spk) )
+        return false;
+
+    stages.head().put(chunk);
+    return true;
+  }
+
+  virtual Speakers getOutput(void) const
+  {
+    return stages.isLinked()? stages.getOutput(): Speakers::UNKNOWN;
+  }
+
+  virtual bool isEmpty(void) const
+  {
+    return stages.isEmpty();
+  }
+
+  virtual vtime_t getLatency(void) const
+  {
+    return stages.getLatency();
+  }
+
+  // returns false if some filter does not support the mode
+  virtual bool setLowLatency(bool _low_latency)
+  {
+    low_latency = _low_latency;
+    return stages.setLowLatency(low_latency);
+  }
+
+  virtual bool getLowLatency(void) const
+  {
+    return low_latency;
+  }
+
+  virtual bool getChunk(Chunk *chunk)
+  {
+    bool produced;
+
+    if ( ! stages.pull(chunk, produced) )
+      return false;
+
+    if ( ! produced )
+      chunk->setDummy();
+
+    return true;
+  }
+
+protected:
+  Stages stages;
+  bool low_latency;
+};
+
+}; // namespace AudioFilter
+
+#endif
+
+// vim: ts=2 sts=2 et
@@ -1,6 +1,30 @@
 #include <memory.h>
 #include <AudioFilter/SyncScan.h>
 
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#define SYNCSCAN_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define ctz32(x) __builtin_ctz(x)
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+static inline int ctz32(unsigned long x)
+{
+  unsigned long i;
+  _BitScanForward(&i, x);
+  return (int)i;
+}
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 // Syncronization table for MPA/AC3/DTS
 // 0x01  MPA syncword 1: 0xff 0xfn
@@ -14,11 +38,187 @@
 
 namespace AudioFilter {
 
+///////////////////////////////////////////////////////////////////////////////
+// Vector scanners
+//
+// Find the first position in [pos, last] where a syncpoint starts, return
+// last + 1 if not found. Syncword at 'last' must be within the buffer.
+
+namespace {
+
+inline bool isSync(const uint32_t *st, const uint8_t *pos)
+{
+  return (st[pos[0]] & st[pos[1] + 256] & st[pos[2] + 512] & st[pos[3] + 768]) != 0;
+}
+
+uint8_t *findScalar(const uint32_t *st, uint8_t *pos, uint8_t *last)
+{
+  while ( pos <= last && ! isSync(st, pos) )
+    ++pos;
+
+  return pos;
+}
+
+#ifdef SYNCSCAN_X86
+
+TARGET_SSE2
+uint8_t *findSse2(const uint32_t *st, const SyncPrefilter *f, int nf, uint8_t *pos, uint8_t *last)
+{
+  __m128i value[2][SyncPrefilter::max_pairs];
+  __m128i mask[2][SyncPrefilter::max_pairs];
+
+  for ( int i = 0; i < nf; ++i )
+    for ( int j = 0; j < f[i].npairs; ++j )
+    {
+      value[i][j] = _mm_set1_epi8((char)f[i].value[j]);
+      mask[i][j] = _mm_set1_epi8((char)f[i].mask[j]);
+    }
+
+  // all 16 syncwords at the block are within the buffer
+  while ( pos + 15 <= last )
+  {
+    unsigned bits = 0xffff;
+
+    for ( int i = 0; i < nf && bits; ++i )
+    {
+      const __m128i v = _mm_loadu_si128((const __m128i *)(pos + f[i].pos));
+      __m128i m = _mm_setzero_si128();
+
+      for ( int j = 0; j < f[i].npairs; ++j )
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(_mm_and_si128(v, mask[i][j]), value[i][j]));
+
+      bits &= (unsigned)_mm_movemask_epi8(m);
+    }
+
+    while ( bits )
+    {
+      uint8_t *sync_pos = pos + ctz32(bits);
+
+      if ( isSync(st, sync_pos) )
+        return sync_pos;
+
+      bits &= bits - 1;
+    }
+
+    pos += 16;
+  }
+
+  return findScalar(st, pos, last);
+}
+
+TARGET_AVX2
+uint8_t *findAvx2(const uint32_t *st, const SyncPrefilter *f, int nf, uint8_t *pos, uint8_t *last)
+{
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i lo[2], hi[2];
+
+  for ( int i = 0; i < nf; ++i )
+  {
+    lo[i] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)f[i].lo));
+    hi[i] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)f[i].hi));
+  }
+
+  // all 32 syncwords at the block are within the buffer
+  while ( pos + 31 <= last )
+  {
+    unsigned bits = 0xffffffff;
+
+    for ( int i = 0; i < nf && bits; ++i )
+    {
+      const __m256i v = _mm256_loadu_si256((const __m256i *)(pos + f[i].pos));
+      const __m256i c = _mm256_and_si256(
+        _mm256_shuffle_epi8(lo[i], _mm256_and_si256(v, nibble)),
+        _mm256_shuffle_epi8(hi[i], _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+
+      bits &= ~(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, zero));
+    }
+
+    while ( bits )
+    {
+      uint8_t *sync_pos = pos + ctz32(bits);
+
+      if ( isSync(st, sync_pos) )
+        return sync_pos;
+
+      bits &= bits - 1;
+    }
+
+    pos += 32;
+  }
+
+  return findScalar(st, pos, last);
+}
+
+int detectImpl(void)
+{
+#if defined(__GNUC__)
+  __builtin_cpu_init();
+
+  if ( __builtin_cpu_supports("avx2") )
+    return SyncScan::impl_avx2;
+
+  if ( __builtin_cpu_supports("sse2") )
+    return SyncScan::impl_sse2;
+#elif defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  const int nids = info[0];
+
+  __cpuid(info, 1);
+  const bool sse2 = (info[3] & (1 << 26)) != 0;
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  const bool avx = (info[2] & (1 << 28)) != 0;
+
+#if _MSC_VER >= 1700
+  if ( nids >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6 )
+  {
+    __cpuidex(info, 7, 0);
+    if ( info[1] & (1 << 5) )
+      return SyncScan::impl_avx2;
+  }
+#endif
+
+  if ( sse2 )
+    return SyncScan::impl_sse2;
+#endif
+
+  return SyncScan::impl_scalar;
+}
+
+#else
+
+int detectImpl(void)
+{
+  return SyncScan::impl_scalar;
+}
+
+#endif
+
+int bestImpl(void)
+{
+  // the race is harmless: all threads detect the same
+  static int best = -1;
+
+  if ( best < 0 )
+    best = detectImpl();
+
+  return best;
+}
+
+}; // anonymous namespace
+
+///////////////////////////////////////////////////////////////////////////////
+// SyncScan
+///////////////////////////////////////////////////////////////////////////////
+
 SyncScan::SyncScan(uint32_t _syncword, uint32_t _syncmask)
 {
   synctable = new synctbl_t[1024];
   memset(synctable, 0, sizeof(synctbl_t) * 1024);
   count = 0;
+  impl = impl_auto;
+  updateFilter();
 
   if ( _syncword )
     set(1, _syncword, _syncmask);
@@ -84,6 +284,7 @@ bool SyncScan::set(int _index, uint32_t _syncword, uint32_t _syncmask)
       synctable[i + 768] &= ~table_mask;
   }
 
+  updateFilter();
   return true;
 }
 
@@ -146,6 +347,7 @@ bool SyncScan::allow(int _index, uint32_t _syncword, uint32_t _syncmask)
     }
   }
 
+  updateFilter();
   return true;
 }
 
@@ -204,6 +406,7 @@ bool SyncScan::deny(int _index, uint32_t _syncword, uint32_t _syncmask)
       if ((sync_byte & mask_byte) == (i & mask_byte))
         synctable[i + 768] &= ~table_mask;
 
+  updateFilter();
   return true;
 }
 
@@ -233,12 +436,186 @@ bool SyncScan::clear(int _index)
     synctable[i] &= table_mask;
   }
 
+  updateFilter();
   return true;
 }
 
 void SyncScan::clearAll(void)
 {
   memset(synctable, 0, sizeof(synctbl_t) * 1024);
+  updateFilter();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Build the prefilter of the vector scanner
+//
+// The bytes of the syncword with the least number of values allowed (with
+// some syncpoint bit set at the table) are the most selective. Bytes that
+// allow all values are not used.
+//
+// SSE2 prefilter: allowed values are split into aligned power-of-2 blocks,
+// each block is a value/mask pair. Too many pairs make the prefilter slower
+// than the scalar scanner.
+//
+// AVX2 prefilter: high nibbles with the same set of allowed low nibbles
+// form a class. Class bits of the high nibble and of the low nibble must
+// intersect. More than 8 classes are merged into the last one, so the
+// prefilter may pass some values not allowed.
+
+void SyncScan::updateFilter(void)
+{
+  SyncPrefilter f[4];
+  int nvalues[4];
+
+  for ( int k = 0; k < 4; ++k )
+  {
+    const synctbl_t *st = synctable + k * 256;
+
+    f[k].pos = k;
+    f[k].npairs = 0;
+    nvalues[k] = 0;
+
+    // value/mask pairs
+
+    int value = 0;
+    while ( value < 256 )
+    {
+      if ( ! st[value] )
+      {
+        ++value;
+        continue;
+      }
+
+      int len = 1;
+      while ( (value & (len * 2 - 1)) == 0 && value + len * 2 <= 256 )
+      {
+        int i = value + len;
+        while ( i < value + len * 2 && st[i] )
+          ++i;
+
+        if ( i < value + len * 2 )
+          break;
+
+        len *= 2;
+      }
+
+      if ( f[k].npairs < SyncPrefilter::max_pairs )
+      {
+        f[k].value[f[k].npairs] = (uint8_t)value;
+        f[k].mask[f[k].npairs] = (uint8_t)~(len - 1);
+      }
+
+      ++f[k].npairs;
+      nvalues[k] += len;
+      value += len;
+    }
+
+    // nibble classes
+
+    int nclasses = 0;
+    uint16_t classes[8];
+
+    memset(f[k].lo, 0, sizeof(f[k].lo));
+    memset(f[k].hi, 0, sizeof(f[k].hi));
+
+    for ( int h = 0; h < 16; ++h )
+    {
+      uint16_t lo_set = 0;
+      for ( int l = 0; l < 16; ++l )
+        if ( st[h * 16 + l] )
+          lo_set |= 1 << l;
+
+      if ( ! lo_set )
+        continue;
+
+      int c = 0;
+      while ( c < nclasses && classes[c] != lo_set )
+        ++c;
+
+      if ( c == nclasses )
+      {
+        if ( nclasses < 8 )
+          classes[nclasses++] = lo_set;
+        else
+          classes[c = 7] |= lo_set;
+      }
+
+      f[k].hi[h] = (uint8_t)(1 << c);
+    }
+
+    for ( int c = 0; c < nclasses; ++c )
+      for ( int l = 0; l < 16; ++l )
+        if ( classes[c] & (1 << l) )
+          f[k].lo[l] |= (uint8_t)(1 << c);
+  }
+
+  nfilters = 0;
+  npairs = 0;
+
+  for ( int i = 0; i < 2; ++i )
+  {
+    int best = -1;
+
+    for ( int k = 0; k < 4; ++k )
+    {
+      if ( nvalues[k] >= 256 || (nfilters && filter[0].pos == k) )
+        continue;
+
+      if ( best < 0 || nvalues[k] < nvalues[best] )
+        best = k;
+    }
+
+    if ( best < 0 )
+      break;
+
+    filter[nfilters++] = f[best];
+    npairs += f[best].npairs;
+  }
+
+  for ( int i = 0; i < nfilters; ++i )
+    if ( filter[i].npairs > SyncPrefilter::max_pairs )
+      npairs = 0; // no SSE2 prefilter
+}
+
+bool SyncScan::isImplSupported(int _impl)
+{
+  switch ( _impl )
+  {
+    case impl_auto:
+    case impl_scalar:
+      return true;
+
+    case impl_sse2:
+    case impl_avx2:
+      return bestImpl() >= _impl;
+  }
+
+  return false;
+}
+
+bool SyncScan::setImpl(int _impl)
+{
+  if ( ! isImplSupported(_impl) )
+    return false;
+
+  impl = _impl;
+  return true;
+}
+
+int SyncScan::getImpl(void) const
+{
+  if ( ! nfilters )
+    return impl_scalar;
+
+  if ( impl != impl_auto )
+    return (impl == impl_sse2 && ! npairs)? impl_scalar: impl;
+
+  const int best = bestImpl();
+
+  if ( best == impl_sse2 && (! npairs || npairs > SyncPrefilter::auto_pairs) )
+    return impl_scalar;
+
+  return best;
 }
 
 void SyncScan::setStandard(uint32_t _syncmask)
@@ -280,6 +657,12 @@ void SyncScan::setStandard(uint32_t _syncmask)
   if ( _syncmask & SYNCMASK_SPDIF )
     set(SYNC_SPDIF, 0x72f81f4e, 0xffffffff);
 
+  if ( _syncmask & SYNCMASK_DTSHD )
+    set(SYNC_DTSHD, 0x64582025, 0xffffffff);
+
+  if ( _syncmask & SYNCMASK_SPDIF0 )
+    set(SYNC_SPDIF0, 0x00000000, 0xffffffff);
+
   if ( _syncmask & SYNCMASK_PS )
   {
     set(SYNC_PS, 0x000001b8, 0xffffffff);
@@ -305,7 +688,7 @@ uint32_t SyncScan::getSync(void) const
     return 0;
 }
 
-uint32_t SyncScan::getSync(uint8_t *buf) const
+uint32_t SyncScan::getSync(const uint8_t *buf) const
 {
   return synctable[buf[0]] &
          synctable[buf[1] + 256] &
@@ -376,6 +759,25 @@ size_t SyncScan::scan(uint8_t *buf, size_t size)
 
   count = 4;
 
+  ///////////////////////////////////////////////////////
+  // Vector scan: the syncword filled up to 3 bytes acts
+  // as external buffer
+
+  const int vector_impl = getImpl();
+
+  if ( vector_impl != impl_scalar )
+  {
+    uint32_t vector_sync = swab_u32(sync);
+    size_t gone = scanVector((uint8_t *)&vector_sync, pos, end - pos, vector_impl);
+    syncword = vector_sync;
+
+    if ( getSync() )
+      return pos - buf + gone;
+
+    count = 3;
+    return size;
+  }
+
   ///////////////////////////////////////////////////////
   // Process unaligned start
 
@@ -471,6 +873,74 @@ size_t SyncScan::scan(uint8_t *buf, size_t size)
 }
 
 size_t SyncScan::scan(uint8_t *syncbuf, uint8_t *buf, size_t size) const
+{
+  const int vector_impl = getImpl();
+
+  if ( vector_impl != impl_scalar )
+    return scanVector(syncbuf, buf, size, vector_impl);
+
+  return scanScalar(syncbuf, buf, size);
+}
+
+/////////////////////////////////////////////////////////
+// Same as scanScalar() but finds the syncpoint with the
+// vector scanner
+
+size_t SyncScan::scanVector(uint8_t *syncbuf, uint8_t *buf, size_t size, int vector_impl) const
+{
+  if ( ! size )
+    return 0;
+
+  ///////////////////////////////////////////////////////
+  // Syncwords that start at the sync buffer
+
+  uint8_t head[6];
+  const size_t nhead = size < 3? size: 3;
+
+  memcpy(head, syncbuf + 1, 3);
+  memcpy(head + 3, buf, nhead);
+
+  for ( size_t i = 0; i < nhead; ++i )
+  {
+    if ( isSync(synctable, head + i) )
+    {
+      memcpy(syncbuf, head + i, 4);
+      return i + 1;
+    }
+  }
+
+  if ( size < 4 )
+  {
+    memcpy(syncbuf, head + size - 1, 4);
+    return size;
+  }
+
+  ///////////////////////////////////////////////////////
+  // Syncwords that start at the buffer
+
+  uint8_t *last = buf + size - 4;
+  uint8_t *pos;
+
+#ifdef SYNCSCAN_X86
+  if ( vector_impl == impl_avx2 )
+    pos = findAvx2(synctable, filter, nfilters, buf, last);
+  else
+    pos = findSse2(synctable, filter, nfilters, buf, last);
+#else
+  pos = findScalar(synctable, buf, last);
+#endif
+
+  if ( pos <= last )
+  {
+    memcpy(syncbuf, pos, 4);
+    return pos - buf + 4;
+  }
+
+  memcpy(syncbuf, last, 4);
+  return size;
+}
+
+size_t SyncScan::scanScalar(uint8_t *syncbuf, uint8_t *buf, size_t size) const
 {
   uint8_t *pos(buf);
   uint8_t *end(buf + size);
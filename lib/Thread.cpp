@@ -0,0 +1,63 @@
+#include "Thread.h"
+
+namespace AudioFilter {
+
+Thread::Thread()
+  : f_exists(false)
+  , f_terminate(false)
+{
+}
+
+Thread::~Thread()
+{
+  // descendant must stop the thread before its own destruction,
+  // this is the last resort only
+  if ( f_exists )
+    terminate();
+}
+
+void *
+Thread::threadProc(void *param)
+{
+  if ( param )
+  {
+    Thread *thread = (Thread *)param;
+    thread->process();
+  }
+
+  return 0;
+}
+
+bool
+Thread::create(void)
+{
+  if ( f_exists )
+    terminate();
+
+  f_terminate = false;
+  f_exists = pthread_create(&f_thread, 0, threadProc, this) == 0;
+  return f_exists;
+}
+
+void
+Thread::terminate(void)
+{
+  // ask the thread to finish and wait for it
+  // (process() must check terminating() periodically)
+  f_terminate = true;
+  join();
+}
+
+void
+Thread::join(void)
+{
+  if ( ! f_exists )
+    return;
+
+  pthread_join(f_thread, 0);
+  f_exists = false;
+}
+
+}; // namespace AudioFilter
+
+// vim: ts=2 sts=2 et
@@ -0,0 +1,110 @@
+#pragma once
+#ifndef VALIB_THREAD_POSIX_H
+#define VALIB_THREAD_POSIX_H
+
+/*
+  Thread and related classes (POSIX threads)
+  Same interface as win32/thread.h but built on pthreads.
+
+  Thread    - abstract base for thread classes
+  CritSec   - critical section
+  AutoLock  - automatic lock
+  Condition - condition variable bound to a critical section
+*/
+
+#include <pthread.h>
+
+namespace AudioFilter {
+
+class Thread
+{
+private:
+  pthread_t f_thread;
+  bool      f_exists;
+
+  static void *threadProc(void *param);
+
+  // Disallow thread object copy
+  Thread(const Thread &);
+  Thread &operator=(const Thread &);
+
+protected:
+  volatile bool f_terminate;
+  virtual int process(void) = 0;
+
+public:
+  Thread();
+  virtual ~Thread();
+
+  virtual bool create(void);
+  virtual void terminate(void);
+  void join(void);
+
+  bool threadExists(void) const { return f_exists; }
+  bool terminating(void)  const { return f_terminate; }
+};
+
+class CritSec
+{
+protected:
+  // Disallow critical section object copy
+  CritSec(const CritSec &);
+  CritSec &operator=(const CritSec &);
+
+  pthread_mutex_t crit_sec;
+  friend class Condition;
+
+public:
+  CritSec()  { pthread_mutex_init(&crit_sec, 0); }
+  ~CritSec() { pthread_mutex_destroy(&crit_sec); }
+
+  inline void lock(void)   { pthread_mutex_lock(&crit_sec); }
+  inline void unlock(void) { pthread_mutex_unlock(&crit_sec); }
+};
+
+class AutoLock
+{
+protected:
+  // Disallow autolock object copy
+  AutoLock(const AutoLock &);
+  AutoLock &operator=(const AutoLock &);
+
+  CritSec *lock;
+
+public:
+  AutoLock(CritSec *_lock)
+  {
+    lock = _lock;
+    lock->lock();
+  }
+
+  ~AutoLock()
+  {
+    lock->unlock();
+  }
+};
+
+class Condition
+{
+protected:
+  // Disallow condition object copy
+  Condition(const Condition &);
+  Condition &operator=(const Condition &);
+
+  pthread_cond_t cond;
+
+public:
+  Condition()  { pthread_cond_init(&cond, 0); }
+  ~Condition() { pthread_cond_destroy(&cond); }
+
+  // lock must be held by the caller
+  inline void wait(CritSec *_lock) { pthread_cond_wait(&cond, &_lock->crit_sec); }
+  inline void signal(void)         { pthread_cond_signal(&cond); }
+  inline void broadcast(void)      { pthread_cond_broadcast(&cond); }
+};
+
+}; // namespace AudioFilter
+
+#endif
+
+// vim: ts=2 sts=2 et
@@ -56,6 +56,22 @@ vtime_t toUtcTime(vtime_t _time)
   return vtime_t(utc - epoch_adj) / 10000000;
 }
 
+vtime_t getWallClock(void)
+{
+  LARGE_INTEGER freq, counter;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&counter);
+  return vtime_t(counter.QuadPart) / vtime_t(freq.QuadPart);
+}
+
+vtime_t getCpuTime(void)
+{
+  __int64 creation, exit, kernel, user;
+  GetThreadTimes(GetCurrentThread(), (FILETIME*)&creation, (FILETIME*)&exit,
+    (FILETIME*)&kernel, (FILETIME*)&user);
+  return vtime_t(kernel + user) / 10000000; // 10Mhz clock
+}
+
 ///////////////////////////////////////////////////////////
 // Time.h implementation
 
@@ -69,6 +85,20 @@ vtime_t getLocalTime(void)
   return (vtime_t)time(&t);
 }
 
+vtime_t getWallClock(void)
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return vtime_t(ts.tv_sec) + vtime_t(ts.tv_nsec) * 1e-9;
+}
+
+vtime_t getCpuTime(void)
+{
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return vtime_t(ts.tv_sec) + vtime_t(ts.tv_nsec) * 1e-9;
+}
+
 #else
 
 #error "No implementations for time functions"
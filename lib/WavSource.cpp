@@ -95,6 +95,7 @@ bool WavSource::open(const char *_filename, size_t _block_size)
   f.seek(data_start);
   data_remains = data_size;
 
+  f.prefetch();
   return true;
 }
 
@@ -207,6 +208,22 @@ void WavSource::close(void)
   f.close();
 }
 
+bool WavSource::map(void)
+{
+  return f.map();
+}
+
+bool WavSource::prefetch(size_t depth)
+{
+  if ( ! depth )
+  {
+    f.stopPrefetch();
+    return true;
+  }
+
+  return f.prefetch(depth);
+}
+
 bool WavSource::isOpen(void) const
 {
   return f.isOpen();
@@ -258,14 +275,22 @@ bool WavSource::getChunk(Chunk *_chunk)
   if ( data_remains < block_size )
     len = f.castSize(data_remains);
 
-  size_t data_read = f.read(buf, len);
+  // A mapped file gives chunks pointing into the mapping
+
+  uint8_t *data = buf;
+  size_t data_read = len;
+
+  if ( f.isMapped() )
+    data = f.readDirect(data_read);
+  else
+    data_read = f.read(buf, len);
 
   if ( data_read < len ) // eof
     data_remains = 0;
   else
     data_remains -= len;
 
-  _chunk->setRawData(spk, buf, data_read, false, 0, data_remains <= 0);
+  _chunk->setRawData(spk, data, data_read, false, 0, data_remains <= 0);
   return true;
 }
 
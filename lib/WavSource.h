@@ -4,6 +4,13 @@
 
 /*
  * WAV file source
+ *
+ * map() switches the file opened to a memory mapping (see AutoFile), so
+ * chunks point into the mapping and no data is copied.
+ *
+ * Otherwise the file is read ahead in a background thread (see
+ * AutoFile::prefetch()). prefetch() sets the number of blocks read ahead
+ * (0 turns read-ahead off).
  */
 
 #include <AudioFilter/AutoFile.h>
@@ -20,6 +27,8 @@ public:
 
   bool open(const char *filename, size_t block_size);
   void close(void);
+  bool map(void);
+  bool prefetch(size_t depth);
   bool isOpen(void) const;
 
   AutoFile::fsize_t size(void) const;
@@ -31,8 +31,10 @@ Converter::Converter(size_t _nsamples)
   format = FORMAT_UNKNOWN;
   memcpy(order, std_order, sizeof(order));
   nsamples = _nsamples;
+  buf_size = 0;
   out_size = 0;
   part_size = 0;
+  ngains = 0;
 }
 
 convert_t Converter::findConversion(int _format, Speakers _spk) const
@@ -98,7 +100,17 @@ bool Converter::initialize(void)
   /////////////////////////////////////////////////////////
   // allocate buffer
 
-  if ( ! buf.allocate(spk.getChannelCount() * nsamples * getSampleSize(format)) )
+  // linear output channels start at SAMPLE_ALIGN boundary
+  // (pool blocks are aligned) with padded stride
+
+  if ( format == FORMAT_LINEAR )
+    buf_size = spk.getChannelCount() * alignedStride(nsamples) * sizeof(sample_t);
+  else
+    buf_size = spk.getChannelCount() * nsamples * getSampleSize(format);
+
+  buf = ChunkBufPool::getDefault()->allocate(buf_size);
+
+  if ( buf.isNull() )
   {
     convert = 0;
     spk = Speakers::UNKNOWN;
@@ -111,7 +123,7 @@ bool Converter::initialize(void)
     out_samples[0] = (sample_t *)buf.data();
 
     for ( int ch = 1; ch < spk.getChannelCount(); ++ch )
-      out_samples[ch] = out_samples[ch-1] + nsamples;
+      out_samples[ch] = out_samples[ch-1] + alignedStride(nsamples);
 
     out_rawdata = 0;
   }
@@ -125,6 +137,34 @@ bool Converter::initialize(void)
   return true;
 }
 
+bool Converter::unshareBuffer(void)
+{
+  /////////////////////////////////////////////////////////
+  // Output chunks carry the buffer reference. If somebody
+  // downstream still holds it we must not overwrite the
+  // data, so switch to a new block and move the output
+  // pointers (keeping the channel order set).
+
+  if ( buf.isUnique() )
+    return true;
+
+  ChunkBufRef new_buf = ChunkBufPool::getDefault()->allocate(buf_size);
+
+  if ( new_buf.isNull() )
+    return false;
+
+  if ( format == FORMAT_LINEAR )
+  {
+    for ( int ch = 0; ch < spk.getChannelCount(); ++ch )
+      out_samples[ch] = (sample_t *)(new_buf.data() + ((uint8_t *)out_samples[ch] - buf.data()));
+  }
+  else
+    out_rawdata = new_buf.data();
+
+  buf = new_buf;
+  return true;
+}
+
 void Converter::convertPcm2linear(void)
 {
   const size_t sample_size(spk.getSampleSize() * spk.getChannelCount());
@@ -215,12 +255,63 @@ void Converter::convertLinear2pcm(void)
   const size_t sample_size(AudioFilter::getSampleSize(format) * spk.getChannelCount());
   size_t n(MIN(size, nsamples));
 
-  convert(out_rawdata, samples, n);
+  if ( ngains )
+  {
+    // gain and convert block by block
+    uint8_t *dst = out_rawdata;
+    samples_t src = samples;
+
+    for ( size_t i = 0; i < n; i += gain_block )
+    {
+      const size_t block = MIN((size_t)gain_block, n - i);
+
+      applyGains(src, block);
+      convert(dst, src, block);
+
+      dst += block * sample_size;
+      src += block;
+    }
+  }
+  else
+    convert(out_rawdata, samples, n);
 
   dropSamples(n);
   out_size = n * sample_size;
 }
 
+void Converter::applyGains(samples_t _samples, size_t _size) const
+{
+  // gains are applied one after another exactly as
+  // separate gain filters would do
+
+  double g[max_gains];
+  int n = 0;
+
+  for ( int i = 0; i < ngains; ++i )
+  {
+    if ( *gains[i] != 1.0 )
+      g[n++] = *gains[i];
+  }
+
+  if ( ! n )
+    return;
+
+  for ( int ch = 0; ch < spk.getChannelCount(); ++ch )
+  {
+    sample_t *s = _samples[ch];
+
+    for ( size_t i = 0; i < _size; ++i )
+    {
+      sample_t v = s[i];
+
+      for ( int k = 0; k < n; ++k )
+        v *= g[k];
+
+      s[i] = v;
+    }
+  }
+}
+
 ///////////////////////////////////////////////////////////
 // Converter interface
 
@@ -327,11 +418,14 @@ bool Converter::getChunk(Chunk *_chunk)
 
   if ( spk.getFormat() == format )
   {
+    if ( ngains && spk.isLinear() )
+      applyGains(samples, size);
+
     sendChunkInplace(_chunk, size);
     return true;
   }
 
-  if ( ! convert )
+  if ( ! convert || ! unshareBuffer() )
     return false;
 
   if ( format == FORMAT_LINEAR )
@@ -341,6 +435,7 @@ bool Converter::getChunk(Chunk *_chunk)
 
   _chunk->set ( out_spk, out_rawdata, out_samples, out_size
                 , sync, time, flushing && ! size);
+  _chunk->setBuffer(buf);
 
   if ( out_spk.isLinear() )
     _chunk->samples.reorderToStd(spk, order);
@@ -351,6 +446,18 @@ bool Converter::getChunk(Chunk *_chunk)
   return true;
 }
 
+bool Converter::setInputGains(const double *const *_gains, int _ngains)
+{
+  if ( _ngains > max_gains )
+    return false;
+
+  for ( int i = 0; i < _ngains; ++i )
+    gains[i] = _gains[i];
+
+  ngains = _ngains;
+  return true;
+}
+
 }; // namespace AudioFilter
 
 // vim: ts=2 sts=2 et
@@ -16,6 +16,7 @@
 */
 
 #include <AudioFilter/Buffer.h>
+#include <AudioFilter/ChunkBuf.h>
 #include <AudioFilter/Filter.h>
 #include "ConvertFunc.h"
 
@@ -38,7 +39,10 @@ protected:
                            // channel order to convert from when converting to linear format
 
   // converted samples buffer
-  UInt8Buf buf; // buffer for converted data
+  // pooled block, attached to output chunks so downstream may keep
+  // it without copying (see ChunkBuf.h)
+  ChunkBufRef buf; // buffer for converted data
+  size_t buf_size; // buffer size in bytes
   size_t nsamples; // buffer size in samples
 
   // output data pointers
@@ -46,14 +50,23 @@ protected:
   samples_t out_samples;   // buffer pointers for linear data
   size_t    out_size;      // buffer size in bytes/samples for pcm/linear data
 
+  // gains of fused upstream filters (see FilterGraph::setFusion())
+  // applied to the input in blocks of gain_block samples right before
+  // the conversion, so the data is converted while it is in cache
+  enum { max_gains = 8, gain_block = 256 };
+  const double *gains[max_gains];
+  int ngains;
+
   // part of sample from previous call
   uint8_t   part_buf[48];  // partial sample left from previous call
   size_t    part_size;     // partial sample size in bytes
 
   convert_t findConversion(int _format, Speakers _spk) const;
   bool initialize(void);       // initialize convertor
+  bool unshareBuffer(void);    // get a new block if downstream holds current one
   void convertPcm2linear(void);
   void convertLinear2pcm(void);
+  void applyGains(samples_t _samples, size_t _size) const;
 
 public:
   Converter(size_t _nsamples);
@@ -82,6 +95,8 @@ public:
 
   virtual Speakers getOutput(void) const;
   virtual bool getChunk(Chunk *out);
+
+  virtual bool setInputGains(const double *const *_gains, int _ngains);
 };
 
 }; // namespace AudioFilter
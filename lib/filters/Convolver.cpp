@@ -30,6 +30,7 @@ Convolver::Convolver(const FIRGen *gen_):
   gen(gen_), fir(0),
   buf_size(0), n(0), c(0),
   pos(0), pre_samples(0), post_samples(0),
+  low_latency(false),
   state(state_pass)
 {
   ver = gen.getVersion();
@@ -135,15 +136,17 @@ bool Convolver::init(Speakers in_spk_, Speakers &out_spk_)
 
   buf_size = n;
 
-  if ( buf_size < min_chunk_size )
+  if ( buf_size < min_chunk_size && ! low_latency )
     buf_size = clp2(min_chunk_size);
 
   /////////////////////////////////////////////////////////
   // Allocate buffers
 
   fft.setLength(n * 2);
+  filter.setAlignment(SAMPLE_ALIGN);
   filter.allocate(n * 2);
-  buf.allocate(nch, buf_size + n);
+  buf.allocateAligned(nch, buf_size + n);
+  fft_buf.setAlignment(SAMPLE_ALIGN);
   fft_buf.allocate(n * 2);
 
   // handle buffer allocation error
@@ -326,5 +329,61 @@ Convolver::needFlushing(void) const
   return state == state_filter && post_samples > 0;
 }
 
+bool
+Convolver::getBlockSize(BlockSize &_block_size) const
+{
+  // convolution is done by blocks of buf_size samples,
+  // so the block-sized input gives the same work per call
+  if ( state != state_filter )
+    return false;
+
+  _block_size.multiple = buf_size;
+  _block_size.required = false;
+  _block_size.max_latency = 0;
+  return true;
+}
+
+vtime_t
+Convolver::getLatency(void) const
+{
+  // timestamps are aligned with input (centre delay is
+  // compensated), but a sample leaves the filter only
+  // after c more samples are received and it is sent by
+  // whole blocks: worst case is buf_size + c - 1 samples
+  if ( state != state_filter || ! getInSpk().getSampleRate() )
+    return 0;
+
+  return vtime_t(buf_size + c - 1) / getInSpk().getSampleRate();
+}
+
+bool
+Convolver::setLowLatency(bool _low_latency)
+{
+  if ( low_latency != _low_latency )
+  {
+    low_latency = _low_latency;
+    reinit(false);
+  }
+
+  return true;
+}
+
+bool
+Convolver::getLowLatency(void) const
+{
+  return low_latency;
+}
+
+bool
+Convolver::isIdentity(void) const
+{
+  // unit gain is identity too
+  if ( firChanged() )
+    return false;
+
+  return state == state_pass
+    || (state == state_gain && fir->data[0] == 1.0);
+}
+
 }; // namespace AudioFilter
 
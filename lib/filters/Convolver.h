@@ -52,6 +52,15 @@ public:
 
   virtual bool needFlushing(void) const;
 
+  virtual bool isIdentity(void) const;
+  virtual bool getBlockSize(BlockSize &_block_size) const;
+
+  // low latency mode uses FFT-sized blocks instead of
+  // min_chunk_size blocks (more FFT calls per sample)
+  virtual vtime_t getLatency(void) const;
+  virtual bool setLowLatency(bool _low_latency);
+  virtual bool getLowLatency(void) const;
+
 protected:
   int ver;
   FIRRef gen;
@@ -70,6 +79,8 @@ protected:
   int pre_samples;
   int post_samples;
 
+  bool low_latency;
+
   bool firChanged(void) const;
   void uninit(void);
   void convolve(void);
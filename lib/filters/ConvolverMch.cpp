@@ -30,6 +30,7 @@ ConvolverMch::ConvolverMch()
   : buf_size(0), n(0), c(0)
   , pos(0), pre_samples(0)
   , post_samples(0)
+  , low_latency(false)
 {
   for ( int ch_name = 0; ch_name < NCHANNELS; ++ch_name )
     ver[ch_name] = gen[ch_name].getVersion();
@@ -230,12 +231,13 @@ bool ConvolverMch::init(Speakers new_in_spk, Speakers &new_out_spk)
 
   buf_size = n;
 
-  if ( buf_size < min_chunk_size )
+  if ( buf_size < min_chunk_size && ! low_latency )
     buf_size = clp2(min_chunk_size);
 
   fft.setLength(n * 2);
-  filter.allocate(nch, n * 2);
-  buf.allocate(nch, buf_size + n);
+  filter.allocateAligned(nch, n * 2);
+  buf.allocateAligned(nch, buf_size + n);
+  fft_buf.setAlignment(SAMPLE_ALIGN);
   fft_buf.allocate(n * 2);
 
   // handle buffer allocation error
@@ -418,5 +420,62 @@ bool ConvolverMch::needFlushing(void) const
   return ! trivial && post_samples > 0;
 }
 
+bool ConvolverMch::getBlockSize(BlockSize &_block_size) const
+{
+  // convolution is done by blocks of buf_size samples
+  if ( trivial )
+    return false;
+
+  _block_size.multiple = buf_size;
+  _block_size.required = false;
+  _block_size.max_latency = 0;
+  return true;
+}
+
+vtime_t ConvolverMch::getLatency(void) const
+{
+  // timestamps are aligned with input (centre delay is
+  // compensated), but a sample leaves the filter only
+  // after c more samples are received and it is sent by
+  // whole blocks: worst case is buf_size + c - 1 samples
+  if ( trivial || ! getInSpk().getSampleRate() )
+    return 0;
+
+  return vtime_t(buf_size + c - 1) / getInSpk().getSampleRate();
+}
+
+bool ConvolverMch::setLowLatency(bool _low_latency)
+{
+  if ( low_latency != _low_latency )
+  {
+    low_latency = _low_latency;
+    reinit(false);
+  }
+
+  return true;
+}
+
+bool ConvolverMch::getLowLatency(void) const
+{
+  return low_latency;
+}
+
+bool ConvolverMch::isIdentity(void) const
+{
+  if ( ! trivial || firChanged() )
+    return false;
+
+  for ( int ch = 0; ch < getInSpk().getChannelCount(); ++ch )
+  {
+    if ( type[ch] == type_zero )
+      return false;
+
+    if ( type[ch] == type_gain && fir[ch]->data[0] != 1.0 )
+      return false;
+  }
+
+  return true;
+}
+
 }; // namespace AudioFilter
 
@@ -41,6 +41,7 @@ void LinearFilter::reset(void)
 
   samples.zero();
   size = 0;
+  in_buf.release();
   out_samples.zero();
   out_size = 0;
   buffered_samples = 0;
@@ -97,6 +98,7 @@ bool LinearFilter::process(const Chunk *chunk)
     sync_helper.receiveSync(chunk, buffered_samples);
     samples = chunk->samples;
     size = chunk->size;
+    in_buf = chunk->buf;
 
     if ( chunk->eos )
       flushing |= FLUSH_EOS;
@@ -130,6 +132,11 @@ bool LinearFilter::getChunk(Chunk *chunk)
   if ( out_size )
   {
     chunk->setLinear(out_spk, out_samples, out_size);
+
+    // in-place processing: output refers to the input block
+    if ( in_buf.contains(out_samples[0], out_size * sizeof(sample_t)) )
+      chunk->setBuffer(in_buf);
+
     sync_helper.sendSync(chunk, 1.0 / in_spk.getSampleRate());
     sync_helper.drop(out_size);
     out_size = 0;
@@ -0,0 +1,126 @@
+#include <cstring>
+#include "Rechunker.h"
+
+namespace AudioFilter {
+
+Rechunker::Rechunker(size_t _multiple)
+  : multiple(_multiple)
+  , buf_size(0)
+{
+}
+
+///////////////////////////////////////////////////////////
+// Rechunker interface
+
+size_t Rechunker::getMultiple(void) const
+{
+  return multiple;
+}
+
+bool Rechunker::setMultiple(size_t _multiple)
+{
+  if ( multiple == _multiple )
+    return true;
+
+  multiple = _multiple;
+
+  if ( getInSpk().isUnknown() )
+    return true;
+
+  // buffered data is lost, so set the multiple before
+  // processing or at the stream boundary
+  return setInput(getInSpk());
+}
+
+///////////////////////////////////////////////////////////
+// LinearFilter interface
+
+bool Rechunker::init(Speakers spk, Speakers &out_spk)
+{
+  out_spk = spk;
+  buf_size = 0;
+
+  if ( multiple > 1 )
+  {
+    buf.allocateAligned(spk.getChannelCount(), multiple);
+    return buf.isAllocated();
+  }
+
+  buf.free();
+  return true;
+}
+
+void Rechunker::resetState(void)
+{
+  buf_size = 0;
+}
+
+bool Rechunker::processSamples(samples_t in, size_t in_size
+  , samples_t &out, size_t &out_size, size_t &gone)
+{
+  const int nch(getInSpk().getChannelCount());
+
+  if ( multiple <= 1 )
+  {
+    out = in;
+    out_size = in_size;
+    gone = in_size;
+    return true;
+  }
+
+  /////////////////////////////////////////////////////////
+  // Whole block in the input: send in-place
+
+  if ( buf_size == 0 && in_size >= multiple )
+  {
+    out = in;
+    out_size = multiple;
+    gone = multiple;
+    return true;
+  }
+
+  /////////////////////////////////////////////////////////
+  // Gather a block
+
+  gone = MIN(in_size, multiple - buf_size);
+
+  for ( int ch = 0; ch < nch; ++ch )
+    memcpy(buf[ch] + buf_size, in[ch], gone * sizeof(sample_t));
+
+  buf_size += gone;
+  out_size = 0;
+
+  if ( buf_size == multiple )
+  {
+    out = buf;
+    out_size = multiple;
+    buf_size = 0;
+  }
+
+  return true;
+}
+
+bool Rechunker::flush(samples_t &out, size_t &out_size)
+{
+  out = buf;
+  out_size = buf_size;
+  buf_size = 0;
+  return true;
+}
+
+bool Rechunker::needFlushing(void) const
+{
+  return buf_size > 0;
+}
+
+vtime_t Rechunker::getLatency(void) const
+{
+  if ( multiple <= 1 || ! getInSpk().getSampleRate() )
+    return 0;
+
+  return vtime_t(multiple - 1) / getInSpk().getSampleRate();
+}
+
+}; // namespace AudioFilter
+
+// vim: ts=2 sts=2 et
@@ -0,0 +1,62 @@
+#pragma once
+#ifndef VALIB_RECHUNKER_H
+#define VALIB_RECHUNKER_H
+/*
+  Rechunker - gathers or splits linear data into blocks of fixed size.
+
+  Input formats:   Linear
+  Ouptupt formats: Linear
+  Format conversions: none
+  Buffer: only to gather short chunks
+  Delay: up to multiple - 1 samples
+  Timing: Preserve original
+
+  Output chunks are exactly 'multiple' samples long, except the last chunk
+  before the end of the stream (it has the rest of the data). A block that
+  is complete in the input chunk is sent without copying (in-place), only
+  short blocks at input chunk boundaries are gathered in the internal buffer.
+
+  FilterGraph inserts a rechunker in front of a filter that asks for a block
+  size (see Filter::getBlockSize()). Multiple of 0 or 1 passes chunks as is.
+*/
+
+#include <AudioFilter/Buffer.h>
+#include <AudioFilter/LinearFilter.h>
+
+namespace AudioFilter {
+
+class Rechunker : public LinearFilter
+{
+public:
+  Rechunker(size_t _multiple = 0);
+
+  /////////////////////////////////////////////////////////
+  // Rechunker interface
+
+  size_t getMultiple(void) const;
+  bool   setMultiple(size_t _multiple);
+
+  /////////////////////////////////////////////////////////
+  // LinearFilter interface
+
+  virtual bool init(Speakers spk, Speakers &out_spk);
+  virtual void resetState(void);
+
+  virtual bool processSamples(samples_t in, size_t in_size, samples_t &out, size_t &out_size, size_t &gone);
+  virtual bool flush(samples_t &out, size_t &out_size);
+
+  virtual bool needFlushing(void) const;
+
+  virtual vtime_t getLatency(void) const;
+
+protected:
+  size_t    multiple;
+  SampleBuf buf;      // gathered block
+  size_t    buf_size; // samples gathered
+};
+
+}; // namespace AudioFilter
+
+#endif
+
+// vim: ts=2 sts=2 et
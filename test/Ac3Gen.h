@@ -0,0 +1,533 @@
+#pragma once
+#ifndef VALIB_TEST_AC3GEN_H
+#define VALIB_TEST_AC3GEN_H
+/*
+  Ac3Gen - random AC3 frames for tests
+
+  Makes valid 48kHz AC3 frames of a fixed size with random side information
+  (block switch, dither, coupling, rematrixing, exponent strategies, bit
+  allocation and delta bit allocation) and random mantissas. The frame has
+  no meaningful audio, but it exercises all decoder state carried between
+  blocks and frames.
+
+  Side information of a block is checked with Ac3Parser itself: the
+  generator parses the frame written so far to get the bit allocation of
+  the block, so mantissas are written exactly as the decoder reads them.
+  When the block does not fit into its share of the frame, it is made
+  again with a lower SNR offset. CRC is not valid, so the parser must be
+  used with do_crc = false.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <AudioFilter/Parsers.h>
+#include <AudioFilter/Rng.h>
+#include "Ac3Tables.h"
+
+namespace AudioFilter {
+
+///////////////////////////////////////////////////////////////////////////////
+// Bit writer (MSB first)
+
+struct Ac3GenWriter
+{
+  std::vector<uint8_t> buf;
+  size_t pos;
+
+  Ac3GenWriter(size_t size): buf(size, 0), pos(0)
+  {}
+
+  void put(uint32_t value, int bits)
+  {
+    for ( int i = bits - 1; i >= 0; --i, ++pos )
+      if ( (value >> i) & 1 )
+        buf[pos >> 3] |= 0x80 >> (pos & 7);
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Parser that stops after the side information of a block
+
+struct Ac3GenParser : public Ac3Parser
+{
+  bool parseUpTo(uint8_t *frame, size_t size, int _block)
+  {
+    do_crc = false;
+
+    if ( ! startParse(frame, size) || ! parseHeader() )
+      return false;
+
+    for ( int i = 0; i <= _block; ++i )
+    {
+      block = i;
+
+      if ( ! parseBlock() )
+        return false;
+
+      if ( i < _block )
+      {
+        samples_t s(samples);
+        s += i * AC3_BLOCK_SAMPLES;
+        parseCoeff(s);
+      }
+    }
+
+    return true;
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Ac3Gen
+
+class Ac3Gen
+{
+public:
+  Ac3Gen(int seed, int _acmod, bool _lfeon)
+    : rng(seed)
+    , acmod(_acmod)
+    , lfeon(_lfeon)
+    , frmsizecod(36)
+    , frame_size(2560)
+  {}
+
+  std::vector<uint8_t> frame(void);
+
+protected:
+  RNG  rng;
+  int  acmod;
+  bool lfeon;
+  int  frmsizecod;
+  size_t frame_size;
+
+  // State carried between blocks
+  bool cplinu;
+  bool chincpl[5];
+  bool phsflginu;
+  int  cplstrtmant, cplendmant, ncplbnd;
+  int  endmant[5];
+  int  q3, q5, q11;
+
+  int rnd(int n)
+  {
+    return int(rng.getRange(uint32_t(n)));
+  }
+
+  void exps(Ac3GenWriter &w, int absexp, int ngrps);
+  void deltba(Ac3GenWriter &w);
+  void sideInfo(Ac3GenWriter &w, int blk, int csnr);
+  void mant(Ac3GenWriter &w, const int8_t *bap, int start, int end);
+};
+
+inline void
+Ac3Gen::exps(Ac3GenWriter &w, int absexp, int ngrps)
+{
+  for ( int g = 0; g < ngrps; ++g )
+  {
+    int d[3];
+
+    for ( int i = 0; i < 3; ++i )
+    {
+      const int lo = std::max(-2, -absexp);
+      const int hi = std::min(2, 24 - absexp);
+
+      d[i] = rnd(3)? std::max(lo, std::min(hi, 0)): lo + rnd(hi - lo + 1);
+      absexp += d[i];
+    }
+
+    w.put((d[0] + 2) * 25 + (d[1] + 2) * 5 + (d[2] + 2), 7);
+  }
+}
+
+inline void
+Ac3Gen::deltba(Ac3GenWriter &w)
+{
+  const int nseg = rnd(2);
+  w.put(nseg, 3);
+
+  for ( int i = 0; i <= nseg; ++i )
+  {
+    w.put(rnd(10), 5);    // deltoffst
+    w.put(1 + rnd(8), 4); // deltlen
+    w.put(rnd(8), 3);     // deltba
+  }
+}
+
+inline void
+Ac3Gen::sideInfo(Ac3GenWriter &w, int blk, int csnr)
+{
+  const int nfchans = nfchans_tbl[acmod];
+  int ch;
+
+  for ( ch = 0; ch < nfchans; ++ch )
+    w.put(rnd(4) == 0, 1); // blksw
+
+  for ( ch = 0; ch < nfchans; ++ch )
+    w.put(rnd(2), 1); // dithflag
+
+  if ( rnd(2) )
+  {
+    w.put(1, 1); // dynrnge
+    w.put(rnd(256), 8);
+  }
+  else
+    w.put(0, 1);
+
+  /////////////////////////////////////////////////////////
+  // Coupling
+
+  const bool cplstre = blk == 0 || rnd(4) == 0;
+  bool newcpl = false;
+  w.put(cplstre, 1);
+
+  if ( cplstre )
+  {
+    cplinu = acmod >= 2 && rnd(4) != 0;
+    w.put(cplinu, 1);
+
+    if ( cplinu )
+    {
+      newcpl = true;
+
+      for ( ch = 0; ch < nfchans; ++ch )
+      {
+        chincpl[ch] = ch < 2 || rnd(2);
+        w.put(chincpl[ch], 1);
+      }
+
+      if ( acmod == 2 )
+      {
+        phsflginu = rnd(2) != 0;
+        w.put(phsflginu, 1);
+      }
+
+      const int cplbegf = rnd(8);
+      const int cplendf = cplbegf + rnd(16 - cplbegf);
+      w.put(cplbegf, 4);
+      w.put(cplendf, 4);
+
+      cplstrtmant = cplbegf * 12 + 37;
+      cplendmant = cplendf * 12 + 73;
+      ncplbnd = 1;
+
+      for ( int b = 0; b < cplendf - cplbegf + 2; ++b )
+      {
+        const int cplbndstrc = rnd(2);
+        w.put(cplbndstrc, 1);
+
+        if ( ! cplbndstrc )
+          ++ncplbnd;
+      }
+    }
+    else
+      for ( ch = 0; ch < 5; ++ch )
+        chincpl[ch] = false;
+  }
+
+  if ( cplinu )
+  {
+    bool cplcoe = false;
+
+    for ( ch = 0; ch < nfchans; ++ch )
+      if ( chincpl[ch] )
+      {
+        const int e = newcpl || rnd(2);
+        w.put(e, 1);
+
+        if ( e )
+        {
+          cplcoe = true;
+          w.put(rnd(4), 2); // mstrcplco
+
+          for ( int b = 0; b < ncplbnd; ++b )
+          {
+            w.put(rnd(16), 4); // cplcoexp
+            w.put(rnd(16), 4); // cplcomant
+          }
+        }
+      }
+
+    if ( acmod == 2 && phsflginu && cplcoe )
+      for ( int b = 0; b < ncplbnd; ++b )
+        w.put(rnd(2), 1); // phsflg
+  }
+
+  /////////////////////////////////////////////////////////
+  // Rematrixing
+
+  if ( acmod == 2 )
+  {
+    const int rematstr = blk == 0 || newcpl || rnd(2);
+    w.put(rematstr, 1);
+
+    if ( rematstr )
+    {
+      const int endbin = cplinu? cplstrtmant: 253;
+      int bnd = 0;
+
+      do
+        w.put(rnd(2), 1);
+      while ( rematrix_tbl[bnd++] < endbin );
+    }
+  }
+
+  /////////////////////////////////////////////////////////
+  // Exponents
+
+  const bool fresh = blk == 0 || cplstre;
+  int cplexpstr = 0, chexpstr[5], lfeexpstr = 0;
+
+  if ( cplinu )
+  {
+    cplexpstr = fresh? 1 + rnd(3): rnd(4);
+    w.put(cplexpstr, 2);
+  }
+
+  for ( ch = 0; ch < nfchans; ++ch )
+  {
+    chexpstr[ch] = fresh? 1 + rnd(3): rnd(4);
+    w.put(chexpstr[ch], 2);
+  }
+
+  if ( lfeon )
+  {
+    lfeexpstr = blk == 0? 1: rnd(2);
+    w.put(lfeexpstr, 1);
+  }
+
+  for ( ch = 0; ch < nfchans; ++ch )
+    if ( chexpstr[ch] )
+    {
+      if ( chincpl[ch] )
+        endmant[ch] = cplstrtmant;
+      else
+      {
+        const int chbwcod = rnd(61);
+        w.put(chbwcod, 6);
+        endmant[ch] = chbwcod * 3 + 73;
+      }
+    }
+
+  if ( cplinu && cplexpstr )
+  {
+    const int cplabsexp = rnd(13);
+    w.put(cplabsexp, 4);
+    exps(w, cplabsexp * 2, (cplendmant - cplstrtmant) / (3 << (cplexpstr - 1)));
+  }
+
+  for ( ch = 0; ch < nfchans; ++ch )
+    if ( chexpstr[ch] )
+    {
+      int ngrps = 0;
+
+      switch ( chexpstr[ch] )
+      {
+        case 1: ngrps = (endmant[ch] - 1) / 3; break;
+        case 2: ngrps = (endmant[ch] - 1 + 3) / 6; break;
+        case 3: ngrps = (endmant[ch] - 1 + 9) / 12; break;
+      }
+
+      const int absexp = rnd(16);
+      w.put(absexp, 4);
+      exps(w, absexp, ngrps);
+      w.put(rnd(4), 2); // gainrng
+    }
+
+  if ( lfeon && lfeexpstr )
+  {
+    const int absexp = rnd(16);
+    w.put(absexp, 4);
+    exps(w, absexp, 2);
+  }
+
+  /////////////////////////////////////////////////////////
+  // Bit allocation
+
+  const int baie = blk == 0 || rnd(3) == 0;
+  w.put(baie, 1);
+
+  if ( baie )
+  {
+    w.put(rnd(4), 2); // sdcycod
+    w.put(rnd(4), 2); // fdcycod
+    w.put(rnd(4), 2); // sgaincod
+    w.put(rnd(4), 2); // dbpbcod
+    w.put(rnd(7), 3); // floorcod
+  }
+
+  w.put(1, 1); // snroffste
+  w.put(csnr, 6);
+
+  if ( cplinu )
+  {
+    w.put(rnd(16), 4);
+    w.put(rnd(8), 3);
+  }
+
+  for ( ch = 0; ch < nfchans; ++ch )
+  {
+    w.put(rnd(16), 4);
+    w.put(rnd(8), 3);
+  }
+
+  if ( lfeon )
+  {
+    w.put(rnd(16), 4);
+    w.put(rnd(8), 3);
+  }
+
+  if ( cplinu )
+  {
+    const int cplleake = blk == 0 || newcpl || rnd(2);
+    w.put(cplleake, 1);
+
+    if ( cplleake )
+    {
+      w.put(rnd(8), 3);
+      w.put(rnd(8), 3);
+    }
+  }
+
+  const int deltbaie = rnd(3) == 0;
+  w.put(deltbaie, 1);
+
+  if ( deltbaie )
+  {
+    int cpldeltbae = 0, deltbae[5];
+
+    if ( cplinu )
+    {
+      cpldeltbae = 1 + rnd(2);
+      w.put(cpldeltbae, 2);
+    }
+
+    for ( ch = 0; ch < nfchans; ++ch )
+    {
+      deltbae[ch] = 1 + rnd(2);
+      w.put(deltbae[ch], 2);
+    }
+
+    if ( cplinu && cpldeltbae == 1 )
+      deltba(w);
+
+    for ( ch = 0; ch < nfchans; ++ch )
+      if ( deltbae[ch] == 1 )
+        deltba(w);
+  }
+
+  w.put(0, 1); // skiple
+}
+
+inline void
+Ac3Gen::mant(Ac3GenWriter &w, const int8_t *bap, int start, int end)
+{
+  for ( int i = start; i < end; ++i )
+  {
+    switch ( bap[i] )
+    {
+      case 0: break;
+      case 1: if ( q3-- ) break; w.put(rnd(27), 5); q3 = 2; break;
+      case 2: if ( q5-- ) break; w.put(rnd(125), 7); q5 = 2; break;
+      case 3: w.put(rnd(7), 3); break;
+      case 4: if ( q11-- ) break; w.put(rnd(121), 7); q11 = 1; break;
+      case 5: w.put(rnd(15), 4); break;
+      case 14: w.put(rnd(1 << 14), 14); break;
+      case 15: w.put(rnd(1 << 16), 16); break;
+      default: w.put(rnd(1 << (bap[i] - 1)), bap[i] - 1); break;
+    }
+  }
+}
+
+inline std::vector<uint8_t>
+Ac3Gen::frame(void)
+{
+  const int nfchans = nfchans_tbl[acmod];
+  Ac3GenWriter w(frame_size);
+
+  w.put(0x0b77, 16);
+  w.put(rnd(65536), 16); // crc1 (not valid)
+  w.put(0, 2);           // fscod: 48kHz
+  w.put(frmsizecod, 6);
+  w.put(8, 5);           // bsid
+  w.put(0, 3);           // bsmod
+  w.put(acmod, 3);
+
+  if ( (acmod & 1) && acmod != 1 )
+    w.put(rnd(3), 2);    // cmixlev
+
+  if ( acmod & 4 )
+    w.put(rnd(3), 2);    // surmixlev
+
+  if ( acmod == 2 )
+    w.put(rnd(3), 2);    // dsurmod
+
+  w.put(lfeon, 1);
+  w.put(31, 5);          // dialnorm
+  w.put(0, 3);           // compre, langcode, audprodie
+  w.put(1, 2);           // copyrightb, origbs
+  w.put(0, 3);           // timecod1e, timecod2e, addbsie
+
+  const size_t budget = (frame_size - 2) * 8;
+
+  for ( int blk = 0; blk < 6; ++blk )
+  {
+    const Ac3GenWriter start(w);
+    const Ac3Gen state(*this);
+    int csnr = 10 + rnd(30);
+
+    for ( ; ; )
+    {
+      w = start;
+      sideInfo(w, blk, csnr);
+
+      std::vector<uint8_t> tmp(w.buf);
+      Ac3GenParser p;
+
+      if ( p.parseUpTo(&tmp[0], tmp.size(), blk) )
+      {
+        q3 = q5 = q11 = 0;
+        bool cpl_done = false;
+
+        for ( int ch = 0; ch < nfchans; ++ch )
+        {
+          mant(w, p.bap[ch], 0, p.endmant[ch]);
+
+          if ( p.chincpl[ch] && ! cpl_done )
+          {
+            mant(w, p.cplbap, p.cplstrtmant, p.cplendmant);
+            cpl_done = true;
+          }
+        }
+
+        if ( lfeon )
+          mant(w, p.lfebap, 0, 7);
+
+        if ( w.pos <= budget * (blk + 1) / 6 )
+          break;
+      }
+
+      if ( csnr == 0 )
+      {
+        fprintf(stderr, "Ac3Gen: cannot fit block %i\n", blk);
+        abort();
+      }
+
+      // Same block again with a lower SNR offset
+      // (keep the random sequence going)
+
+      const RNG rng_now(rng);
+      *this = state;
+      rng = rng_now;
+      csnr = csnr > 5? csnr - 5: 0;
+    }
+  }
+
+  return w.buf;
+}
+
+}; // namespace AudioFilter
+
+#endif
+
+// vim: ts=2 sts=2 et
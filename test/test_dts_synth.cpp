@@ -0,0 +1,211 @@
+/*
+  DtsSynth test
+
+  DtsSynth must give the output of the direct QMF synthesis of the DTS
+  decoder (qmf_32_subbands() of DtsFrameParser before DtsSynth, kept here
+  as the reference) within the tolerance stated in DtsSynth.h: 1e-12 of the
+  output peak in double precision, 1e-6 in float.
+
+  Random subband samples are synthesized with both filter banks, all
+  implementations supported by the CPU and both precisions. The number of
+  active subbands changes from block to block (0 to 32), and the filter is
+  reset in the middle of the run.
+
+  Exit code is the number of failed checks.
+*/
+
+#include <math.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <AudioFilter/DtsSynth.h>
+#include <AudioFilter/Rng.h>
+#include "DtsTablesFir.h"
+
+using namespace AudioFilter;
+
+static const int nblocks = 200;
+
+///////////////////////////////////////////////////////////////////////////////
+// Direct synthesis filter (reference)
+
+class QmfReference
+{
+public:
+  QmfReference()
+  {
+    int j(0);
+
+    for ( int k = 0; k < 16; ++k )
+      for ( int i = 0; i < 16; ++i )
+        cos_mod[j++] = cos((2*i+1)*(2*k+1)*M_PI/64);
+
+    for ( int k = 0; k < 16; ++k )
+      for ( int i = 0; i < 16; ++i )
+        cos_mod[j++] = cos((i)*(2*k+1)*M_PI/32);
+
+    for ( int k = 0; k < 16; ++k )
+      cos_mod[j++] = 0.25/(2*cos((2*k+1)*M_PI/128));
+
+    for ( int k = 0; k < 16; ++k )
+      cos_mod[j++] = -0.25/(2.0*sin((2*k+1)*M_PI/128));
+
+    reset();
+  }
+
+  void reset(void)
+  {
+    memset(subband_fir, 0, sizeof(subband_fir));
+    memset(subband_fir2, 0, sizeof(subband_fir2));
+  }
+
+  void synth(const double samples_in[32][8], int nbands, bool perfect, sample_t *samples_out, double scale)
+  {
+    const double *prCoeff = perfect? fir_32bands_perfect: fir_32bands_nonperfect;
+    double raXin[32];
+    int i, j, k, m;
+
+    scale = 1.0 / scale;
+
+    for ( int s = 0; s < 8; ++s )
+    {
+      for ( i = 0; i < nbands; ++i )
+        raXin[i] = samples_in[i][s];
+
+      for ( i = nbands; i < 32; ++i )
+        raXin[i] = 0.0;
+
+      sample_t a, b;
+
+      for ( j = 0, k = 0; k < 16; k++, j += 16 )
+      {
+        a = 0;
+        for ( i = 0; i < 16; ++i )
+          a += (raXin[2*i] + raXin[2*i+1]) * cos_mod[j+i];
+
+        b = raXin[0] * cos_mod[256 + j];
+        for ( i = 1; i < 16; ++i )
+          b += (raXin[2*i] + raXin[2*i-1]) * cos_mod[256 + j+i];
+
+        subband_fir[k]      = cos_mod[k + 512] * (a+b);
+        subband_fir[32-k-1] = cos_mod[k + 528] * (a-b);
+      }
+
+      for ( k = 31, i = 0; i < 32; ++i, --k )
+      {
+        a = subband_fir2[i];
+        b = subband_fir2[32+i];
+
+        for ( m = 0; m < 512; m += 64 )
+        {
+          a += prCoeff[i+m] * (subband_fir[i+m] - subband_fir[k+m]);
+          b += prCoeff[32+i+m]*(-subband_fir[i+m] - subband_fir[k+m]);
+        }
+
+        subband_fir2[i] = a;
+        subband_fir2[32+i] = b;
+      }
+
+      for ( i = 0; i < 32; ++i )
+        samples_out[s * 32 + i] = subband_fir2[i] * scale;
+
+      memmove(subband_fir + 32, subband_fir, (512 - 32) * sizeof(double));
+
+      for ( i = 0; i < 32; ++i )
+      {
+        subband_fir2[i] = subband_fir2[i+32];
+        subband_fir2[i+32] = 0.0;
+      }
+    }
+  }
+
+protected:
+  double cos_mod[544];
+  double subband_fir[512];
+  double subband_fir2[64];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+static const char *impl_name[] = { "auto", "scalar", "sse2", "avx" };
+static const char *precision_name[] = { "double", "float" };
+
+static int
+test(const double (*_in)[32][8], bool _perfect, int _impl, int _precision)
+{
+  // Output in float samples cannot be more precise than float
+  const double tolerance = _precision == DtsSynth::prec_float || sizeof(sample_t) < sizeof(double)? 1e-6: 1e-12;
+
+  QmfReference ref;
+  DtsSynth synth;
+  synth.setImpl(_impl);
+  synth.setPrecision(_precision);
+
+  double max_diff = 0;
+  double peak = 0;
+
+  for ( int i = 0; i < nblocks; ++i )
+  {
+    if ( i == nblocks / 2 )
+    {
+      ref.reset();
+      synth.reset();
+    }
+
+    const int nbands = (i * 7) % 33;
+    sample_t ref_out[256];
+    sample_t out[256];
+
+    ref.synth(_in[i], nbands, _perfect, ref_out, 32768.0);
+    synth.synth(_in[i], nbands, _perfect, out, 32768.0);
+
+    for ( int j = 0; j < 256; ++j )
+    {
+      max_diff = std::max(max_diff, fabs(double(out[j]) - double(ref_out[j])));
+      peak = std::max(peak, fabs(double(ref_out[j])));
+    }
+  }
+
+  if ( peak == 0 || max_diff > tolerance * peak )
+  {
+    printf("%s filter, %s, %s: difference %g of the peak %g\n",
+      _perfect? "perfect": "non-perfect", impl_name[_impl], precision_name[_precision], max_diff, peak);
+    return 1;
+  }
+
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  static double in[nblocks][32][8];
+  RNG rng(1);
+
+  // Low subbands are louder, as in real streams
+  for ( int i = 0; i < nblocks; ++i )
+    for ( int band = 0; band < 32; ++band )
+      for ( int s = 0; s < 8; ++s )
+        in[i][band][s] = rng.getSample() * 32768.0 / (1 + band);
+
+  int errors = 0;
+
+  for ( int impl = DtsSynth::impl_auto; impl <= DtsSynth::impl_avx; ++impl )
+  {
+    if ( ! DtsSynth::isImplSupported(impl) )
+    {
+      printf("%s: not supported by the CPU (skipped)\n", impl_name[impl]);
+      continue;
+    }
+
+    for ( int precision = DtsSynth::prec_double; precision <= DtsSynth::prec_float; ++precision )
+    {
+      errors += test(in, false, impl, precision);
+      errors += test(in, true, impl, precision);
+    }
+  }
+
+  printf("DtsSynth: %s\n", errors? "FAILED": "ok");
+  return errors;
+}
+
+// vim: ts=2 sts=2 et
@@ -0,0 +1,322 @@
+/*
+  ParallelDecoder test
+
+  Parallel decode must match a serial decode of the file sample by sample.
+  Test streams are made by Ac3Gen: 3/2+LFE frames with a 2/0 stream in the
+  middle (new streams, IMDCT overlap dropped at the speaker change) and
+  random dither flags (dither restarted at each frame). The stream is also
+  checked with a broken frame, so the workers have to seek further back for
+  the pre-roll. Each case is decoded with different numbers of threads and
+  segment sizes.
+
+  Frame index segments that do not start a new stream (sample rate or
+  sample count change) must not reset the decoder, this is checked on the
+  index directly.
+
+  Workers load frames from a file mapping and read some frames again for
+  the pre-roll, so decoding must not change the mapping. This is checked on
+  a 16bit LE stream (the parser converts such frames in place).
+
+  Exit code is the number of failed checks.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <AudioFilter/FileParser.h>
+#include <AudioFilter/FrameIndex.h>
+#include "ParallelDecoder.h"
+#include "Ac3Gen.h"
+
+using namespace AudioFilter;
+
+static const char test_file[] = "test_parallel_decoder.ac3";
+
+///////////////////////////////////////////////////////////////////////////////
+
+class Ac3Factory : public FrameParserFactory
+{
+public:
+  virtual FrameParser *createParser(void)
+  {
+    Ac3Parser *parser = new Ac3Parser;
+    parser->do_crc = false;
+    return parser;
+  }
+};
+
+// Keeps all samples given and the number of channels of each chunk
+
+class SampleSink : public Sink
+{
+public:
+  Speakers spk;
+  std::vector<sample_t> data;
+  std::vector<int> channels;
+  int eos;
+
+  SampleSink(): eos(0)
+  {}
+
+  virtual bool queryInput(Speakers) const { return true; }
+  virtual bool setInput(Speakers _spk) { spk = _spk; return true; }
+  virtual Speakers getInput() const { return spk; }
+
+  virtual bool process(const Chunk *_chunk)
+  {
+    if ( _chunk->eos )
+      ++eos;
+
+    if ( ! _chunk->size )
+      return true;
+
+    for ( int ch = 0; ch < _chunk->spk.getChannelCount(); ++ch )
+      data.insert(data.end(), _chunk->samples[ch], _chunk->samples[ch] + _chunk->size);
+
+    channels.push_back(_chunk->spk.getChannelCount());
+    return true;
+  }
+
+  bool operator ==(const SampleSink &_other) const
+  {
+    return channels == _other.channels && data.size() == _other.data.size()
+      && (data.empty() || ! memcmp(&data[0], &_other.data[0], data.size() * sizeof(sample_t)));
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void
+writeStream(int _nframes, int _broken_frame, bool _le = false)
+{
+  FILE *f = fopen(test_file, "wb");
+  Ac3Gen gen_32(1, 7, true);
+  Ac3Gen gen_20(2, 2, false);
+
+  for ( int i = 0; i < _nframes; ++i )
+  {
+    const bool stereo = i >= _nframes / 2 && i < _nframes / 2 + _nframes / 5;
+    std::vector<uint8_t> frame = stereo? gen_20.frame(): gen_32.frame();
+
+    if ( i == _broken_frame )
+      frame[40] ^= 0xff;
+
+    if ( _le )
+      for ( size_t j = 0; j + 1 < frame.size(); j += 2 )
+        std::swap(frame[j], frame[j + 1]);
+
+    fwrite(&frame[0], 1, frame.size(), f);
+  }
+
+  fclose(f);
+  remove(FrameIndex::sidecarName(test_file).c_str());
+}
+
+static void
+decodeSerial(SampleSink &_sink)
+{
+  Ac3Parser parser;
+  parser.do_crc = false;
+
+  FileParser file(test_file, parser.getHeaderParser());
+
+  while ( file.loadFrame() )
+  {
+    if ( file.isNewStream() )
+      parser.reset();
+
+    if ( ! parser.parseFrame(file.getFrame(), file.getFrameSize()) )
+      continue;
+
+    Chunk chunk(parser.getSpeakers(), parser.getSamples(), parser.getSampleCount());
+    _sink.process(&chunk);
+  }
+}
+
+static int
+testDecode(int _broken_frame)
+{
+  static const int threads[] = { 1, 2, 3, 8 };
+  static const size_t segment_frames[] = { 1, 2, 7, 64 };
+
+  int errors = 0;
+  writeStream(200, _broken_frame);
+
+  SampleSink serial;
+  decodeSerial(serial);
+
+  for ( size_t t = 0; t < array_size(threads); ++t )
+    for ( size_t s = 0; s < array_size(segment_frames); ++s )
+    {
+      Ac3Factory factory;
+      SampleSink parallel;
+      ParallelDecoder dec(threads[t]);
+      dec.setSegmentFrames(segment_frames[s]);
+
+      const bool ok = dec.decode(test_file, &factory, &parallel);
+
+      if ( ! ok || parallel.eos != 1 || ! (parallel == serial) )
+      {
+        printf("decode (broken frame %i, %i threads, segment %i frames): %s\n",
+          _broken_frame, threads[t], (int)segment_frames[s], ok? "output differs": "failed");
+        ++errors;
+      }
+    }
+
+  remove(test_file);
+  remove(FrameIndex::sidecarName(test_file).c_str());
+  return errors;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static int
+testMapping(void)
+{
+  writeStream(20, -1, true);
+
+  std::vector<uint8_t> data(20 * 4096);
+  FILE *f = fopen(test_file, "rb");
+  data.resize(fread(&data[0], 1, data.size(), f));
+  fclose(f);
+
+  Ac3Parser parser;
+  parser.do_crc = false;
+
+  FileParser file(test_file, parser.getHeaderParser());
+  file.map();
+
+  int errors = 0;
+  int frames = 0;
+
+  // Second pass reads the frames converted by the first one
+  for ( int pass = 0; pass < 2 && ! errors; ++pass )
+  {
+    file.seek(0);
+
+    while ( file.loadFrame() )
+    {
+      const size_t pos(file.getFramePos());
+
+      if ( pos + file.getFrameSize() > data.size()
+          || memcmp(file.getFrame(), &data[pos], file.getFrameSize()) )
+      {
+        printf("mapping: frame at %i was changed by the parser\n", (int)pos);
+        ++errors;
+        break;
+      }
+
+      if ( parser.parseFrame(file.getFrame(), file.getFrameSize()) )
+        ++frames;
+    }
+  }
+
+  if ( ! errors && frames != 40 )
+  {
+    printf("mapping: %i frames decoded instead of 40\n", frames);
+    ++errors;
+  }
+
+  remove(test_file);
+  return errors;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static bool
+checkEntry(const FrameIndex &_index, size_t _frame, bool _format_change, bool _new_stream)
+{
+  FrameIndexEntry entry;
+
+  if ( ! _index.getEntry(_frame, entry)
+      || entry.format_change != _format_change
+      || entry.new_stream != _new_stream )
+  {
+    printf("frame index: wrong flags of frame %i\n", (int)_frame);
+    return false;
+  }
+
+  return true;
+}
+
+static int
+testIndex(void)
+{
+  HeaderInfo h48, h44;
+  h48.setSpeakers(Speakers(FORMAT_AC3, MODE_STEREO, 48000));
+  h48.setSampleCount(1536);
+  h44.setSpeakers(Speakers(FORMAT_AC3, MODE_STEREO, 44100));
+  h44.setSampleCount(1536);
+
+  // frame 0: first frame (new stream)
+  // frame 2: sample rate change within the stream
+  // frame 4: new stream of the same format
+
+  FrameIndex index;
+  index.addFrame(0, h48, false);
+  index.addFrame(100, h48, false);
+  index.addFrame(200, h44, false);
+  index.addFrame(300, h44, false);
+  index.addFrame(400, h44, true);
+  index.setFileSize(500);
+
+  int errors = 0;
+  const std::string sidecar(FrameIndex::sidecarName(test_file));
+
+  for ( int pass = 0; pass < 2; ++pass )
+  {
+    errors += ! checkEntry(index, 0, true, true);
+    errors += ! checkEntry(index, 1, false, false);
+    errors += ! checkEntry(index, 2, true, false);
+    errors += ! checkEntry(index, 3, false, false);
+    errors += ! checkEntry(index, 4, true, true);
+
+    // Second pass: the index loaded from the sidecar
+    if ( ! index.save(sidecar.c_str()) || ! index.load(sidecar.c_str(), 500) )
+    {
+      printf("frame index: cannot save or load the sidecar\n");
+      ++errors;
+      break;
+    }
+  }
+
+  // Sidecar with the first segment not at frame 0 (header is 32 bytes,
+  // followed by 5 frame positions and the segments) must be rejected
+
+  FILE *f = fopen(sidecar.c_str(), "r+b");
+  const uint64_t first_frame = 1;
+
+  if ( f )
+  {
+    fseek(f, 32 + 5 * 8, SEEK_SET);
+    fwrite(&first_frame, sizeof(first_frame), 1, f);
+    fclose(f);
+  }
+
+  if ( index.load(sidecar.c_str(), 500) )
+  {
+    printf("frame index: sidecar with the first segment at frame 1 is loaded\n");
+    ++errors;
+  }
+
+  remove(sidecar.c_str());
+  return errors;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv)
+{
+  int errors = 0;
+
+  errors += testIndex();
+  errors += testDecode(-1);
+  errors += testDecode(100);
+  errors += testMapping();
+
+  printf("ParallelDecoder: %s\n", errors? "FAILED": "ok");
+  return errors;
+}
+
+// vim: ts=2 sts=2 et
@@ -0,0 +1,133 @@
+/*
+  PipelineChain test
+
+  A stage that fails must stop the whole pipeline and the error must reach
+  the caller: process() or getChunk() returns false, nothing stays blocked
+  on the queues. Each stage of a 3-stage chain fails in turn, on the 3rd
+  chunk with the queue depth of 2. The failing stage waits a bit before
+  the error, so the stages before it and the caller are blocked on full
+  queues when it fails. After reset() the chain must work again and pass
+  all chunks.
+
+  A deadlock is reported by the alarm (the test is killed).
+
+  Exit code is the number of failed checks.
+*/
+
+#include <unistd.h>
+#include <cstdio>
+#include <AudioFilter/Buffer.h>
+#include "PipelineChain.h"
+
+using namespace AudioFilter;
+
+static const int nchunks = 100;
+static const size_t chunk_size = 256;
+
+///////////////////////////////////////////////////////////////////////////////
+// Pass-through filter that fails on the chunk given (0 - never)
+// after a delay
+
+class FailFilter : public NullFilter
+{
+public:
+  int fail_at;
+  int count;
+
+  FailFilter(): NullFilter(FORMAT_MASK_LINEAR), fail_at(0), count(0)
+  {}
+
+protected:
+  virtual void onReset(void)
+  {
+    count = 0;
+  }
+
+  virtual bool onProcess(void)
+  {
+    if ( ++count != fail_at )
+      return true;
+
+    usleep(100000);
+    return false;
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+// Returns the number of chunks received, -1 on error
+static int
+run(PipelineChain &_chain, Speakers _spk, const SampleBuf &_buf)
+{
+  int received = 0;
+  Chunk out;
+
+  for ( int i = 0; i < nchunks; ++i )
+  {
+    Chunk chunk(_spk, _buf, chunk_size, false, 0, i == nchunks - 1);
+
+    if ( ! _chain.process(&chunk) )
+      return -1;
+
+    while ( ! _chain.isEmpty() )
+    {
+      if ( ! _chain.getChunk(&out) )
+        return -1;
+
+      if ( ! out.isDummy() && out.size )
+        ++received;
+    }
+  }
+
+  return received;
+}
+
+static int
+test(int _fail_stage)
+{
+  const Speakers spk(FORMAT_LINEAR, MODE_STEREO, 48000);
+  SampleBuf buf(spk.getChannelCount(), chunk_size);
+  buf.zero();
+
+  FailFilter filter[3];
+  PipelineChain chain(2);
+
+  for ( int i = 0; i < 3; ++i )
+    chain.addBack(&filter[i], "Stage");
+
+  filter[_fail_stage].fail_at = 3;
+
+  int errors = 0;
+
+  if ( ! chain.setInput(spk) || run(chain, spk, buf) != -1 )
+  {
+    printf("stage %i fails: the error is not reported\n", _fail_stage);
+    ++errors;
+  }
+
+  filter[_fail_stage].fail_at = 0;
+  chain.reset();
+
+  if ( ! chain.setInput(spk) || run(chain, spk, buf) != nchunks )
+  {
+    printf("stage %i fails: the chain does not work after reset()\n", _fail_stage);
+    ++errors;
+  }
+
+  return errors;
+}
+
+int main(int argc, char **argv)
+{
+  alarm(60);
+
+  int errors = 0;
+
+  for ( int i = 0; i < 3; ++i )
+    errors += test(i);
+
+  printf("PipelineChain: %s\n", errors? "FAILED": "ok");
+  return errors;
+}
+
+// vim: ts=2 sts=2 et
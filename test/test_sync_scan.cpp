@@ -0,0 +1,266 @@
+/*
+  SyncScan test
+
+  All scanner implementations must find the same syncpoints: each position
+  where the synctable matches (getSync() of the 4 bytes), in order. The
+  stream is random noise with syncwords of all standard syncpoints
+  injected, scanned in blocks of random size (down to 1 byte, so
+  syncwords are split between blocks) in the external and the internal
+  buffer mode. The expected syncpoints are found by checking the synctable
+  at each position of the stream.
+
+  Exit code is the number of failed checks.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <AudioFilter/Rng.h>
+#include <AudioFilter/SyncScan.h>
+
+using namespace AudioFilter;
+
+static const size_t stream_size = 1 << 20;
+
+// Syncpoint found: stream position and syncpoint mask
+struct Sync
+{
+  size_t   pos;
+  uint32_t mask;
+
+  bool operator ==(const Sync &_other) const
+  {
+    return pos == _other.pos && mask == _other.mask;
+  }
+};
+
+typedef std::vector<Sync> Syncs;
+
+static const char *impl_name[] = { "auto", "scalar", "sse2", "avx2" };
+
+///////////////////////////////////////////////////////////////////////////////
+// Noise with syncwords injected (big endian words, random
+// bytes where the syncword has no fixed value)
+
+static void
+makeStream(std::vector<uint8_t> &_stream, int _seed)
+{
+  static const uint32_t words[][2] =
+  {
+    { 0x0b770000, 0xffff0000 }, // AC3
+    { 0x770b0000, 0xffff0000 },
+    { 0x7ffe8001, 0xffffffff }, // DTS
+    { 0xfe7f0180, 0xffffffff },
+    { 0x1fffe800, 0xffffffff },
+    { 0xff1f00e8, 0xffffffff },
+    { 0xfff40000, 0xfff60000 }, // MPA
+    { 0xf0ff0000, 0xf0ff0000 },
+    { 0x72f81f4e, 0xffffffff }, // SPDIF
+    { 0x00000000, 0xffffffff },
+    { 0x64582025, 0xffffffff }, // DTS-HD
+    { 0x000001b8, 0xfffffff8 }, // PS
+    { 0x12345678, 0xffffffff }, // custom
+  };
+
+  RNG rng(_seed);
+  _stream.resize(stream_size);
+  rng.fillRaw(&_stream[0], _stream.size());
+
+  for ( int i = 0; i < 20000; ++i )
+  {
+    const size_t n = rng.getRange(array_size(words));
+    const size_t pos = rng.getRange(uint32_t(stream_size - 4));
+    const uint32_t word = (words[n][0] & words[n][1]) | (rng.getNext() & ~words[n][1]);
+
+    _stream[pos + 0] = uint8_t(word >> 24);
+    _stream[pos + 1] = uint8_t(word >> 16);
+    _stream[pos + 2] = uint8_t(word >> 8);
+    _stream[pos + 3] = uint8_t(word);
+  }
+}
+
+static size_t
+blockSize(RNG &_rng)
+{
+  switch ( _rng.getRange(4) )
+  {
+    case 0:  return 1 + _rng.getRange(4);
+    case 1:  return 1 + _rng.getRange(64);
+    default: return 1 + _rng.getRange(8192);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Scan modes
+
+static void
+scanReference(const SyncScan &_scan, std::vector<uint8_t> &_stream, Syncs &_syncs)
+{
+  for ( size_t pos = 0; pos + 4 <= _stream.size(); ++pos )
+  {
+    const uint32_t mask = _scan.getSync(&_stream[pos]);
+
+    if ( mask )
+    {
+      Sync s = { pos, mask };
+      _syncs.push_back(s);
+    }
+  }
+}
+
+static void
+scanExternal(const SyncScan &_scan, std::vector<uint8_t> &_stream, int _seed, Syncs &_syncs)
+{
+  RNG rng(_seed);
+  uint8_t syncbuf[4];
+
+  memcpy(syncbuf, &_stream[0], 4);
+
+  if ( _scan.getSync(syncbuf) )
+  {
+    Sync s = { 0, _scan.getSync(syncbuf) };
+    _syncs.push_back(s);
+  }
+
+  size_t pos = 4;
+
+  while ( pos < _stream.size() )
+  {
+    size_t size = std::min(blockSize(rng), _stream.size() - pos);
+
+    while ( size )
+    {
+      const size_t gone = _scan.scan(syncbuf, &_stream[pos], size);
+      pos += gone;
+      size -= gone;
+
+      if ( _scan.getSync(syncbuf) )
+      {
+        Sync s = { pos - 4, _scan.getSync(syncbuf) };
+        _syncs.push_back(s);
+      }
+    }
+  }
+}
+
+static void
+scanInternal(SyncScan &_scan, std::vector<uint8_t> &_stream, int _seed, Syncs &_syncs)
+{
+  RNG rng(_seed);
+  size_t pos = 0;
+
+  _scan.reset();
+
+  while ( pos < _stream.size() )
+  {
+    size_t size = std::min(blockSize(rng), _stream.size() - pos);
+
+    while ( size )
+    {
+      const size_t gone = _scan.scan(&_stream[pos], size);
+      pos += gone;
+      size -= gone;
+
+      if ( _scan.getSync() )
+      {
+        Sync s = { pos - _scan.count, _scan.getSync() };
+        _syncs.push_back(s);
+      }
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static int
+check(const char *_table, int _impl, const char *_mode, const Syncs &_syncs, const Syncs &_ref)
+{
+  if ( _syncs == _ref )
+    return 0;
+
+  size_t i = 0;
+
+  while ( i < _syncs.size() && i < _ref.size() && _syncs[i] == _ref[i] )
+    ++i;
+
+  printf("%s, %s, %s: %i syncpoints instead of %i, first difference at syncpoint %i\n",
+    _table, impl_name[_impl], _mode, (int)_syncs.size(), (int)_ref.size(), (int)i);
+  return 1;
+}
+
+static int
+testTable(const char *_table, SyncScan &_scan, std::vector<uint8_t> &_stream)
+{
+  int errors = 0;
+  Syncs ref;
+  scanReference(_scan, _stream, ref);
+
+  if ( ref.size() < 1000 )
+  {
+    printf("%s: too few syncpoints in the test stream\n", _table);
+    ++errors;
+  }
+
+  for ( int impl = SyncScan::impl_auto; impl <= SyncScan::impl_avx2; ++impl )
+  {
+    if ( ! _scan.setImpl(impl) )
+    {
+      printf("%s, %s: not supported by the CPU (skipped)\n", _table, impl_name[impl]);
+      continue;
+    }
+
+    for ( int seed = 1; seed <= 3; ++seed )
+    {
+      Syncs ext, in;
+      scanExternal(_scan, _stream, seed, ext);
+      scanInternal(_scan, _stream, seed, in);
+
+      errors += check(_table, impl, "external buffer", ext, ref);
+      errors += check(_table, impl, "internal buffer", in, ref);
+    }
+  }
+
+  _scan.setImpl(SyncScan::impl_auto);
+  return errors;
+}
+
+int main(int argc, char **argv)
+{
+  static const struct
+  {
+    const char *name;
+    uint32_t    syncmask;
+  } tables[] =
+  {
+    { "AC3",          SYNCMASK_AC3 },
+    { "DTS",          SYNCMASK_DTS },
+    { "MPA",          SYNCMASK_MPA },
+    { "SPDIF",        SYNCMASK_AC3 | SYNCMASK_DTS | SYNCMASK_SPDIF | SYNCMASK_DTSHD },
+    { "all standard", SYNCMASK_MAD | SYNCMASK_SPDIF | SYNCMASK_PS | SYNCMASK_DTSHD | SYNCMASK_SPDIF0 },
+  };
+
+  int errors = 0;
+  std::vector<uint8_t> stream;
+  makeStream(stream, 12345);
+
+  for ( size_t i = 0; i < array_size(tables); ++i )
+  {
+    SyncScan scan;
+    scan.setStandard(tables[i].syncmask);
+    errors += testTable(tables[i].name, scan, stream);
+  }
+
+  // Custom syncpoints: a full syncword and a one-byte one
+  {
+    SyncScan scan;
+    scan.set(0, 0x12345678, 0xffffffff);
+    scan.set(1, 0x0b000000, 0xff000000);
+    errors += testTable("custom", scan, stream);
+  }
+
+  printf("SyncScan: %s\n", errors? "FAILED": "ok");
+  return errors;
+}
+
+// vim: ts=2 sts=2 et